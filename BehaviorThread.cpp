@@ -0,0 +1,102 @@
+
+// This file is part of Man, a robotic perception, locomotion, and
+// team strategy application created by the Northern Bites RoboCup
+// team of Bowdoin College in Brunswick, Maine, for the Aldebaran
+// Nao robot.
+//
+// Man is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Man is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// and the GNU Lesser Public License along with Man.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#include "BehaviorThread.h"
+
+using boost::shared_ptr;
+
+BehaviorThread::BehaviorThread(shared_ptr<Synchro> _synchro,
+                               shared_ptr<Noggin> _noggin,
+                               shared_ptr<Lights> _lights,
+                               shared_ptr<Profiler> _profiler)
+    : Thread(_synchro, "BehaviorThread"),
+      noggin(_noggin), lights(_lights), profiler(_profiler),
+      ready(_synchro->create("BehaviorThread_ready")),
+      idle(_synchro->create("BehaviorThread_idle")),
+      stopped(false), frameArrival(0)
+#ifdef DEBUG_FRAME_LATENCY
+    , latency("pipelined")
+#endif
+{
+    // there is no frame to finish before the first one
+    idle->signal();
+}
+
+BehaviorThread::~BehaviorThread()
+{
+}
+
+void BehaviorThread::run()
+{
+    Thread::running = true;
+    stopped = false;
+    // forget a stop() from the last time we ran
+    ready->poll();
+    Thread::trigger->on();
+
+    while (Thread::running) {
+        ready->await();
+        if (!Thread::running) {
+            break;
+        }
+
+        noggin->runStep();
+
+        PROF_ENTER(profiler.get(), P_LIGHTS);
+        lights->sendLights();
+        PROF_EXIT(profiler.get(), P_LIGHTS);
+
+#ifdef DEBUG_FRAME_LATENCY
+        latency.record(frameArrival);
+#endif
+        idle->signal();
+    }
+
+    // let an image thread still waiting on us carry on
+    stopped = true;
+    idle->signal();
+    Thread::trigger->off();
+}
+
+void BehaviorThread::stop()
+{
+    Thread::stop();
+    ready->signal();
+}
+
+bool BehaviorThread::awaitIdle()
+{
+    if (stopped) {
+        return false;
+    }
+    idle->await();
+    if (stopped) {
+        // and the next one to wait, too
+        idle->signal();
+        return false;
+    }
+    return true;
+}
+
+void BehaviorThread::frameReady(long long arrival)
+{
+    frameArrival = arrival;
+    ready->signal();
+}
@@ -0,0 +1,76 @@
+
+// This file is part of Man, a robotic perception, locomotion, and
+// team strategy application created by the Northern Bites RoboCup
+// team of Bowdoin College in Brunswick, Maine, for the Aldebaran
+// Nao robot.
+//
+// Man is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Man is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// and the GNU Lesser Public License along with Man.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef _BehaviorThread_h_DEFINED
+#define _BehaviorThread_h_DEFINED
+
+#include <boost/shared_ptr.hpp>
+
+#include "manconfig.h"
+
+#include "synchro.h"
+#include "Profiler.h"
+#include "Noggin.h"
+#include "Lights.h"
+#include "FrameLatency.h"
+
+/**
+ * Runs Noggin and sends the lights for one frame while the image thread
+ * runs vision on the next (see USE_VISION_PIPELINE in Man).
+ *
+ * Noggin reads a Vision of its own that nothing else writes to.  The image
+ * thread waits with awaitIdle() until behaviors are done with the last frame,
+ * copies the new frame's results into Noggin's Vision, then hands it over
+ * with frameReady().
+ */
+class BehaviorThread : public Thread
+{
+public:
+    BehaviorThread(boost::shared_ptr<Synchro> _synchro,
+                   boost::shared_ptr<Noggin> _noggin,
+                   boost::shared_ptr<Lights> _lights,
+                   boost::shared_ptr<Profiler> _profiler);
+    virtual ~BehaviorThread();
+
+    void run();
+    void stop();
+
+    // Wait until behaviors are finished with the last frame handed over.
+    // False if the thread has stopped, and will not take another frame
+    bool awaitIdle();
+    // Run behaviors on the results now in Noggin's Vision, whose image came
+    // in at the given micro_time()
+    void frameReady(long long arrival);
+
+private:
+    boost::shared_ptr<Noggin> noggin;
+    boost::shared_ptr<Lights> lights;
+    boost::shared_ptr<Profiler> profiler;
+
+    boost::shared_ptr<Event> ready;
+    boost::shared_ptr<Event> idle;
+    bool stopped;
+    long long frameArrival;
+#ifdef DEBUG_FRAME_LATENCY
+    FrameLatency latency;
+#endif
+};
+
+#endif // _BehaviorThread_h_DEFINED
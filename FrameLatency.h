@@ -0,0 +1,73 @@
+// This file is part of Man, a robotic perception, locomotion, and
+// team strategy application created by the Northern Bites RoboCup
+// team of Bowdoin College in Brunswick, Maine, for the Aldebaran
+// Nao robot.
+//
+// Man is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Man is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// and the GNU Lesser Public License along with Man.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef _FrameLatency_h_DEFINED
+#define _FrameLatency_h_DEFINED
+
+#include <stdio.h>
+
+#include "Common.h"
+
+// how many frames go into each line FrameLatency prints
+static const int FRAME_LATENCY_REPORT_FRAMES = 300;
+
+/**
+ * Counts how many frames get all the way through behaviors each second, and
+ * how long each took from the image coming in to the behaviors finishing
+ * with it.  A line is printed every FRAME_LATENCY_REPORT_FRAMES frames.
+ */
+class FrameLatency
+{
+public:
+    FrameLatency(const char *_mode)
+        : mode(_mode), frames(0), start(0), total(0), worst(0) { }
+
+    // behaviors are done with the frame whose image came in at arrival
+    void record(long long arrival) {
+        const long long now = micro_time();
+        // the rate is counted from the end of the frame before the first
+        if (start == 0) {
+            start = now;
+            return;
+        }
+        const long long latency = now - arrival;
+        frames++;
+        total += latency;
+        if (latency > worst) {
+            worst = latency;
+        }
+        if (frames == FRAME_LATENCY_REPORT_FRAMES) {
+            printf("%s: %.1f fps, latency %.1f ms mean %.1f ms max\n", mode,
+                   1000000.0 * frames / static_cast<double>(now - start),
+                   total / 1000.0 / frames, worst / 1000.0);
+            frames = 0;
+            start = now;
+            total = worst = 0;
+        }
+    }
+
+private:
+    const char *mode;
+    int frames;
+    long long start;
+    long long total;
+    long long worst;
+};
+
+#endif // _FrameLatency_h_DEFINED
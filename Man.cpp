@@ -49,7 +49,11 @@ Man::Man (shared_ptr<Sensors> _sensors,
           shared_ptr<MotionEnactor> _enactor,
           shared_ptr<Synchro> synchro,
           shared_ptr<Lights> _lights)
-    : sensors(_sensors),
+    : frameArrival(0),
+#if defined(DEBUG_FRAME_LATENCY) && !defined(USE_VISION_PIPELINE)
+      latency("sequential"),
+#endif
+      sensors(_sensors),
       transcriber(_transcriber),
       imageTranscriber(_imageTranscriber),
       enactor(_enactor),
@@ -84,7 +88,15 @@ Man::Man (shared_ptr<Sensors> _sensors,
 
     vision = shared_ptr<Vision>(new Vision(pose, profiler));
     comm = shared_ptr<Comm>(new Comm(synchro, sensors, vision));
-#ifdef USE_NOGGIN
+#ifdef USE_VISION_PIPELINE
+    behaviorPose = shared_ptr<NaoPose>(new NaoPose(sensors));
+    behaviorVision = shared_ptr<Vision>(new Vision(behaviorPose, profiler));
+    noggin = shared_ptr<Noggin>(new Noggin(profiler,behaviorVision,comm,
+                                           guardian, sensors,
+                                           motion->getInterface()));
+    behaviors = shared_ptr<BehaviorThread>(
+        new BehaviorThread(synchro, noggin, lights, profiler));
+#elif defined(USE_NOGGIN)
     noggin = shared_ptr<Noggin>(new Noggin(profiler,vision,comm,guardian,
                                            sensors, motion->getInterface()));
 #endif// USE_NOGGIN
@@ -123,6 +135,13 @@ void Man::startSubThreads() {
     else
         guardian->getTrigger()->await_on();
 
+#ifdef USE_VISION_PIPELINE
+    if (behaviors->start() != 0)
+        cerr << "Behavior thread failed to start" << endl;
+    else
+        behaviors->getTrigger()->await_on();
+#endif
+
 
 #ifdef DEBUG_MAN_THREADING
     cout << "  run :: Signalling start" << endl;
@@ -131,6 +150,14 @@ void Man::startSubThreads() {
 
 void Man::stopSubThreads() {
 
+#ifdef USE_VISION_PIPELINE
+    behaviors->stop();
+    behaviors->getTrigger()->await_off();
+#ifdef DEBUG_MAN_THREADING
+    cout << "  Behavior thread is stopped" << endl;
+#endif
+#endif
+
     guardian->stop();
     guardian->getTrigger()->await_off();
 #ifdef DEBUG_MAN_THREADING
@@ -171,14 +198,26 @@ Man::processFrame ()
 
     PROF_ENTER(profiler.get(), P_FINAL);
 	PROF_EXIT(profiler.get(), P_GETIMAGE);
+    PROF_RECORD(profiler.get(), P_IMAGEAGE,
+                sensors->getFramePacing().imageAge);
 #ifdef USE_VISION
     //if(camera_active)
 	PROF_ENTER(profiler, P_VISION);
-    vision->notifyImage(sensors->getImage());
+    const unsigned char *image = sensors->lockImage();
+    vision->notifyImage(image);
+    sensors->releaseImage(image);
 	PROF_EXIT(profiler, P_VISION);
     //vision->notifyImage();
 #endif
 
+#ifdef USE_VISION_PIPELINE
+    // Behaviors run on their own thread, with a copy of this frame's
+    // results, while we go on to the next image
+    if (behaviors->awaitIdle()) {
+        behaviorVision->copyResults(*vision);
+        behaviors->frameReady(frameArrival);
+    }
+#else
     // run Python behaviors
 #ifdef USE_NOGGIN
     noggin->runStep();
@@ -186,6 +225,10 @@ Man::processFrame ()
     PROF_ENTER(profiler.get(), P_LIGHTS);
     lights->sendLights();
     PROF_EXIT(profiler.get(), P_LIGHTS);
+#ifdef DEBUG_FRAME_LATENCY
+    latency.record(frameArrival);
+#endif
+#endif
 
 	PROF_ENTER(profiler.get(), P_GETIMAGE);
     PROF_EXIT(profiler.get(), P_FINAL);
@@ -194,6 +237,8 @@ Man::processFrame ()
 
 
 void Man::notifyNextVisionImage() {
+    frameArrival = micro_time();
+
     // Synchronize noggin's information about joint angles with the motion
     // thread's information
 
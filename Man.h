@@ -47,6 +47,10 @@
 #include "PyRoboGuardian.h"
 #include "PySensors.h"
 #include "PyLights.h"
+#include "FrameLatency.h"
+#ifdef USE_VISION_PIPELINE
+#  include "BehaviorThread.h"
+#endif
 
 /**
  * The Naoqi module to run our main Nao robot system.
@@ -92,6 +96,12 @@ private:
 
     void notifyNextVisionImage();
 
+    // when the image being processed came in, from micro_time()
+    long long frameArrival;
+#if defined(DEBUG_FRAME_LATENCY) && !defined(USE_VISION_PIPELINE)
+    FrameLatency latency;
+#endif
+
   //
   // Variables
   //
@@ -118,6 +128,13 @@ public:
 #ifdef USE_NOGGIN
     boost::shared_ptr<Noggin> noggin;
 #endif// USE_NOGGIN
+#ifdef USE_VISION_PIPELINE
+    // Noggin reads behaviorVision, which gets a copy of vision's results
+    // once each frame is done, and runs on a thread of its own
+    boost::shared_ptr<NaoPose> behaviorPose;
+    boost::shared_ptr<Vision> behaviorVision;
+    boost::shared_ptr<BehaviorThread> behaviors;
+#endif
     boost::shared_ptr<Lights> lights;
 
 };
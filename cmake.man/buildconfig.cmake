@@ -96,6 +96,11 @@ OPTION(
   "Turn on/off debug printing on requesting images"
   OFF
   )
+OPTION(
+  DEBUG_FRAME_LATENCY
+  "Turn on/off printing the frame rate and the latency from image to behaviors"
+  OFF
+  )
 
 OPTION(
   USE_VISION
@@ -112,6 +117,11 @@ OPTION(
   "Turn on/off all motion actions"
   ON
   )
+OPTION(
+  USE_VISION_PIPELINE
+  "Run behaviors on their own thread, a frame behind vision"
+  OFF
+  )
 OPTION(
   USE_DCM
   "Send commands directly to the DCM. Turn this off in REMOTE mode"
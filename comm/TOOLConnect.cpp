@@ -172,15 +172,15 @@ TOOLConnect::handle_request (DataRequest &r) throw(socket_error&)
 
     // Image data request
     if (r.image) {
-        sensors->lockImage();
+        const unsigned char *raw = sensors->lockImage();
         if (!vision->thresh->inverted) {
-            serial.write_bytes(sensors->getImage(), IMAGE_BYTE_SIZE);
-            sensors->releaseImage();
+            serial.write_bytes(raw, IMAGE_BYTE_SIZE);
+            sensors->releaseImage(raw);
         }else {
             unsigned char image[IMAGE_BYTE_SIZE], swap;
             // copy raw image data
-            memcpy(&image[0], sensors->getImage(), IMAGE_BYTE_SIZE);
-            sensors->releaseImage();
+            memcpy(&image[0], raw, IMAGE_BYTE_SIZE);
+            sensors->releaseImage(raw);
             // swap U and V pixels
             for (int i = 1; i < IMAGE_BYTE_SIZE; i += 4) {
                 swap = image[i];
@@ -3,6 +3,7 @@
 #include "alvision/alvisiondefinitions.h"
 
 #include "manconfig.h"
+#include "corpusconfig.h"
 
 #include "ALImageTranscriber.h"
 
@@ -50,7 +51,8 @@ ALImageTranscriber::ALImageTranscriber(shared_ptr<Synchro> synchro,
                                        ALPtr<ALBroker> broker)
     : ThreadedImageTranscriber(s,synchro,"ALImageTranscriber"),
       log(), camera(), lem_name(""), camera_active(false),
-      image(new unsigned char[IMAGE_BYTE_SIZE])
+      image(NULL), imageTimestamp(0),
+      pacer(1000000LL / DEFAULT_CAMERA_FRAMERATE)
 {
     try {
         log = broker->getLoggerProxy();
@@ -77,7 +79,6 @@ ALImageTranscriber::ALImageTranscriber(shared_ptr<Synchro> synchro,
 }
 
 ALImageTranscriber::~ALImageTranscriber() {
-    delete [] image;
     stop();
 }
 
@@ -90,9 +91,27 @@ void ALImageTranscriber::run() {
     Thread::running = true;
     Thread::trigger->on();
 
+#ifdef USE_CAMERA_PACING
+    while (Thread::running) {
+        if (camera_active) {
+            waitForImage();
+            if (!pacer.startFrame(imageTimestamp, micro_time())) {
+                // Seen it already; the camera's next is due any moment
+                releaseImage();
+                const long long wait = pacer.sleepTime(micro_time());
+                sleepFor(wait > PACING_MARGIN_uS ? wait : PACING_MARGIN_uS);
+                continue;
+            }
+            sensors->setFramePacing(pacer.getStats());
+        }
+        subscriber->notifyNextVisionImage();
+        pacer.endFrame(micro_time());
+
+        sleepFor(pacer.sleepTime(micro_time()));
+    }
+#else
 	long long lastProcessTimeAvg = VISION_FRAME_LENGTH_uS;
 
-	struct timespec interval, remainder;
     while (Thread::running) {
         //start timer
         const long long startTime = micro_time();
@@ -112,25 +131,23 @@ void ALImageTranscriber::run() {
 						  << " frame length: " << processTime <<std::endl;
             //Don't sleep at all
         } else{
-			const long int microSleepTime = (VISION_FRAME_LENGTH_uS -
-											 processTime);
-			const long int nanoSleepTime =
-				(microSleepTime %(1000 * 1000)) * 1000;
-
-			const long int secSleepTime = microSleepTime / (1000*1000);
-
-			// cout << "Sleeping for nano: " << nanoSleepTime <<
-			// 	" and sec:" << secSleepTime << endl;
-
-			interval.tv_sec = secSleepTime;
-			interval.tv_nsec = nanoSleepTime;
-
-            nanosleep(&interval, &remainder);
+            sleepFor(VISION_FRAME_LENGTH_uS - processTime);
         }
     }
+#endif
     Thread::trigger->off();
 }
 
+void ALImageTranscriber::sleepFor(long long microSleepTime) {
+    if (microSleepTime <= 0)
+        return;
+
+	struct timespec interval, remainder;
+    interval.tv_sec = static_cast<time_t>(microSleepTime / (1000*1000));
+    interval.tv_nsec = static_cast<long>((microSleepTime % (1000*1000)) * 1000);
+    nanosleep(&interval, &remainder);
+}
+
 void ALImageTranscriber::stop() {
 	std::cout << "Stopping ALImageTranscriber" << std::endl;
     running = false;
@@ -435,6 +452,15 @@ void ALImageTranscriber::initCameraSettings(int whichCam){
 void ALImageTranscriber::waitForImage ()
 {
     try {
+#ifdef USE_ZERO_COPY_IMAGE
+        // The last frame is read where NaoCam put it, so it is only given
+        // back once everyone is done with it
+        if (image != NULL) {
+            sensors->awaitImageReleased(image);
+            giveBackImage();
+            image = NULL;
+        }
+#endif
 #ifndef MAN_IS_REMOTE
 #ifdef DEBUG_IMAGE_REQUESTS
         printf("Requesting local image of size %ix%i, color space %i\n",
@@ -449,9 +475,16 @@ void ALImageTranscriber::waitForImage ()
             log->error("NaoMain", "Could not call the getImageLocal method of the "
                        "NaoCam module");
         }
+        imageTimestamp = 0;
         if (ALimage != NULL) {
-            memcpy(&image[0], ALimage->getFrame(), IMAGE_BYTE_SIZE);
-            //image = ALimage->getFrame();
+            imageTimestamp = ALimage->fTimeStamp;
+#ifdef USE_ZERO_COPY_IMAGE
+            image = ALimage->getFrame();
+#else
+            unsigned char *buffer = sensors->nextImageBuffer();
+            memcpy(buffer, ALimage->getFrame(), IMAGE_BYTE_SIZE);
+            image = buffer;
+#endif
         }
         else
             std::cout << "\tALImage from camera was null!!" << std::endl;
@@ -474,7 +507,8 @@ void ALImageTranscriber::waitForImage ()
         printf("Requesting remote image of size %ix%i, color space %i\n",
                IMAGE_WIDTH, IMAGE_HEIGHT, NAO_COLOR_SPACE);
 #endif
-        ALValue ALimage;
+        // kept as a member so that the image can be read in place
+        ALValue &ALimage = remoteImage;
         ALimage.arraySetSize(7);
 
         // Attempt to retrive the next image
@@ -486,8 +520,16 @@ void ALImageTranscriber::waitForImage ()
                        "NaoCam module");
         }
 
-        //image = static_cast<const unsigned char*>(ALimage[6].GetBinary());
-        memcpy(&image[0], ALimage[6].GetBinary(), IMAGE_BYTE_SIZE);
+        // The timestamp is from the robot's clock, which micro_time() can't
+        // be compared with, so the pacer takes the image as just arrived
+        imageTimestamp = 0;
+#ifdef USE_ZERO_COPY_IMAGE
+        image = static_cast<const unsigned char*>(ALimage[6].GetBinary());
+#else
+        unsigned char *buffer = sensors->nextImageBuffer();
+        memcpy(buffer, ALimage[6].GetBinary(), IMAGE_BYTE_SIZE);
+        image = buffer;
+#endif
 #ifdef DEBUG_IMAGE_REQUESTS
         //You can get some informations of the image.
         int width = (int) ALimage[0];
@@ -506,9 +548,7 @@ void ALImageTranscriber::waitForImage ()
 
         if (image != NULL) {
             // Update Sensors image pointer
-            sensors->lockImage();
             sensors->setImage(image);
-            sensors->releaseImage();
         }
 
     }catch (ALError &e) {
@@ -518,6 +558,13 @@ void ALImageTranscriber::waitForImage ()
 
 
 void ALImageTranscriber::releaseImage(){
+#ifndef USE_ZERO_COPY_IMAGE
+    // with zero copy, the image is given back in waitForImage()
+    giveBackImage();
+#endif
+}
+
+void ALImageTranscriber::giveBackImage(){
 #ifndef MAN_IS_REMOTE
     if (!camera_active)
         return;
@@ -6,7 +6,11 @@
 #include "alptr.h"
 #include "alloggerproxy.h"
 
+#include "manconfig.h"
+#include "corpusconfig.h"
+
 #include "ThreadedImageTranscriber.h"
+#include "FramePacer.h"
 #include "synchro.h"
 
 class ALImageTranscriber : public ThreadedImageTranscriber {
@@ -31,6 +35,9 @@ private: // helper methods
     void registerCamera(AL::ALPtr<AL::ALBroker> broker);
     void initCameraSettings(int whichCam);
     void waitForImage();
+    // give the camera's frame back to NaoCam
+    void giveBackImage();
+    void sleepFor(long long micros);
 
 private: // member variables
     // Interfaces/Proxies to robot
@@ -42,9 +49,16 @@ private: // member variables
 
     bool camera_active;
 
-    // Keep a local copy of the image because accessing the one from NaoQi is
+    // The image Sensors hands out.  Unless USE_ZERO_COPY_IMAGE is on, it is
+    // a copy in Sensors' ImageRing, because accessing the one from NaoQi is
     // from the kernel and thus very slow.
-    unsigned char *image;
+    const unsigned char *image;
+#ifdef MAN_IS_REMOTE
+    AL::ALValue remoteImage;
+#endif
+    // when the camera took the image, 0 if we could not tell
+    long long imageTimestamp;
+    FramePacer pacer;
 
 private: // nBites Camera Constants
     // Camera identification
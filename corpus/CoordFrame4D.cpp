@@ -88,7 +88,8 @@ const NBMath::ufmatrix4 CoordFrame4D::translation4D(const float dx,
 const NBMath::ufvector4 CoordFrame4D::vector4D(const float x, const float y,
                                                const float z,
                                                const float w) {
-    NBMath::ufvector4 p = boost::numeric::ublas::zero_vector <float> (4);
+    // every element is set, and a zero_vector would go to the heap
+    NBMath::ufvector4 p(4);
     p(0) = x;
     p(1) = y;
     p(2) = z;
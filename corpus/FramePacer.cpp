@@ -0,0 +1,109 @@
+
+// This file is part of Man, a robotic perception, locomotion, and
+// team strategy application created by the Northern Bites RoboCup
+// team of Bowdoin College in Brunswick, Maine, for the Aldebaran
+// Nao robot.
+//
+// Man is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Man is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// and the GNU Lesser Public License along with Man.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#include "FramePacer.h"
+
+FramePacer::FramePacer(long long _framePeriod)
+    : framePeriod(_framePeriod), latestFrameWins(true), lastTimestamp(0),
+      currentTimestamp(0), inFrame(false), totalLatency(0), stats()
+{
+}
+
+FramePacer::~FramePacer()
+{
+}
+
+bool FramePacer::startFrame(long long timestamp, long long now)
+{
+    // without timestamps, the image is as new as it gets
+    if (timestamp <= 0) {
+        timestamp = now;
+    }
+
+    if (timestamp <= lastTimestamp) {
+        stats.stale++;
+        if (latestFrameWins) {
+            return false;
+        }
+    } else if (lastTimestamp > 0) {
+        // every period between the two is an image we never saw
+        const long long skipped =
+            (timestamp - lastTimestamp + framePeriod / 2) / framePeriod - 1;
+        if (skipped > 0) {
+            stats.missed += static_cast<int>(skipped);
+        }
+    }
+
+    currentTimestamp = timestamp;
+    lastTimestamp = timestamp;
+    inFrame = true;
+    stats.imageAge = now - timestamp;
+    return true;
+}
+
+void FramePacer::endFrame(long long now)
+{
+    if (!inFrame) {
+        return;
+    }
+    inFrame = false;
+
+    const long long latency = now - currentTimestamp;
+    stats.frames++;
+    totalLatency += latency;
+    stats.meanLatency = static_cast<float>(totalLatency) /
+        static_cast<float>(stats.frames);
+    if (latency > stats.maxLatency) {
+        stats.maxLatency = latency;
+    }
+
+    long long bin = latency / PACING_BIN_WIDTH_uS;
+    if (bin < 0) {
+        bin = 0;
+    } else if (bin >= PACING_LATENCY_BINS) {
+        bin = PACING_LATENCY_BINS - 1;
+    }
+    stats.latency[bin]++;
+}
+
+long long FramePacer::sleepTime(long long now) const
+{
+    // nothing to go by, so wait out a whole frame
+    if (lastTimestamp == 0) {
+        return framePeriod;
+    }
+
+    // The next image is due a period after the last one we got.  If that has
+    // gone by we are behind and there is a newer image waiting already.
+    // Never more than a frame and the margin, even if the timestamp is
+    // ahead of our clock.
+    const long long next = lastTimestamp + framePeriod + PACING_MARGIN_uS;
+    if (next <= now) {
+        return 0;
+    }
+    return next - now < framePeriod + PACING_MARGIN_uS ?
+        next - now : framePeriod + PACING_MARGIN_uS;
+}
+
+void FramePacer::resetStats()
+{
+    stats = FramePacing();
+    totalLatency = 0;
+}
@@ -0,0 +1,94 @@
+
+// This file is part of Man, a robotic perception, locomotion, and
+// team strategy application created by the Northern Bites RoboCup
+// team of Bowdoin College in Brunswick, Maine, for the Aldebaran
+// Nao robot.
+//
+// Man is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Man is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// and the GNU Lesser Public License along with Man.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef FramePacer_h_DEFINED
+#define FramePacer_h_DEFINED
+
+#include <vector>
+
+// The latency histogram has bins this wide, the last one taking everything
+// longer than the rest
+static const int PACING_LATENCY_BINS = 20;
+static const long long PACING_BIN_WIDTH_uS = 5000;
+// how long after the camera takes an image to ask for it
+static const long long PACING_MARGIN_uS = 1000;
+
+/**
+ * How well the image loop keeps up with the camera.  Latency is from the
+ * camera taking an image to vision and behaviors finishing with it.
+ */
+struct FramePacing
+{
+    FramePacing()
+        : frames(0), stale(0), missed(0), imageAge(0), meanLatency(0.0f),
+          maxLatency(0), latency(PACING_LATENCY_BINS, 0) { }
+
+    // images processed
+    int frames;
+    // images skipped because they had already been processed
+    int stale;
+    // images the camera took that were never processed
+    int missed;
+    // how old the image being processed was when we started on it, in us
+    long long imageAge;
+    // in us
+    float meanLatency;
+    long long maxLatency;
+    // frames by latency, PACING_BIN_WIDTH_uS to a bin
+    std::vector<int> latency;
+};
+
+/**
+ * Times the image loop by the camera's timestamps instead of a fixed frame
+ * length: we ask for an image just after the camera should have taken the
+ * next one, straight away if we are behind, and (with latestFrameWins) never
+ * process the same image twice.
+ */
+class FramePacer
+{
+public:
+    FramePacer(long long _framePeriod);
+    virtual ~FramePacer();
+
+    // An image the camera took at timestamp (micro_time()'s clock, 0 if not
+    // known) has come in.  False if it is one we have already processed and
+    // should be skipped.
+    bool startFrame(long long timestamp, long long now);
+    // Vision and behaviors are done with the image started last
+    void endFrame(long long now);
+    // How long to sleep before asking for the next image, in us
+    long long sleepTime(long long now) const;
+
+    void setLatestFrameWins(bool on) { latestFrameWins = on; }
+    const FramePacing& getStats() const { return stats; }
+    void resetStats();
+
+private:
+    long long framePeriod;
+    bool latestFrameWins;
+    // when the image last processed and the one being processed were taken
+    long long lastTimestamp;
+    long long currentTimestamp;
+    bool inFrame;
+    long long totalLatency;
+    FramePacing stats;
+};
+
+#endif // FramePacer_h_DEFINED
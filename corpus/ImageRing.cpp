@@ -0,0 +1,140 @@
+
+// This file is part of Man, a robotic perception, locomotion, and
+// team strategy application created by the Northern Bites RoboCup
+// team of Bowdoin College in Brunswick, Maine, for the Aldebaran
+// Nao robot.
+//
+// Man is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Man is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// and the GNU Lesser Public License along with Man.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#include "ImageRing.h"
+#include "VisionDef.h"
+
+ImageRing::ImageRing()
+    : newest(-1), filling(-1)
+{
+    for (int i = 0; i < IMAGE_RING_SIZE; i++) {
+        slots[i].buffer = new unsigned char[IMAGE_BYTE_SIZE];
+        slots[i].image = slots[i].buffer;
+        slots[i].holds = 0;
+    }
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&released, NULL);
+}
+
+ImageRing::~ImageRing()
+{
+    pthread_cond_destroy(&released);
+    pthread_mutex_destroy(&mutex);
+    for (int i = 0; i < IMAGE_RING_SIZE; i++) {
+        delete [] slots[i].buffer;
+    }
+}
+
+int ImageRing::find(const unsigned char *img) const
+{
+    for (int i = 0; i < IMAGE_RING_SIZE; i++) {
+        if (slots[i].image == img) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Call with the mutex locked
+int ImageRing::awaitFreeSlot()
+{
+    while (true) {
+        for (int i = 0; i < IMAGE_RING_SIZE; i++) {
+            if (slots[i].holds == 0 && i != newest && i != filling) {
+                return i;
+            }
+        }
+        pthread_cond_wait(&released, &mutex);
+    }
+}
+
+unsigned char* ImageRing::nextBuffer()
+{
+    pthread_mutex_lock(&mutex);
+    filling = awaitFreeSlot();
+    slots[filling].image = slots[filling].buffer;
+    unsigned char *buffer = slots[filling].buffer;
+    pthread_mutex_unlock(&mutex);
+    return buffer;
+}
+
+void ImageRing::publish(const unsigned char *img)
+{
+    pthread_mutex_lock(&mutex);
+    int slot = find(img);
+    if (slot == -1) {
+        // the transcriber's own memory, which goes in a slot of its own
+        slot = awaitFreeSlot();
+        slots[slot].image = img;
+    }
+    if (slot == filling) {
+        filling = -1;
+    }
+    newest = slot;
+    pthread_mutex_unlock(&mutex);
+}
+
+const unsigned char* ImageRing::hold()
+{
+    pthread_mutex_lock(&mutex);
+    const unsigned char *img = NULL;
+    if (newest != -1) {
+        slots[newest].holds++;
+        img = slots[newest].image;
+    }
+    pthread_mutex_unlock(&mutex);
+    return img;
+}
+
+void ImageRing::release(const unsigned char *img)
+{
+    pthread_mutex_lock(&mutex);
+    const int slot = find(img);
+    if (slot != -1 && slots[slot].holds > 0) {
+        slots[slot].holds--;
+        pthread_cond_broadcast(&released);
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+const unsigned char* ImageRing::latest() const
+{
+    pthread_mutex_lock(&mutex);
+    const unsigned char *img = newest == -1 ? NULL : slots[newest].image;
+    pthread_mutex_unlock(&mutex);
+    return img;
+}
+
+void ImageRing::awaitReleased(const unsigned char *img)
+{
+    pthread_mutex_lock(&mutex);
+    const int slot = find(img);
+    if (slot != -1) {
+        if (slot == newest) {
+            newest = -1;
+        }
+        while (slots[slot].holds > 0) {
+            pthread_cond_wait(&released, &mutex);
+        }
+        // the memory is going back, the slot has its buffer again
+        slots[slot].image = slots[slot].buffer;
+    }
+    pthread_mutex_unlock(&mutex);
+}
@@ -0,0 +1,88 @@
+
+// This file is part of Man, a robotic perception, locomotion, and
+// team strategy application created by the Northern Bites RoboCup
+// team of Bowdoin College in Brunswick, Maine, for the Aldebaran
+// Nao robot.
+//
+// Man is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Man is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// and the GNU Lesser Public License along with Man.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef ImageRing_h_DEFINED
+#define ImageRing_h_DEFINED
+
+#include <pthread.h>
+
+// as many images as can be held at once: the latest, the one being
+// written, and one each for vision and the TOOL
+static const int IMAGE_RING_SIZE = 4;
+
+/**
+ * The images Sensors hands out, each counted by how many readers hold it.
+ *
+ * The transcriber either writes each image into a buffer from nextBuffer(),
+ * or publishes memory of its own (the camera's frame) to be read in place.
+ * Readers hold() the latest image and must release() it when done; an image
+ * that is held is never written over, so nobody needs to copy it to keep it.
+ * Memory the transcriber published must not be reused or given back until
+ * awaitReleased() returns.
+ */
+class ImageRing
+{
+public:
+    ImageRing();
+    virtual ~ImageRing();
+
+    // A buffer that nobody holds, for the next image
+    unsigned char* nextBuffer();
+    // Make img the latest image, either a buffer from nextBuffer() or the
+    // caller's own memory
+    void publish(const unsigned char *img);
+
+    // The latest image, held until release().  NULL if there is none
+    const unsigned char* hold();
+    void release(const unsigned char *img);
+    // The latest image, not held
+    const unsigned char* latest() const;
+
+    // Stop handing out img and wait until nobody holds it
+    void awaitReleased(const unsigned char *img);
+
+private:
+    // not copyable, the buffers belong to us
+    ImageRing(const ImageRing&);
+    ImageRing& operator=(const ImageRing&);
+
+    struct Slot {
+        // our buffer, and the image in the slot: the buffer or the
+        // transcriber's memory
+        unsigned char *buffer;
+        const unsigned char *image;
+        int holds;
+    };
+
+    int find(const unsigned char *img) const;
+    // a slot that is neither held nor the latest
+    int awaitFreeSlot();
+
+    Slot slots[IMAGE_RING_SIZE];
+    // the slot with the latest image, or -1
+    int newest;
+    // the slot handed out by nextBuffer() and not yet published, or -1
+    int filling;
+
+    mutable pthread_mutex_t mutex;
+    pthread_cond_t released;
+};
+
+#endif // ImageRing_h_DEFINED
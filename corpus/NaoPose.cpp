@@ -20,6 +20,7 @@
 
 #include <boost/shared_ptr.hpp>
 
+#include "visionconfig.h"   // for OFFLINE, which compareEstimates() needs
 #include "NaoPose.h"
 using namespace std;
 using boost::shared_ptr;
@@ -48,6 +49,9 @@ const float NaoPose::PIX_TO_RAD_Y = static_cast<float>(FOV_Y_DEG/IMAGE_HEIGHT)*T
 const estimate NaoPose::NULL_ESTIMATE = {0.0, 0.0, 0.0, 0.0, 0.0};
 
 const float NaoPose::INFTY = 1E+37f;
+#ifdef OFFLINE
+const float NaoPose::ESTIMATE_TOLERANCE = 0.001f;
+#endif
 
 // Screen edge coordinates in the camera coordinate frame
 const ublas::vector <float> NaoPose::topLeft(vector4D(FOCAL_LENGTH_MM,
@@ -72,6 +76,20 @@ NaoPose::NaoPose (shared_ptr<Sensors> s)
       focalPointInWorldFrame(0.0f, 0.0f, 0.0f),
       comHeight(0.0f)
 {
+  // The angles of each column and row from the middle of the image never
+  // change, so bodyEstimate can look up their sines and cosines
+  for (int x = 0; x < IMAGE_WIDTH; x++) {
+    const float bearing = (IMAGE_CENTER_X - (float)x)*PIX_TO_RAD_X;
+    columnBearingCos[x] = cos(bearing);
+    columnBearingSin[x] = sin(bearing);
+    columnRays[x] = point3 <float>(0.0f, 0.0f, 0.0f);
+  }
+  for (int y = 0; y < IMAGE_HEIGHT; y++) {
+    const float elevation = ((float)y - IMAGE_CENTER_Y)*PIX_TO_RAD_Y;
+    rowElevationCos[y] = cos(-elevation);
+    rowElevationSin[y] = sin(-elevation);
+    rowRays[y] = point3 <float>(0.0f, 0.0f, 0.0f);
+  }
 }
 
 /**
@@ -163,6 +181,41 @@ void NaoPose::transform () {
   focalPointInWorldFrame.y = cameraToWorldFrame(Y,3);
   focalPointInWorldFrame.z = cameraToWorldFrame(Z,3);
 
+  calcPixelRays();
+}
+
+/**
+ * The ray from the focal point through a pixel, in the world frame, is
+ * cameraToWorldFrame's rotation applied to the pixel in the camera frame,
+ *   (FOCAL_LENGTH_MM, (IMAGE_CENTER_X - x)*PIX_X_TO_MM,
+ *    (IMAGE_CENTER_Y - y)*PIX_Y_TO_MM).
+ * That splits into a part that depends only on the column and a part that
+ * depends only on the row, which we work out here once a frame so that
+ * pixEstimate is a couple of additions away from the ray.
+ */
+void NaoPose::calcPixelRays() {
+  const float cameraXInWorld[3] = { cameraToWorldFrame(X,X),
+                                    cameraToWorldFrame(Y,X),
+                                    cameraToWorldFrame(Z,X) };
+  const float cameraYInWorld[3] = { cameraToWorldFrame(X,Y),
+                                    cameraToWorldFrame(Y,Y),
+                                    cameraToWorldFrame(Z,Y) };
+  const float cameraZInWorld[3] = { cameraToWorldFrame(X,Z),
+                                    cameraToWorldFrame(Y,Z),
+                                    cameraToWorldFrame(Z,Z) };
+
+  for (int x = 0; x < IMAGE_WIDTH; x++) {
+    const float mm = ((float)IMAGE_CENTER_X - (float)x) * (float)PIX_X_TO_MM;
+    columnRays[x].x = cameraYInWorld[X] * mm;
+    columnRays[x].y = cameraYInWorld[Y] * mm;
+    columnRays[x].z = cameraYInWorld[Z] * mm;
+  }
+  for (int y = 0; y < IMAGE_HEIGHT; y++) {
+    const float mm = ((float)IMAGE_CENTER_Y - (float)y) * (float)PIX_Y_TO_MM;
+    rowRays[y].x = cameraXInWorld[X] * FOCAL_LENGTH_MM + cameraZInWorld[X] * mm;
+    rowRays[y].y = cameraXInWorld[Y] * FOCAL_LENGTH_MM + cameraZInWorld[Y] * mm;
+    rowRays[y].z = cameraXInWorld[Z] * FOCAL_LENGTH_MM + cameraZInWorld[Z] * mm;
+  }
 }
 
 /**
@@ -290,26 +343,70 @@ intersectLineWithXYPlane(const std::vector<ublas::vector <float> > &aLine) {
 
 /**
  * Method to determine where the physical point represented by a pixel is relative
- * to the world frame.
+ * to the world frame.  Uses the pixel rays worked out in transform(), see
+ * calcPixelRays().
  */
 const estimate NaoPose::pixEstimate(const int pixelX, const int pixelY,
 				    const float objectHeight) {
 
+  if ( pixelX >= IMAGE_WIDTH || pixelX < 0  ||
+       pixelY >= IMAGE_HEIGHT || pixelY < 0  ){
+    return NULL_ESTIMATE;
+  }
+  // the ray from the focal point through the pixel, in the world frame
+  const float rayX = columnRays[pixelX].x + rowRays[pixelY].x;
+  const float rayY = columnRays[pixelX].y + rowRays[pixelY].y;
+  const float rayZ = columnRays[pixelX].z + rowRays[pixelY].z;
+
+  // The same sanity check as in exactPixEstimate: a plane below the focal
+  // point can't be hit by a ray going up
+  if (objectHeight*CM_TO_MM < comHeight + focalPointInWorldFrame.z &&
+      rayZ > 0) {
+    return NULL_ESTIMATE;
+  }
+
+  // Follow the ray to the plane, parallel to the ground, at objectHeight.
+  // A ray parallel to the plane stops at the pixel itself.
+  const float object_z_in_world_frame = -comHeight + objectHeight * CM_TO_MM;
+  float s = 1.0f;
+  if (rayZ != 0) {
+    s = (object_z_in_world_frame - focalPointInWorldFrame.z) / rayZ;
+  }
+
+  const ufvector4 objectInWorldFrame =
+    vector4D(focalPointInWorldFrame.x + rayX * s,
+             focalPointInWorldFrame.y + rayY * s,
+             focalPointInWorldFrame.z + rayZ * s);
+
+  estimate est = getEstimate(objectInWorldFrame);
+  est.dist = correctDistance(static_cast<float>(est.dist) );
+
+  return est;
+}
+
+#ifdef OFFLINE
+/**
+ * pixEstimate the long way, through the full camera transform.  Kept to
+ * check the ray lookup against, see compareEstimates().
+ */
+const estimate NaoPose::exactPixEstimate(const int pixelX, const int pixelY,
+                                         const float objectHeight) {
+
   if ( pixelX >= IMAGE_WIDTH || pixelX < 0  ||
        pixelY >= IMAGE_HEIGHT || pixelY < 0  ){
     return NULL_ESTIMATE;
   }
   // declare x,y,z coordinate of pixel in relation to focal point
-  ublas::vector <float> pixelInCameraFrame =
+  // (bounded vectors keep this, called many times a frame, off the heap)
+  const ufvector4 pixelInCameraFrame =
     vector4D(FOCAL_LENGTH_MM,
 			 ((float)IMAGE_CENTER_X - (float)pixelX) * (float)PIX_X_TO_MM,
 			 ((float)IMAGE_CENTER_Y - (float)pixelY) * (float)PIX_Y_TO_MM);
 
   // declare x,y,z coordinate of pixel in relation to body center
-  ublas::vector <float> pixelInWorldFrame(4);
-
   // transform camera coordinates to body frame coordinates for a test pixel
-  pixelInWorldFrame = prod(cameraToWorldFrame, pixelInCameraFrame);
+  const ufvector4 pixelInWorldFrame =
+    prod(cameraToWorldFrame, pixelInCameraFrame);
 
   // Draw the line between the focal point and the pixel while in the world
   // frame. Our goal is to find the point of intersection of that line and
@@ -336,7 +433,7 @@ const estimate NaoPose::pixEstimate(const int pixelX, const int pixelY,
     (focalPointInWorldFrame.y - pixelInWorldFrame(Y))*t;
   const float z = pixelInWorldFrame(Z) +
     (focalPointInWorldFrame.z - pixelInWorldFrame(Z))*t;
-  ublas::vector<float> objectInWorldFrame = vector4D(x,y,z);
+  const ufvector4 objectInWorldFrame = vector4D(x,y,z);
 
   // SANITY CHECKS
   //If the plane where the target object is, is below the camera height,
@@ -353,6 +450,44 @@ const estimate NaoPose::pixEstimate(const int pixelX, const int pixelY,
 
   return est;
 }
+#endif
+
+
+  /**
+   * The inverse of pixEstimate.  Given a point objectHeight cm above the
+   * ground at x,y cm in the world frame (as in the x and y of an estimate),
+   * finds the pixel it is seen at.  The pixel may be off the image.  Returns
+   * false, and leaves pixel alone, if the point is behind the camera.
+   */
+const bool NaoPose::worldPointToPixel(const float x, const float y,
+                                      const float objectHeight,
+                                      point <float> &pixel) const {
+  // from the focal point to the object, in the world frame
+  const float dx = x * CM_TO_MM - focalPointInWorldFrame.x;
+  const float dy = y * CM_TO_MM - focalPointInWorldFrame.y;
+  const float dz = -comHeight + objectHeight * CM_TO_MM -
+    focalPointInWorldFrame.z;
+
+  // The rotation part of cameraToWorldFrame is orthogonal, so its transpose
+  // takes us back into the camera frame
+  const float cameraX = cameraToWorldFrame(X,X) * dx +
+    cameraToWorldFrame(Y,X) * dy + cameraToWorldFrame(Z,X) * dz;
+  const float cameraY = cameraToWorldFrame(X,Y) * dx +
+    cameraToWorldFrame(Y,Y) * dy + cameraToWorldFrame(Z,Y) * dz;
+  const float cameraZ = cameraToWorldFrame(X,Z) * dx +
+    cameraToWorldFrame(Y,Z) * dy + cameraToWorldFrame(Z,Z) * dz;
+
+  if (cameraX < FOCAL_LENGTH_MM) {
+    return false;
+  }
+
+  // project onto the image plane, which is FOCAL_LENGTH_MM along x
+  pixel.x = IMAGE_CENTER_X -
+    cameraY * FOCAL_LENGTH_MM / cameraX * MM_TO_PIX_X;
+  pixel.y = IMAGE_CENTER_Y -
+    cameraZ * FOCAL_LENGTH_MM / cameraX * MM_TO_PIX_Y;
+  return true;
+}
 
 
   /**
@@ -365,6 +500,38 @@ const estimate NaoPose::bodyEstimate(const int x, const int y,
 				    const float dist) {
   if (dist <= 0.0)
     return NULL_ESTIMATE;
+  if (x < 0 || x >= IMAGE_WIDTH || y < 0 || y >= IMAGE_HEIGHT)
+    return exactBodyEstimate(x, y, dist);
+
+  // convert dist estimate to mm
+  const float object_dist = dist*10;
+  const float distCosBearing = object_dist * columnBearingCos[x];
+
+  // object in the camera frame, with the angles of the pixel looked up
+  const float cameraX = distCosBearing * rowElevationCos[y];
+  const float cameraY = object_dist * columnBearingSin[x];
+  const float cameraZ = distCosBearing * rowElevationSin[y];
+
+  // object in world frame
+  const ufvector4 objectInWorldFrame =
+    vector4D(cameraToWorldFrame(X,X) * cameraX +
+             cameraToWorldFrame(X,Y) * cameraY +
+             cameraToWorldFrame(X,Z) * cameraZ + focalPointInWorldFrame.x,
+             cameraToWorldFrame(Y,X) * cameraX +
+             cameraToWorldFrame(Y,Y) * cameraY +
+             cameraToWorldFrame(Y,Z) * cameraZ + focalPointInWorldFrame.y,
+             cameraToWorldFrame(Z,X) * cameraX +
+             cameraToWorldFrame(Z,Y) * cameraY +
+             cameraToWorldFrame(Z,Z) * cameraZ + focalPointInWorldFrame.z);
+
+  return getEstimate(objectInWorldFrame);
+}
+
+// bodyEstimate working the angles out for itself, for pixels off the image
+const estimate NaoPose::exactBodyEstimate(const int x, const int y,
+                                          const float dist) {
+  if (dist <= 0.0)
+    return NULL_ESTIMATE;
 
   //all angle signs are according to right hand rule for the major axis
   // get bearing angle in image plane,left pos, right negative
@@ -375,19 +542,91 @@ const estimate NaoPose::bodyEstimate(const int x, const int y,
   float object_dist = dist*10;
 
   // object in the camera frame
-  ublas::vector<float> objectInCameraFrame =
+  const ufvector4 objectInCameraFrame =
     vector4D(object_dist*cos(object_bearing)*cos(-object_elevation),
 			 object_dist*sin(object_bearing),
 			 object_dist*cos(object_bearing)*sin(-object_elevation));
 
   // object in world frame
-  ublas::vector<float> objectInWorldFrame =
+  const ufvector4 objectInWorldFrame =
      prod(cameraToWorldFrame,objectInCameraFrame);
 
   return getEstimate(objectInWorldFrame);
 }
 
 
+#ifdef OFFLINE
+/**
+ * Checks pixEstimate and bodyEstimate, which look up the pixel rays and
+ * angles, against exactPixEstimate and exactBodyEstimate for every pixel of
+ * the image with the current pose.  Prints the largest differences and how
+ * long each takes per call, and returns whether they all agree to within
+ * ESTIMATE_TOLERANCE (relative for distances, radians for bearings).
+ */
+const bool NaoPose::compareEstimates() {
+  // heights to try pixEstimate at, in cm, and the distance for bodyEstimate
+  const float heights[] = { 0.0f, 20.0f };
+  const int NUM_HEIGHTS = sizeof(heights) / sizeof(heights[0]);
+  const float BODY_DIST = 100.0f;
+
+  float worstDist = 0.0f, worstBearing = 0.0f;
+  int differentNulls = 0;
+  for (int h = 0; h <= NUM_HEIGHTS; h++) {
+    for (int y = 0; y < IMAGE_HEIGHT; y++) {
+      for (int x = 0; x < IMAGE_WIDTH; x++) {
+        estimate lookup, exact;
+        if (h < NUM_HEIGHTS) {
+          lookup = pixEstimate(x, y, heights[h]);
+          exact = exactPixEstimate(x, y, heights[h]);
+        } else {
+          lookup = bodyEstimate(x, y, BODY_DIST);
+          exact = exactBodyEstimate(x, y, BODY_DIST);
+        }
+        if ((lookup.dist == 0.0f) != (exact.dist == 0.0f)) {
+          differentNulls++;
+          continue;
+        }
+        if (exact.dist != 0.0f) {
+          worstDist = max(worstDist,
+                          std::fabs(lookup.dist - exact.dist) / exact.dist);
+        }
+        worstBearing = max(worstBearing,
+                           std::fabs(lookup.bearing - exact.bearing));
+      }
+    }
+  }
+
+  // and how long each takes, over the whole image at ground level
+  float sum = 0.0f;
+  long long start = micro_time();
+  for (int y = 0; y < IMAGE_HEIGHT; y++) {
+    for (int x = 0; x < IMAGE_WIDTH; x++) {
+      sum += pixEstimate(x, y, 0.0f).dist;
+    }
+  }
+  const long long lookupTime = micro_time() - start;
+  start = micro_time();
+  for (int y = 0; y < IMAGE_HEIGHT; y++) {
+    for (int x = 0; x < IMAGE_WIDTH; x++) {
+      sum -= exactPixEstimate(x, y, 0.0f).dist;
+    }
+  }
+  const long long exactTime = micro_time() - start;
+
+  const bool same = differentNulls == 0 && worstDist <= ESTIMATE_TOLERANCE &&
+    worstBearing <= ESTIMATE_TOLERANCE;
+  const float nsPerCall = 1000.0f / (IMAGE_WIDTH * IMAGE_HEIGHT);
+  cout << "pixEstimate: lookup " << lookupTime * nsPerCall
+       << " ns/call, exact " << exactTime * nsPerCall
+       << " ns/call (difference " << sum << ")" << endl
+       << "  worst distance error " << worstDist * 100.0f
+       << "%, worst bearing error " << worstBearing << " rad, "
+       << differentNulls << " null estimates differ: "
+       << (same ? "agree" : "MISMATCH") << endl;
+  return same;
+}
+#endif
+
 const float NaoPose::correctDistance(const float uncorrectedDist) {
 	if (uncorrectedDist > 706.0f) {
 		return uncorrectedDist - 387.0f;
@@ -403,7 +642,7 @@ const float NaoPose::correctDistance(const float uncorrectedDist) {
  * Input units are MM, output in estimate is in CM, radians
  *
  */
-estimate NaoPose::getEstimate(ublas::vector <float> objInWorldFrame){
+estimate NaoPose::getEstimate(const ufvector4 &objInWorldFrame){
   estimate pix_est = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
 
   //distance as projected onto XY plane - ie bird's eye view
@@ -503,9 +742,9 @@ NaoPose::calculateForwardTransform(const ChainID id,
 }
 
 
-const float NaoPose::getHomLength(const ublas::vector <float> &vec) {
+const float NaoPose::getHomLength(const ufvector4 &vec) {
   float sum = 0.0f;
-  for (ublas::vector<float>::const_iterator i = vec.begin(); i != vec.end() - 1;
+  for (ufvector4::const_iterator i = vec.begin(); i != vec.end() - 1;
        ++i) {
     sum += *i * *i;
   }
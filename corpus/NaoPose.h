@@ -141,6 +141,10 @@ protected: // Constants
     static const estimate NULL_ESTIMATE;
 
     static const float INFTY;
+#ifdef OFFLINE
+    // how far compareEstimates lets the two ways of estimating differ
+    static const float ESTIMATE_TOLERANCE;
+#endif
     // Screen edge coordinates in the camera coordinate frame.
     static const boost::numeric::ublas::vector <float> topLeft, bottomLeft, topRight, bottomRight;
 
@@ -161,6 +165,15 @@ public:
     const estimate pixEstimate(const int pixelX, const int pixelY,
                                const float objectHeight);
     const estimate bodyEstimate(const int x, const int y, const float dist);
+#ifdef OFFLINE
+    // Checks the two methods above against the full camera transform
+    const bool compareEstimates();
+#endif
+    // The other way round from pixEstimate: where a point in the world frame
+    // shows up in the image
+    const bool worldPointToPixel(const float x, const float y,
+                                 const float objectHeight,
+                                 point <float> &pixel) const;
 
     /********** Getters **********/
     const int getHorizonY(const int x) const;
@@ -191,6 +204,16 @@ protected: // helper methods
       calcFocalPointInBodyFrame();
 
     void calcImageHorizonLine();
+    void calcPixelRays();
+
+    // pixEstimate and bodyEstimate the long way, through the whole camera
+    // transform
+#ifdef OFFLINE
+    const estimate exactPixEstimate(const int pixelX, const int pixelY,
+                                    const float objectHeight);
+#endif
+    const estimate exactBodyEstimate(const int x, const int y,
+                                     const float dist);
     // This method solves a system of linear equations and return a 3-d vector
     // in homogeneous coordinates representing the point of intersection
     static boost::numeric::ublas::vector <float>
@@ -198,7 +221,7 @@ protected: // helper methods
                                boost::numeric::ublas::vector <float> > &aLine);
     // In homogeneous coordinates, get the length of a n-dimensional vector.
     static const float
-      getHomLength(const boost::numeric::ublas::vector <float> &vec);
+      getHomLength(const NBMath::ufvector4 &vec);
 
     // takes in two sides of a triangle, returns hypotenuse
     static const float getHypotenuse(const float x, const float y) {
@@ -207,7 +230,7 @@ protected: // helper methods
 
     //returns an 'estimate' object for a homogeneous vector pointing to an
     //object in the world frame
-    static estimate getEstimate(boost::numeric::ublas::vector <float> objInWorldFrame);
+    static estimate getEstimate(const NBMath::ufvector4 &objInWorldFrame);
     // Usually our pix estimate is an overestimate of the distance to the pixel,
     // so we have a fitting function which tries to correct the noise. This is
     // that function.
@@ -230,6 +253,15 @@ protected: // members
     boost::numeric::ublas::matrix <float> cameraToWorldFrame;
     // Current hack for better beraing est
     boost::numeric::ublas::matrix <float> cameraToBodyTransform;
+
+    // The ray (mm, world frame) from the focal point through pixel x,y is
+    // columnRays[x] + rowRays[y], worked out each frame in calcPixelRays()
+    point3 <float> columnRays[IMAGE_WIDTH];
+    point3 <float> rowRays[IMAGE_HEIGHT];
+    // The bearing of each column and the elevation of each row, which
+    // bodyEstimate needs and which never change
+    float columnBearingCos[IMAGE_WIDTH], columnBearingSin[IMAGE_WIDTH];
+    float rowElevationCos[IMAGE_HEIGHT], rowElevationSin[IMAGE_HEIGHT];
 };
 
 #endif
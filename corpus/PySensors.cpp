@@ -76,6 +76,20 @@ BOOST_PYTHON_MODULE(sensors)
         .def(vector_indexing_suite< std::vector<float> >())
         ;
 
+    class_< std::vector<int> >("LatencyHistogram")
+        .def(vector_indexing_suite< std::vector<int> >())
+        ;
+
+    class_<FramePacing>("FramePacing", no_init)
+        .def_readonly("frames", &FramePacing::frames)
+        .def_readonly("stale", &FramePacing::stale)
+        .def_readonly("missed", &FramePacing::missed)
+        .def_readonly("imageAge", &FramePacing::imageAge)
+        .def_readonly("meanLatency", &FramePacing::meanLatency)
+        .def_readonly("maxLatency", &FramePacing::maxLatency)
+        .def_readonly("latency", &FramePacing::latency)
+        ;
+
     class_<Sensors, shared_ptr<Sensors> >("Sensors", no_init)
         //All the properties lack a setter. The values should be read-only
         //NOTE: all sensor values in Python should be in degrees and centimeters
@@ -91,6 +105,7 @@ BOOST_PYTHON_MODULE(sensors)
         .add_property("chestButton", &Sensors::getChestButton)
         .add_property("batteryCharge", &Sensors::getBatteryCharge)
         .add_property("batteryCurrent", &Sensors::getBatteryCurrent)
+        .add_property("framePacing", &Sensors::getFramePacing)
 
         .def("saveFrame", &Sensors::saveFrame)
         .def("resetSaveFrame", &Sensors::resetSaveFrame)
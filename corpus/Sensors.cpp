@@ -57,10 +57,11 @@ Sensors::Sensors ()
       rightFootBumper(0.0f, 0.0f),
       inertial(0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f),
       ultraSoundDistance(0.0f), ultraSoundMode(LL),
-      image(&global_image[0]),
+      images(),
       supportFoot(LEFT_SUPPORT),
       unfilteredInertial(0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f),
       chestButton(0.0f),batteryCharge(0.0f),batteryCurrent(0.0f),
+      framePacing(),
       FRM_FOLDER("/home/nao/naoqi/frames")
 {
     pthread_mutex_init(&angles_mutex, NULL);
@@ -75,9 +76,7 @@ Sensors::Sensors ()
     pthread_mutex_init(&ultra_sound_mutex, NULL);
     pthread_mutex_init(&support_foot_mutex, NULL);
     pthread_mutex_init(&battery_mutex, NULL);
-#ifdef USE_SENSORS_IMAGE_LOCKING
-    pthread_mutex_init(&image_mutex, NULL);
-#endif
+    pthread_mutex_init(&pacing_mutex, NULL);
 }
 
 Sensors::~Sensors ()
@@ -94,9 +93,7 @@ Sensors::~Sensors ()
     pthread_mutex_destroy(&ultra_sound_mutex);
     pthread_mutex_destroy(&support_foot_mutex);
     pthread_mutex_destroy(&battery_mutex);
-#ifdef USE_SENSORS_IMAGE_LOCKING
-    pthread_mutex_destroy(&image_mutex);
-#endif
+    pthread_mutex_destroy(&pacing_mutex);
 }
 
 const vector<float> Sensors::getBodyAngles () const
@@ -370,6 +367,17 @@ const float Sensors::getBatteryCurrent () const
     return current;
 }
 
+const FramePacing Sensors::getFramePacing () const
+{
+    pthread_mutex_lock (&pacing_mutex);
+
+    const FramePacing pacing = framePacing;
+
+    pthread_mutex_unlock (&pacing_mutex);
+
+    return pacing;
+}
+
 const vector<float> Sensors::getAllSensors () const
 {
     //All sensors sans unfiltered Inertials and Temperatures
@@ -591,6 +599,15 @@ void Sensors::setUltraSoundMode (const UltraSoundMode mode)
     pthread_mutex_unlock (&ultra_sound_mutex);
 }
 
+void Sensors::setFramePacing (const FramePacing &pacing)
+{
+    pthread_mutex_lock (&pacing_mutex);
+
+    framePacing = pacing;
+
+    pthread_mutex_unlock (&pacing_mutex);
+}
+
 void Sensors::setSupportFoot (const SupportFoot _supportFoot)
 {
     pthread_mutex_lock (&support_foot_mutex);
@@ -692,18 +709,25 @@ void Sensors::setAllSensors (vector<float> sensorValues) {
 }
 
 
-void Sensors::lockImage()
+const unsigned char* Sensors::lockImage()
+{
+    const unsigned char *img = images.hold();
+    return img != NULL ? img : &global_image[0];
+}
+
+void Sensors::releaseImage(const unsigned char *img)
+{
+    images.release(img);
+}
+
+unsigned char* Sensors::nextImageBuffer()
 {
-#ifdef USE_SENSORS_IMAGE_LOCKING
-    pthread_mutex_lock (&image_mutex);
-#endif
+    return images.nextBuffer();
 }
 
-void Sensors::releaseImage()
+void Sensors::awaitImageReleased(const unsigned char *img)
 {
-#ifdef USE_SENSORS_IMAGE_LOCKING
-    pthread_mutex_unlock (&image_mutex);
-#endif
+    images.awaitReleased(img);
 }
 
 /**
@@ -726,12 +750,13 @@ void Sensors::updateVisionAngles() {
 
 const unsigned char* Sensors::getImage ()
 {
-    return image;
+    const unsigned char *img = images.latest();
+    return img != NULL ? img : &global_image[0];
 }
 
 void Sensors::setImage (const unsigned char *img)
 {
-    image = img;
+    images.publish(img);
 }
 
 
@@ -760,10 +785,9 @@ void Sensors::saveFrame()
     vector<float> joints = getVisionBodyAngles();
 
     // Lock and write imag1e
-    lockImage();
-    fout.write(reinterpret_cast<const char*>(getImage()),
-               IMAGE_BYTE_SIZE);
-    releaseImage();
+    const unsigned char *img = lockImage();
+    fout.write(reinterpret_cast<const char*>(img), IMAGE_BYTE_SIZE);
+    releaseImage(img);
 
     // write the version of the frame format at the end before joints/sensors
     fout << VERSION << " ";
@@ -27,6 +27,8 @@
 #include "SensorDef.h"
 #include "NaoDef.h"
 #include "VisionDef.h"
+#include "ImageRing.h"
+#include "FramePacer.h"
 
 enum SupportFoot {
     LEFT_SUPPORT = 0,
@@ -117,6 +119,7 @@ class Sensors {
     const float getChestButton() const;
     const float getBatteryCharge() const;
     const float getBatteryCurrent() const;
+    const FramePacing getFramePacing() const;
     const std::vector<float> getAllSensors() const;
 
     // Locking data storage methods
@@ -147,6 +150,7 @@ class Sensors {
     void setUnfilteredInertial(const Inertial &inertial);
     void setUltraSound(const float dist);
     void setUltraSoundMode(const UltraSoundMode);
+    void setFramePacing(const FramePacing &pacing);
     void setSupportFoot(const SupportFoot _supportFoot);
 
     void setMotionSensors(const FSR &_leftFoot, const FSR &_rightFoot,
@@ -167,21 +171,22 @@ class Sensors {
 
     // special methods
     //   the image retrieval and locking methods are a little different, as we
-    //   don't copy the raw image data.  If locking is needed for some period
-    //   of time while processing, the lockImage() method is called, followed
-    //   by getImage() and MUST be followed finally by relaseImage().  The
-    //   getImage() method will always retrieve the latest image pointer, but
-    //   it is only guaranteed to be valid and unmodified between calls to
-    //   lockImage() and releaseImage().
-    //   Also of import is that the locking is only valid if the source of the
-    //   image pointer decides to abide by it.  setImage() does not not lock on
-    //   its own, and there is no way, even with locking, to guarantee that the
-    //   underlying data at the image pointer location is not modified while
-    //   the image is locked in Sensors.
+    //   don't copy the raw image data.  Images are handed out of an
+    //   ImageRing: the transcriber writes each one into nextImageBuffer(), or
+    //   passes memory of its own, and makes it the latest with setImage().
+    //   If an image is needed for some period of time while processing,
+    //   lockImage() holds and returns the latest image, and MUST be followed
+    //   finally by releaseImage() on it.  A held image is not written over.
+    //   The getImage() method will always retrieve the latest image pointer,
+    //   but it is only guaranteed to be unmodified while held.
+    //   Memory of the transcriber's own must not be reused or given back
+    //   until awaitImageReleased() returns.
     const unsigned char* getImage();
     void setImage(const unsigned char* img);
-    void lockImage();
-    void releaseImage();
+    const unsigned char* lockImage();
+    void releaseImage(const unsigned char* img);
+    unsigned char* nextImageBuffer();
+    void awaitImageReleased(const unsigned char* img);
 
     // The following method will internally save a snapshot of the current body
     // angles. This way we can save joints that are synchronized to the most
@@ -210,7 +215,7 @@ private:
     mutable pthread_mutex_t ultra_sound_mutex;
     mutable pthread_mutex_t support_foot_mutex;
     mutable pthread_mutex_t battery_mutex;
-    mutable pthread_mutex_t image_mutex;
+    mutable pthread_mutex_t pacing_mutex;
 
     // Joint angles and sensors
     // Make the following distinction: bodyAngles is a vector of the most current
@@ -235,7 +240,7 @@ private:
     float ultraSoundDistance;
     UltraSoundMode ultraSoundMode;
 
-    const unsigned char *image;
+    ImageRing images;
 
     // Pose needs to know which foot is on the ground during a vision frame
     // If both are on the ground (DOUBLE_SUPPORT_MODE/not walking), we assume
@@ -253,6 +258,8 @@ private:
     //Battery
     float batteryCharge;
     float batteryCurrent;
+    // How the image loop is keeping up with the camera
+    FramePacing framePacing;
 
     static int saved_frames;
     std::string FRM_FOLDER;
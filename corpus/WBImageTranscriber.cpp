@@ -19,16 +19,12 @@ const int WBImageTranscriber::V_OFFSET    = 3;
 
 WBImageTranscriber::WBImageTranscriber(shared_ptr<Sensors> s)
     :ImageTranscriber(s),
-     image(new unsigned char[IMAGE_BYTE_SIZE])
+     image(NULL)
 {
     camera = wb_robot_get_device("camera");
     wb_camera_enable(camera,40);
 
 
-    for (int i =0; i< IMAGE_BYTE_SIZE; i++){
-        image[i] = 0;
-    }
-
     WbDeviceTag camServo  = wb_robot_get_device("CameraSelect");
     wb_servo_enable_position(camServo,20);
     wb_servo_set_position(camServo,0.6981);
@@ -83,6 +79,9 @@ void WBImageTranscriber::waitForImage(){
     //First, get the RGB buffer from webots
     const unsigned char *wbimage = wb_camera_get_image (camera);
 
+    //the YUV image goes straight into a buffer nobody is reading
+    image = sensors->nextImageBuffer();
+
     //next we need to translate the buffer to YUV, and make it
     //the correct size (half VGA) (it comes in quarter VGA)
     int maxIndex = 0;
@@ -109,9 +108,7 @@ void WBImageTranscriber::waitForImage(){
     }
 
     //Tell sensors that we have a new image for it
-    sensors->lockImage();
     sensors->setImage(image);
-    sensors->releaseImage();
 
     subscriber->notifyNextVisionImage();
 }
@@ -39,6 +39,16 @@ OPTION(
     ON
     )
 
+OPTION(
+    USE_ZERO_COPY_IMAGE
+    "Read the camera's frames in place instead of copying them out of NaoQi"
+    OFF
+    )
+OPTION(
+    USE_CAMERA_PACING
+    "Time the image loop by the camera's timestamps, skipping stale images"
+    OFF
+    )
 OPTION(
     DEBUG_THREAD
     "Turn on/off debugging information for the Thread class."
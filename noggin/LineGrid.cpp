@@ -0,0 +1,158 @@
+/**
+ * LineGrid.cpp - A precomputed distance field of the field lines.
+ */
+
+#include <math.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "LineGrid.h"
+#include "FieldConstants.h"
+#include "ConcreteLine.h"
+
+using namespace std;
+
+static const char LGD_MAGIC[4] = { 'N', 'B', 'L', 'G' };
+static const size_t LGD_HEADER_SIZE = 4 + 2 * sizeof(int) + 3 * sizeof(float);
+
+// What a grid with no distances in it reads
+static const unsigned short EMPTY_CELL = 0;
+
+LineGrid::LineGrid()
+    : width(1), height(1), originX(0), originY(0), cellSize(1),
+      invCellSize(1), cells(&EMPTY_CELL), mapping(0), mappingSize(0)
+{
+}
+
+LineGrid::~LineGrid()
+{
+    release();
+}
+
+void LineGrid::setSize(int _width, int _height, float _originX,
+                       float _originY, float _cellSize)
+{
+    width = _width;
+    height = _height;
+    originX = _originX;
+    originY = _originY;
+    cellSize = _cellSize;
+    invCellSize = 1.0f / _cellSize;
+}
+
+/* Distance from every cell's center to the nearest line segment, by brute
+ * force; it only runs offline or once at startup.
+ * @param cellSize  Side of a cell in cm
+ */
+void LineGrid::build(float _cellSize)
+{
+    release();
+    setSize(static_cast<int>(ceilf(FIELD_WIDTH / _cellSize)),
+            static_cast<int>(ceilf(FIELD_HEIGHT / _cellSize)),
+            0.0f, 0.0f, _cellSize);
+    memory.resize(width * height);
+
+    const vector<const ConcreteLine*>& lines = ConcreteLine::concreteLines();
+    for (int j = 0; j < height; ++j) {
+        const float y = originY + (static_cast<float>(j) + 0.5f) * cellSize;
+        for (int i = 0; i < width; ++i) {
+            const float x = originX + (static_cast<float>(i) + 0.5f) *
+                cellSize;
+
+            float nearest = HUGE_VAL;
+            for (unsigned int l = 0; l < lines.size(); ++l) {
+                const float x1 = lines[l]->getFieldX1();
+                const float y1 = lines[l]->getFieldY1();
+                const float dx = lines[l]->getFieldX2() - x1;
+                const float dy = lines[l]->getFieldY2() - y1;
+
+                // Nearest point of the segment
+                float t = ((x - x1) * dx + (y - y1) * dy) / (dx * dx + dy * dy);
+                t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+                const float d = hypotf(x1 + t * dx - x, y1 + t * dy - y);
+                if (d < nearest) {
+                    nearest = d;
+                }
+            }
+
+            const float mm = floorf(nearest * 10.0f + 0.5f);
+            memory[j * width + i] = static_cast<unsigned short>(
+                mm < 65535.0f ? mm : 65535.0f);
+        }
+    }
+    cells = &memory[0];
+}
+
+/* Map an .lgd file.  The file must not be written to in place while it is
+ * mapped; write a new grid to another file and rename it over the old.
+ * @return   false if the file can't be opened or is not a whole grid
+ */
+bool LineGrid::map(const char *filename)
+{
+    const int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    char header[LGD_HEADER_SIZE];
+    if (fstat(fd, &info) != 0 ||
+        read(fd, header, LGD_HEADER_SIZE) !=
+        static_cast<ssize_t>(LGD_HEADER_SIZE) ||
+        memcmp(header, LGD_MAGIC, 4) != 0) {
+        close(fd);
+        return false;
+    }
+
+    int dims[2];
+    float place[3];
+    memcpy(dims, header + 4, sizeof(dims));
+    memcpy(place, header + 4 + sizeof(dims), sizeof(place));
+    const size_t size = LGD_HEADER_SIZE + sizeof(unsigned short) *
+        static_cast<size_t>(dims[0]) * static_cast<size_t>(dims[1]);
+    if (dims[0] <= 0 || dims[1] <= 0 || !(place[2] > 0.0f) ||
+        static_cast<size_t>(info.st_size) < size) {
+        close(fd);
+        return false;
+    }
+
+    void *m = mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (m == MAP_FAILED) {
+        return false;
+    }
+
+    release();
+    mapping = m;
+    mappingSize = size;
+    setSize(dims[0], dims[1], place[0], place[1], place[2]);
+    cells = reinterpret_cast<const unsigned short*>(
+        static_cast<const char*>(m) + LGD_HEADER_SIZE);
+    return true;
+}
+
+bool LineGrid::write(FILE *fp) const
+{
+    const int dims[2] = { width, height };
+    const float place[3] = { originX, originY, cellSize };
+    const size_t count = static_cast<size_t>(width) *
+        static_cast<size_t>(height);
+    return fwrite(LGD_MAGIC, sizeof(char), 4, fp) == 4 &&
+        fwrite(dims, sizeof(int), 2, fp) == 2 &&
+        fwrite(place, sizeof(float), 3, fp) == 3 &&
+        fwrite(cells, sizeof(unsigned short), count, fp) == count;
+}
+
+void LineGrid::release()
+{
+    if (mapping != 0) {
+        munmap(mapping, mappingSize);
+        mapping = 0;
+        mappingSize = 0;
+    }
+    memory.clear();
+    setSize(1, 1, 0.0f, 0.0f, 1.0f);
+    cells = &EMPTY_CELL;
+}
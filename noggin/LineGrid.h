@@ -0,0 +1,82 @@
+/**
+ * LineGrid.h - A precomputed distance field of the field lines.
+ *
+ * The field is cut into square cells and each cell holds the distance from
+ * its center to the nearest field line of ConcreteLine, so the distance from
+ * any point to the lines is one lookup however many lines there are.  MCL
+ * uses it to weigh line observations as points on the field that should
+ * land on a line.
+ *
+ * A grid is built here or mapped from an .lgd file, which is written by
+ * noggin/offline/makeLineGrid.  The .lgd format is:
+ *    "NBLG"                      4 byte magic
+ *    width, height               4 byte ints, host byte order, in cells
+ *    originX, originY, cellSize  4 byte floats, cm
+ *    distances                   width * height unsigned shorts, row major
+ *                                from originY, in mm
+ *
+ * A mapped file is never copied and its pages are shared with the page
+ * cache.  Points off the grid read the nearest cell on its edge.
+ */
+
+#ifndef LineGrid_h_DEFINED
+#define LineGrid_h_DEFINED
+
+#include <stdio.h>
+#include <stddef.h>
+#include <vector>
+
+static const float DEFAULT_LINE_GRID_CELL = 2.0f; // cm
+
+class LineGrid
+{
+public:
+    LineGrid();
+    virtual ~LineGrid();
+
+    // Compute the distances from the field lines, over the green
+    void build(float cellSize = DEFAULT_LINE_GRID_CELL);
+    // Map an .lgd file; false if it can't be opened or isn't one
+    bool map(const char *filename);
+    bool write(FILE *fp) const;
+    // Let go of the distances; every lookup is then 0
+    void release();
+
+    /**
+     * @return The distance in cm from (x, y) to the nearest field line,
+     *         to within half a cell's diagonal
+     */
+    inline float distance(float x, float y) const {
+        int i = static_cast<int>((x - originX) * invCellSize);
+        int j = static_cast<int>((y - originY) * invCellSize);
+        i = i < 0 ? 0 : (i >= width ? width - 1 : i);
+        j = j < 0 ? 0 : (j >= height ? height - 1 : j);
+        return static_cast<float>(cells[j * width + i]) * 0.1f;
+    }
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    float getCellSize() const { return cellSize; }
+    bool isMapped() const { return mapping != 0; }
+
+private:
+    // not copyable, the mapping belongs to us
+    LineGrid(const LineGrid&);
+    LineGrid& operator=(const LineGrid&);
+
+    void setSize(int _width, int _height, float _originX, float _originY,
+                 float _cellSize);
+
+    int width;
+    int height;
+    float originX;
+    float originY;
+    float cellSize;
+    float invCellSize;
+    const unsigned short *cells;
+    void *mapping;
+    size_t mappingSize;
+    std::vector<unsigned short> memory;
+};
+
+#endif // LineGrid_h_DEFINED
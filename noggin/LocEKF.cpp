@@ -126,10 +126,14 @@ void LocEKF::redGoalieReset()
  * Method to deal with updating the entire loc model
  *
  * @param u The odometry since the last frame
- * @param Z The observations from the current frame
+ * @param Z_t The observations from the current frame
  */
-void LocEKF::updateLocalization(MotionModel u, vector<Observation> Z)
+void LocEKF::updateLocalization(const MotionModel& u,
+                                const vector<Observation>& Z_t)
 {
+    // Local copy, ambiguous observations may be dropped from it below
+    vector<Observation> Z(Z_t);
+
 #ifdef DEBUG_LOC_EKF_INPUTS
     cout << "Loc update: " << endl;
     cout << "Before updates: " << *this << endl;
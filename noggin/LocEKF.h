@@ -37,7 +37,8 @@ public:
     virtual ~LocEKF() {}
 
     // Update functions
-    virtual void updateLocalization(MotionModel u, std::vector<Observation> Z);
+    virtual void updateLocalization(const MotionModel& u,
+                                    const std::vector<Observation>& Z_t);
     virtual void reset();
     virtual void redGoalieReset();
     virtual void blueGoalieReset();
@@ -16,8 +16,8 @@ class LocSystem
 public:
     virtual ~LocSystem() {};
     // Core Functions
-    virtual void updateLocalization(MotionModel u_t,
-                                    std::vector<Observation> z_t) = 0;
+    virtual void updateLocalization(const MotionModel& u_t,
+                                    const std::vector<Observation>& z_t) = 0;
     virtual void reset() = 0;
     // These should be made pure virtual and the implementing MCL class should
     // be forced to implement them
@@ -7,9 +7,21 @@
  */
 
 #include "MCL.h"
+#include "LineGrid.h"
 #include "NBMath.h"
 #include <time.h> // for srand(time(NULL))
 #include <cstdlib> // for MAX_RAND
+#include <iostream>
+
+#ifdef MCL_VECTOR_KERNEL
+#  if defined(__AVX2__)
+#    include <immintrin.h>
+#  else
+#    include <emmintrin.h>
+#  endif
+#  include "Common.h" // for micro_time()
+#endif
+
 using namespace std;
 #define MAX_CHANGE_X 5.0f
 #define MAX_CHANGE_Y 5.0f
@@ -17,28 +29,38 @@ using namespace std;
 #define MAX_CHANGE_F 5.0f
 #define MAX_CHANGE_L 5.0f
 #define MAX_CHANGE_R M_PI_FLOAT / 16.0f
-#define UNIFORM_1_NEG_1 (2.0f*(static_cast<float>(rand()) / (static_cast<float>(RAND_MAX)+1)) - 1.0f)
+
+// Size of the KLD sampling histogram
+static const int KLD_BINS_X = static_cast<int>(FIELD_WIDTH / KLD_BIN_XY) + 1;
+static const int KLD_BINS_Y = static_cast<int>(FIELD_HEIGHT / KLD_BIN_XY) + 1;
+static const int KLD_BINS_H = static_cast<int>(2.0f * M_PI_FLOAT /
+                                               KLD_BIN_H) + 1;
 
 /**
  * Initializes the sampel sets so that the first update works appropriately
  */
-MCL::MCL(int _M) : useBest(false), lastOdo(0,0,0), frameCounter(0), M(_M)
+MCL::MCL(int _M) : useBest(false), useVectorLikelihood(false),
+                   useProportionalResample(false), useKLDSampling(false),
+                   resampleThreshold(DEFAULT_RESAMPLE_THRESHOLD),
+                   minParticles(min(_M, KLD_MIN_PARTICLES)),
+                   lastOdo(0,0,0), numLastObservations(0), frameCounter(0),
+                   maxParticles(_M), M(_M)
 {
+    // All particle storage is allocated here, updates reuse it
+    X_t.resize(maxParticles);
+    X_bar_t.resize(maxParticles);
+    logWeights.resize(paddedParticles(maxParticles));
+    obsLogWeights.resize(paddedParticles(maxParticles));
+    headCos.resize(paddedParticles(maxParticles));
+    headSin.resize(paddedParticles(maxParticles));
+    parents.resize(maxParticles);
+    binWeights.resize(KLD_BINS_X * KLD_BINS_Y * KLD_BINS_H);
+    occupiedBins.reserve(maxParticles);
+
     // Initialize particles to be randomly spread about the field...
     srand(time(NULL));
-    for (int m = 0; m < M; ++m) {
-        //Particle p_m;
-        // X bounded by width of the field
-        // Y bounded by height of the field
-        // H between +-pi
-        PoseEst x_m(static_cast<float>(rand() % static_cast<int>(FIELD_WIDTH)),
-                    static_cast<float>(rand() % static_cast<int>(FIELD_HEIGHT)),
-                    UNIFORM_1_NEG_1 * (M_PI_FLOAT / 2.0f));
-        Particle p_m(x_m, 1.0f);
-        X_t.push_back(p_m);
-    }
-
-    updateEstimates();
+    seed = static_cast<unsigned int>(time(NULL));
+    reset();
 }
 
 MCL::~MCL()
@@ -51,17 +73,18 @@ MCL::~MCL()
 void MCL::reset()
 {
     frameCounter = 0;
+    M = maxParticles;
 
     for (int m = 0; m < M; ++m) {
-        //Particle p_m;
+        ParticleRandom random(seed, frameCounter,
+                              ParticleRandom::RESET_STREAM, m);
         // X bounded by width of the field
         // Y bounded by height of the field
         // H between +-pi
-        PoseEst x_m(static_cast<float>(rand() % static_cast<int>(FIELD_WIDTH)),
-                    static_cast<float>(rand() % static_cast<int>(FIELD_HEIGHT)),
-                    UNIFORM_1_NEG_1 * (M_PI_FLOAT / 2.0f));
-        Particle p_m(x_m, 1.0f);
-        X_t.push_back(p_m);
+        X_t.x[m] = random.uniform() * FIELD_WIDTH;
+        X_t.y[m] = random.uniform() * FIELD_HEIGHT;
+        X_t.h[m] = (2.0f * random.uniform() - 1.0f) * (M_PI_FLOAT / 2.0f);
+        X_t.w[m] = 1.0f;
     }
 
     updateEstimates();
@@ -73,37 +96,39 @@ void MCL::reset()
  *
  * @param u_t The motion (odometery) change since the last update.
  * @param z_t The set of landmark observations in the current frame.
- * @param resample Should we resample during this update
- * @return The set of particles representing the estimate of the current frame.
  */
-void MCL::updateLocalization(MotionModel u_t, vector<Observation> z_t)
+void MCL::updateLocalization(const MotionModel& u_t,
+                             const vector<Observation>& z_t)
 {
     frameCounter++;
-    // Set the current particles to be of time minus one.
-    vector<Particle> X_t_1 = X_t;
-    // Clar the current set
-    X_t.clear();
-    vector<Particle> X_bar_t; // A priori estimates
-    float totalWeights = 0.; // Must sum all weights for future use
-
-    // Run through the particles
-    for (int m = 0; m < M; ++m) {
-        Particle x_t_m;
-
-        // Update motion model for the particle
-        x_t_m.pose = updateMotionModel(X_t_1[m].pose, u_t);
-        // Update measurement model
-        x_t_m.weight = updateMeasurementModel(z_t, x_t_m.pose);
-        totalWeights += x_t_m.weight;
-        // Add the particle to the current frame set
-        X_bar_t.push_back(x_t_m);
+    lastOdo = u_t;
+    // Copied in place, so once the storage has grown to what is seen an
+    // update makes no allocations
+    if (lastObservations.size() < z_t.size()) {
+        lastObservations.resize(z_t.size());
     }
-
-    // Resample the particles
-    if (frameCounter % 1 == 0) {
-        resample(&X_bar_t, totalWeights);
+    for (unsigned int i = 0; i < z_t.size(); ++i) {
+        lastObservations[i] = z_t[i];
+    }
+    numLastObservations = static_cast<unsigned int>(z_t.size());
+
+    // Run through the particles, writing the a priori estimates into X_bar_t
+    UpdateJob predict(this, UpdateJob::PREDICT, &u_t, 0);
+    runJob(&predict);
+
+    // Update measurement model
+    // Must sum all weights for future use
+    const float totalWeights = weighParticles(z_t, useVectorLikelihood);
+
+    // Resample the particles once their weights have degenerated
+    if (useProportionalResample) {
+        resample(totalWeights);
+    } else if (normalizeWeights(totalWeights) <
+               resampleThreshold * static_cast<float>(M) ||
+               resampleThreshold >= 1.0f) {
+        lowVarianceResample(kldParticles());
     } else {
-        noResample(&X_bar_t);
+        noResample();
     }
 
     // Update pose and uncertainty estimates
@@ -111,21 +136,129 @@ void MCL::updateLocalization(MotionModel u_t, vector<Observation> z_t)
 
 }
 
+/**
+ * Spreads the per particle steps of an update over the worker threads, or
+ * runs them here if there are none.
+ */
+void MCL::setThreads(int threads)
+{
+    if (threads > 1) {
+        workers = boost::shared_ptr<ParticleWorkers>(
+            new ParticleWorkers(threads));
+    } else {
+        workers.reset();
+    }
+}
+
+int MCL::getThreads() const
+{
+    return workers ? workers->getNumThreads() : 1;
+}
+
+void MCL::runJob(UpdateJob *job)
+{
+    if (workers) {
+        workers->run(job, M, PARTICLE_PAD);
+    } else {
+        job->run(0, M);
+    }
+}
+
+/**
+ * Runs one step of the update on particles [first, last).  Every particle
+ * draws from its own random streams and writes only its own slots, so the
+ * result does not depend on how the particles are split between threads.
+ */
+void MCL::UpdateJob::run(int first, int last)
+{
+    switch (step) {
+    case PREDICT:
+        for (int m = first; m < last; ++m) {
+            // Update motion model for the particle
+            ParticleRandom random(mcl->seed, mcl->frameCounter,
+                                  ParticleRandom::MOTION_STREAM, m);
+            const PoseEst x_t_m =
+                mcl->updateMotionModel(PoseEst(mcl->X_t.x[m],
+                                               mcl->X_t.y[m],
+                                               mcl->X_t.h[m]), *u_t, random);
+            mcl->X_bar_t.x[m] = x_t_m.x;
+            mcl->X_bar_t.y[m] = x_t_m.y;
+            mcl->X_bar_t.h[m] = x_t_m.h;
+        }
+        break;
+    case WEIGH:
+        for (int m = first; m < last; ++m) {
+            mcl->X_bar_t.w[m] =
+                mcl->updateMeasurementModel(*z_t,
+                                            PoseEst(mcl->X_bar_t.x[m],
+                                                    mcl->X_bar_t.y[m],
+                                                    mcl->X_bar_t.h[m]));
+        }
+        break;
+#ifdef MCL_VECTOR_KERNEL
+    case WEIGH_VECTOR:
+        mcl->vectorLogWeights(*z_t, first, last);
+        break;
+    case EXPONENTIATE:
+        mcl->exponentiateWeights(first, last);
+        break;
+#endif
+    case WALK:
+        for (int n = first; n < last; ++n) {
+            mcl->randomWalkParticle(mcl->parents[n], n);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * Weighs every particle of X_bar_t against the observations.
+ *
+ * @param z_t          The landmark observations for the current frame.
+ * @param vectorKernel Use the log space vector kernel if it is built
+ * @return The sum of the particle weights
+ */
+float MCL::weighParticles(const vector<Observation>& z_t, bool vectorKernel)
+{
+#ifdef MCL_VECTOR_KERNEL
+    if (vectorKernel) {
+        UpdateJob weigh(this, UpdateJob::WEIGH_VECTOR, 0, &z_t);
+        runJob(&weigh);
+        UpdateJob exponentiate(this, UpdateJob::EXPONENTIATE, 0, 0);
+        runJob(&exponentiate);
+    } else
+#endif
+    {
+        UpdateJob weigh(this, UpdateJob::WEIGH, 0, &z_t);
+        runJob(&weigh);
+    }
+
+    // Summed in order so the total is the same with any number of threads
+    float totalWeights = 0.;
+    for (int m = 0; m < M; ++m) {
+        totalWeights += X_bar_t.w[m];
+    }
+    return totalWeights;
+}
+
 /**
  * Update a particle's pose based on the last motion model.
  * We sample the pose with noise proportional to the odometery update.
  *
  * @param x_t_1 The robot pose from the pervious position distribution
  * @param u_t The odometry update from the last frame
+ * @param random The particle's motion stream
  *
  * @return A new robot pose sampled on the odometry update
  */
-PoseEst MCL::updateMotionModel(PoseEst x_t, MotionModel u_t)
+PoseEst MCL::updateMotionModel(PoseEst x_t, MotionModel u_t,
+                               ParticleRandom& random)
 {
-    lastOdo = u_t;
-    u_t.deltaF -= sampleNormalDistribution(fabs(u_t.deltaF));
-    u_t.deltaL -= sampleNormalDistribution(fabs(u_t.deltaL));
-    u_t.deltaR -= sampleNormalDistribution(fabs(u_t.deltaR));
+    u_t.deltaF -= random.normal(fabs(u_t.deltaF));
+    u_t.deltaL -= random.normal(fabs(u_t.deltaL));
+    u_t.deltaR -= random.normal(fabs(u_t.deltaR));
 
     // u_t.deltaF -= sampleTriangularDistribution(fabs(u_t.deltaF));
     // u_t.deltaL -= sampleTriangularDistribution(fabs(u_t.deltaL));
@@ -147,94 +280,633 @@ PoseEst MCL::updateMotionModel(PoseEst x_t, MotionModel u_t)
  * @param m The particle ID
  * @return The particle weight
  */
-float MCL::updateMeasurementModel(vector<Observation> z_t, PoseEst x_t)
+float MCL::updateMeasurementModel(const vector<Observation>& z_t,
+                                  const PoseEst& x_t)
 {
     // Give the particle a weight of 1 to begin with
     float w = 1;
 
-    //cout << "New Particle" << endl;
     // Determine the likelihood of each observation
     for (unsigned int i = 0; i < z_t.size(); ++i) {
+        const Observation& z = z_t[i];
+
+        if (z.isLine() && lineGrid) {
+            w *= determineLineGridWeight(z, x_t);
+            continue;
+        }
 
         // Determine the most likely match
         float p = 0; // Combined probability of observation
         float pMax = -1; // Maximum combined probability
 
-        // Get local copies of our possible landmarks
-        vector<LineLandmark> possibleLines = z_t[i].getLinePossibilities();
-        vector<PointLandmark> possiblePoints = z_t[i].getPointPossibilities();
-
         // Loop through all possible landmarks
         // If the observation is distinct, there will only be one possibility
-        for (unsigned int j = 0; j < z_t[i].getNumPossibilities(); ++j) {
-            if (z_t[i].isLine()) {
-                p = determineLineWeight(z_t[i], x_t, possibleLines[j]);
+        for (unsigned int j = 0; j < z.getNumPossibilities(); ++j) {
+            if (z.isLine()) {
+                p = determineLineWeight(z, x_t, z.getLinePossibilities()[j]);
             } else {
-                p = determinePointWeight(z_t[i], x_t, possiblePoints[j]);
+                p = determinePointWeight(z, x_t, z.getPointPossibilities()[j]);
             }
 
-            //cout << "p is: " << p << " ";
             if( p > pMax) {
                 pMax = p;
             }
         }
-        //cout << "pMax is: " << pMax << endl;
         w *= pMax;
     }
 
     return w; // The combined weight of all observations
 }
 
+#ifdef MCL_VECTOR_KERNEL
+/*
+ * Vector helpers for the likelihood kernel.  vfloat holds VLANES particles'
+ * worth of one quantity.
+ */
+#if defined(__AVX2__)
+typedef __m256 vfloat;
+static const int VLANES = 8;
+
+static inline vfloat vset(float f) { return _mm256_set1_ps(f); }
+static inline vfloat vload(const float *p) { return _mm256_loadu_ps(p); }
+static inline void vstore(float *p, vfloat a) { _mm256_storeu_ps(p, a); }
+static inline vfloat vadd(vfloat a, vfloat b) { return _mm256_add_ps(a, b); }
+static inline vfloat vsub(vfloat a, vfloat b) { return _mm256_sub_ps(a, b); }
+static inline vfloat vmul(vfloat a, vfloat b) { return _mm256_mul_ps(a, b); }
+static inline vfloat vdiv(vfloat a, vfloat b) { return _mm256_div_ps(a, b); }
+static inline vfloat vmax(vfloat a, vfloat b) { return _mm256_max_ps(a, b); }
+static inline vfloat vmin(vfloat a, vfloat b) { return _mm256_min_ps(a, b); }
+static inline vfloat vsqrt(vfloat a) { return _mm256_sqrt_ps(a); }
+static inline vfloat vand(vfloat a, vfloat b) { return _mm256_and_ps(a, b); }
+static inline vfloat vor(vfloat a, vfloat b) { return _mm256_or_ps(a, b); }
+// ~a & b
+static inline vfloat vandnot(vfloat a, vfloat b) {
+    return _mm256_andnot_ps(a, b);
+}
+static inline vfloat vlt(vfloat a, vfloat b) {
+    return _mm256_cmp_ps(a, b, _CMP_LT_OQ);
+}
+// mask ? a : b
+static inline vfloat vselect(vfloat mask, vfloat a, vfloat b) {
+    return _mm256_blendv_ps(b, a, mask);
+}
+static inline vfloat vround(vfloat a) {
+    return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+}
+// 2^n for whole numbers n in the normal range
+static inline vfloat vpow2(vfloat n) {
+    const __m256i e = _mm256_add_epi32(_mm256_cvtps_epi32(n),
+                                       _mm256_set1_epi32(127));
+    return _mm256_castsi256_ps(_mm256_slli_epi32(e, 23));
+}
+#else
+typedef __m128 vfloat;
+static const int VLANES = 4;
+
+static inline vfloat vset(float f) { return _mm_set1_ps(f); }
+static inline vfloat vload(const float *p) { return _mm_loadu_ps(p); }
+static inline void vstore(float *p, vfloat a) { _mm_storeu_ps(p, a); }
+static inline vfloat vadd(vfloat a, vfloat b) { return _mm_add_ps(a, b); }
+static inline vfloat vsub(vfloat a, vfloat b) { return _mm_sub_ps(a, b); }
+static inline vfloat vmul(vfloat a, vfloat b) { return _mm_mul_ps(a, b); }
+static inline vfloat vdiv(vfloat a, vfloat b) { return _mm_div_ps(a, b); }
+static inline vfloat vmax(vfloat a, vfloat b) { return _mm_max_ps(a, b); }
+static inline vfloat vmin(vfloat a, vfloat b) { return _mm_min_ps(a, b); }
+static inline vfloat vsqrt(vfloat a) { return _mm_sqrt_ps(a); }
+static inline vfloat vand(vfloat a, vfloat b) { return _mm_and_ps(a, b); }
+static inline vfloat vor(vfloat a, vfloat b) { return _mm_or_ps(a, b); }
+// ~a & b
+static inline vfloat vandnot(vfloat a, vfloat b) { return _mm_andnot_ps(a, b); }
+static inline vfloat vlt(vfloat a, vfloat b) { return _mm_cmplt_ps(a, b); }
+// mask ? a : b
+static inline vfloat vselect(vfloat mask, vfloat a, vfloat b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+static inline vfloat vround(vfloat a) {
+    return _mm_cvtepi32_ps(_mm_cvtps_epi32(a));
+}
+// 2^n for whole numbers n in the normal range
+static inline vfloat vpow2(vfloat n) {
+    const __m128i e = _mm_add_epi32(_mm_cvtps_epi32(n), _mm_set1_epi32(127));
+    return _mm_castsi128_ps(_mm_slli_epi32(e, 23));
+}
+#endif
+
+// All lanes set if b, none otherwise
+static inline vfloat vmask(bool b) {
+    return b ? vlt(vset(0.0f), vset(1.0f)) : vset(0.0f);
+}
+
+/**
+ * Polynomial atan2.  The odd minimax polynomial for atan on [0,1] is within
+ * 1.0e-5 radians of atan2(), the octant is then restored from the signs and
+ * magnitudes of x and y.  atan2(0,0) comes out as 0.
+ */
+static inline vfloat vatan2(vfloat y, vfloat x)
+{
+    const vfloat sign = vset(-0.0f);
+    const vfloat ax = vandnot(sign, x);
+    const vfloat ay = vandnot(sign, y);
+    const vfloat z = vdiv(vmin(ax, ay),
+                          vmax(vmax(ax, ay), vset(1.0e-30f)));
+    const vfloat s = vmul(z, z);
+
+    vfloat p = vset(-0.01172120f);
+    p = vadd(vmul(p, s), vset(0.05265332f));
+    p = vadd(vmul(p, s), vset(-0.11643287f));
+    p = vadd(vmul(p, s), vset(0.19354346f));
+    p = vadd(vmul(p, s), vset(-0.33262347f));
+    p = vadd(vmul(p, s), vset(0.99997726f));
+    p = vmul(p, z);
+
+    p = vselect(vlt(ax, ay), vsub(vset(M_PI_FLOAT / 2.0f), p), p);
+    p = vselect(vlt(x, vset(0.0f)), vsub(vset(M_PI_FLOAT), p), p);
+    return vor(p, vand(sign, y));
+}
+
+/**
+ * exp() for arguments <= 0, with a relative error under 2.0e-7.  The
+ * argument is split as n*ln(2) + r with |r| <= ln(2)/2; e^r comes from a
+ * degree 6 polynomial and 2^n is put straight into the exponent bits.
+ * Anything below -87, where floats go denormal, returns 0.
+ */
+static inline vfloat vexp(vfloat x)
+{
+    const vfloat tooSmall = vlt(x, vset(-87.0f));
+    x = vmax(x, vset(-87.0f));
+
+    const vfloat n = vround(vmul(x, vset(1.44269504f)));
+    // ln(2) in two parts so n*ln(2) is exact enough
+    const vfloat r = vsub(vsub(x, vmul(n, vset(0.693359375f))),
+                          vmul(n, vset(-2.12194440e-4f)));
+
+    vfloat p = vset(1.9875691500e-4f);
+    p = vadd(vmul(p, r), vset(1.3981999507e-3f));
+    p = vadd(vmul(p, r), vset(8.3334519073e-3f));
+    p = vadd(vmul(p, r), vset(4.1665795894e-2f));
+    p = vadd(vmul(p, r), vset(1.6666665459e-1f));
+    p = vadd(vmul(p, r), vset(5.0000001201e-1f));
+    p = vadd(vadd(vmul(vmul(p, r), r), r), vset(1.0f));
+
+    return vandnot(tooSmall, vmul(p, vpow2(n)));
+}
+
+/**
+ * Log similarity of VLANES particles to a point seen at distance zd and
+ * bearing zb, the log of getSimilarity() before its MIN_SIMILARITY floor.
+ */
+static inline vfloat vpointLogWeight(vfloat x, vfloat y, vfloat h,
+                                     vfloat px, vfloat py,
+                                     vfloat zd, vfloat zb,
+                                     vfloat invVarD, vfloat invVarA)
+{
+    const vfloat dx = vsub(px, x);
+    const vfloat dy = vsub(py, y);
+    const vfloat d_hat = vsqrt(vadd(vmul(dx, dx), vmul(dy, dy)));
+    const vfloat a_hat = vsub(vatan2(dy, dx), h);
+
+    const vfloat r_d = vsub(zd, d_hat);
+    const vfloat r_a = vsub(zb, a_hat);
+    return vsub(vset(0.0f), vadd(vmul(vmul(r_d, r_d), invVarD),
+                                 vmul(vmul(r_a, r_a), invVarA)));
+}
+
+/**
+ * Computes the log weights of particles [first, last) of X_bar_t, VLANES
+ * particles at a time.  Gives the same weights as updateMeasurementModel(),
+ * each observation floored at MIN_SIMILARITY so one outlier can't rule a
+ * particle out, but sums log similarities instead of multiplying
+ * similarities.  first must be a multiple of PARTICLE_PAD; a range ending
+ * at M runs on into the padding.
+ *
+ * @param z_t The landmark observations for the current frame.
+ */
+void MCL::vectorLogWeights(const vector<Observation>& z_t,
+                           int first, int last)
+{
+    const int padded = min(paddedParticles(last), paddedParticles(M));
+    float *logW = &logWeights[0];
+    float *obsW = &obsLogWeights[0];
+    const float *xs = &X_bar_t.x[0];
+    const float *ys = &X_bar_t.y[0];
+    const float *hs = &X_bar_t.h[0];
+    const vfloat minLogW = vset(logf(MIN_SIMILARITY));
+
+    for (int m = first; m < padded; m += VLANES) {
+        vstore(logW + m, vset(0.0f));
+    }
+
+    // The line grid turns each line into a point on the field through the
+    // particle's heading, worked out once for all the lines seen
+    bool gridLines = false;
+    for (unsigned int i = 0; lineGrid && i < z_t.size(); ++i) {
+        gridLines = gridLines || z_t[i].isLine();
+    }
+    if (gridLines) {
+        for (int m = first; m < padded; ++m) {
+            headCos[m] = cosf(hs[m]);
+            headSin[m] = sinf(hs[m]);
+        }
+    }
+
+    for (unsigned int i = 0; i < z_t.size(); ++i) {
+        const Observation& z = z_t[i];
+
+        if (z.isLine() && gridLines) {
+            // As determineLineGridWeight(), one lookup per particle
+            const float d = z.getVisDistance();
+            const float dCos = d * cosf(z.getVisBearing());
+            const float dSin = d * sinf(z.getVisBearing());
+            const float invVarD = 1.0f / (z.getDistanceSD() *
+                                          z.getDistanceSD());
+            const float maxCost = -logf(LINE_GRID_MIN_SIMILARITY);
+            const LineGrid& grid = *lineGrid;
+            for (int m = first; m < padded; ++m) {
+                const float r =
+                    grid.distance(xs[m] + headCos[m] * dCos -
+                                  headSin[m] * dSin,
+                                  ys[m] + headSin[m] * dCos +
+                                  headCos[m] * dSin);
+                logW[m] -= min(r * r * invVarD, maxCost);
+            }
+            continue;
+        }
+
+        // The scalar model multiplies by -1 here; skip it instead
+        if (z.getNumPossibilities() == 0) {
+            continue;
+        }
+
+        const vfloat zd = vset(z.getVisDistance());
+        const vfloat zb = vset(z.getVisBearing());
+        const vfloat invVarD = vset(1.0f / (z.getDistanceSD() *
+                                            z.getDistanceSD()));
+        const vfloat invVarA = vset(1.0f / (z.getBearingSD() *
+                                            z.getBearingSD()));
+
+        for (int m = first; m < padded; m += VLANES) {
+            vstore(obsW + m, vset(static_cast<float>(-HUGE_VAL)));
+        }
+
+        // Keep the best match over all possible landmarks
+        for (unsigned int j = 0; j < z.getNumPossibilities(); ++j) {
+            if (!z.isLine()) {
+                const PointLandmark& pt = z.getPointPossibilities()[j];
+                const vfloat px = vset(pt.x);
+                const vfloat py = vset(pt.y);
+                for (int m = first; m < padded; m += VLANES) {
+                    const vfloat p = vpointLogWeight(vload(xs + m),
+                                                     vload(ys + m),
+                                                     vload(hs + m),
+                                                     px, py, zd, zb,
+                                                     invVarD, invVarA);
+                    vstore(obsW + m, vmax(vload(obsW + m), p));
+                }
+                continue;
+            }
+
+            // Lines follow determineLineWeight(): the expected point is the
+            // foot on the line, or the nearer end if the foot is off the
+            // segment.  Which case applies depends only on the line.
+            const LineLandmark& line = z.getLinePossibilities()[j];
+            const bool vertical = line.x2 - line.x1 == 0;
+            const float slope = vertical ? 0.0f :
+                (line.y2 - line.y1) / (line.x2 - line.x1);
+            const vfloat m_v = vset(slope);
+            const vfloat scale = vset(slope / (2*slope + 1));
+            const vfloat x1 = vset(line.x1), y1 = vset(line.y1);
+            const vfloat x2 = vset(line.x2), y2 = vset(line.y2);
+            const vfloat minX = vset(min(line.x1, line.x2));
+            const vfloat maxX = vset(max(line.x1, line.x2));
+            const vfloat minY = vset(min(line.y1, line.y2));
+            const vfloat maxY = vset(max(line.y1, line.y2));
+            const vfloat checkX = vmask(line.x1 != line.x2);
+            const vfloat checkY = vmask(line.y1 != line.y2);
+
+            for (int m = first; m < padded; m += VLANES) {
+                const vfloat x = vload(xs + m);
+                const vfloat y = vload(ys + m);
+
+                vfloat ptx, pty;
+                if (vertical) {
+                    ptx = x1;
+                    pty = y;
+                } else if (slope == 0) {
+                    ptx = x;
+                    pty = y1;
+                } else {
+                    ptx = vmul(vadd(vadd(vsub(y1, y), vmul(m_v, x1)),
+                                    vmul(m_v, x)), scale);
+                    pty = vadd(vmul(m_v, vsub(ptx, x1)), y1);
+                }
+
+                const vfloat outside =
+                    vor(vand(checkX, vor(vlt(ptx, minX), vlt(maxX, ptx))),
+                        vand(checkY, vor(vlt(pty, minY), vlt(maxY, pty))));
+
+                const vfloat dx1 = vsub(x1, x), dy1 = vsub(y1, y);
+                const vfloat dx2 = vsub(x2, x), dy2 = vsub(y2, y);
+                const vfloat nearFirst =
+                    vlt(vadd(vmul(dx1, dx1), vmul(dy1, dy1)),
+                        vadd(vmul(dx2, dx2), vmul(dy2, dy2)));
+                const vfloat px = vselect(outside,
+                                          vselect(nearFirst, x1, x2), ptx);
+                const vfloat py = vselect(outside,
+                                          vselect(nearFirst, y1, y2), pty);
+
+                const vfloat p = vpointLogWeight(x, y, vload(hs + m),
+                                                 px, py, zd, zb,
+                                                 invVarD, invVarA);
+                vstore(obsW + m, vmax(vload(obsW + m), p));
+            }
+        }
+
+        for (int m = first; m < padded; m += VLANES) {
+            vstore(logW + m, vadd(vload(logW + m),
+                                  vmax(vload(obsW + m), minLogW)));
+        }
+    }
+
+}
+
+/**
+ * Turns the log weights of particles [first, last) into weights.  They are
+ * not rescaled: as with the scalar model's product, when every particle
+ * misses several observations they all underflow and normalizeWeights()
+ * takes the frame as telling us nothing, rather than trusting the least
+ * wrong particles after a kidnapping.
+ */
+void MCL::exponentiateWeights(int first, int last)
+{
+    const int padded = min(paddedParticles(last), paddedParticles(M));
+    const float *logW = &logWeights[0];
+    float *ws = &X_bar_t.w[0];
+    for (int m = first; m < padded; m += VLANES) {
+        vstore(ws + m, vexp(vload(logW + m)));
+    }
+}
+
+/**
+ * Checks the vector likelihood kernel against the scalar measurement model
+ * on the current particles and prints how long each takes.  The log weight
+ * of every particle, floored observations and all, must agree to within
+ * 1.0e-4 relative or 1.0e-3 absolute.  Meant to be run from offline tools;
+ * leaves the current particles alone.
+ *
+ * @param z_t        Observations to weigh the particles against
+ * @param iterations How many times to time each model
+ * @return           true if every particle agreed
+ */
+bool MCL::compareLikelihoodKernels(const vector<Observation>& z_t,
+                                   int iterations)
+{
+    X_bar_t.x = X_t.x;
+    X_bar_t.y = X_t.y;
+    X_bar_t.h = X_t.h;
+
+    long long start = micro_time();
+    for (int i = 0; i < iterations; ++i) {
+        weighParticles(z_t, false);
+    }
+    const long long scalarTime = micro_time() - start;
+
+    start = micro_time();
+    for (int i = 0; i < iterations; ++i) {
+        weighParticles(z_t, true);
+    }
+    const long long vectorTime = micro_time() - start;
+
+    // Reference log weights from the scalar model, per observation so the
+    // product can't underflow; the floored ones are counted
+    int floored = 0, mismatches = 0;
+    float maxAbsError = 0, maxRelError = 0;
+    for (int m = 0; m < M; ++m) {
+        const PoseEst x_t(X_bar_t.x[m], X_bar_t.y[m], X_bar_t.h[m]);
+        double reference = 0;
+        bool floor = false;
+        for (unsigned int i = 0; i < z_t.size(); ++i) {
+            if (z_t[i].getNumPossibilities() == 0 &&
+                !(lineGrid && z_t[i].isLine())) {
+                continue;
+            }
+            vector<Observation> one(1, z_t[i]);
+            const float p = updateMeasurementModel(one, x_t);
+            floor = floor || p <= MIN_SIMILARITY;
+            reference += log(static_cast<double>(p));
+        }
+        if (floor) {
+            ++floored;
+        }
+
+        const float absError = static_cast<float>(fabs(logWeights[m] -
+                                                       reference));
+        const float relError = absError /
+            max(1.0f, static_cast<float>(fabs(reference)));
+        maxAbsError = max(maxAbsError, absError);
+        maxRelError = max(maxRelError, relError);
+        if (absError > 1.0e-3f && relError > 1.0e-4f) {
+            ++mismatches;
+        }
+    }
+
+    const float evaluations = static_cast<float>(M) *
+        static_cast<float>(iterations);
+    const ios_base::fmtflags flags = cout.flags();
+    const streamsize precision = cout.precision(3);
+    cout << "likelihood: scalar " << fixed
+         << static_cast<float>(scalarTime) * 1000.0f / evaluations
+         << " ns/particle, vector "
+         << static_cast<float>(vectorTime) * 1000.0f / evaluations
+         << " ns/particle (" << VLANES << " lanes), " << floored << " of "
+         << M << " with a floored observation, max log error "
+         << scientific << maxAbsError << " (" << maxRelError
+         << " relative), " << (mismatches == 0 ? "agree" : "MISMATCH")
+         << endl;
+    cout.flags(flags);
+    cout.precision(precision);
+    return mismatches == 0;
+}
+#endif // MCL_VECTOR_KERNEL
+
 /**
  * Method to resample the particles based on a straight proportion of their
  * weights. Adds copies of the paritcle jittered proportional to the weight
- * of the particle
+ * of the particle.  Rounding can leave the new set short of M particles; any
+ * slots left over are filled with jittered copies of the best particle.
  *
- * @param X_bar_t the set of particles before being resampled
  * @param totalWeights the totalWeights of the particle set X_bar_t
  */
-void MCL::resample(std::vector<Particle> * X_bar_t, float totalWeights) {
+void MCL::resample(float totalWeights)
+{
+    int best = 0;
     for (int m = 0; m < M; ++m) {
         // Normalize the particle weights
-        (*X_bar_t)[m].weight /= totalWeights;
+        X_bar_t.w[m] /= totalWeights;
+        if (X_bar_t.w[m] > X_bar_t.w[best]) {
+            best = m;
+        }
+    }
 
-        int count = int(round(float(M) * (*X_bar_t)[m].weight));
-        for (int i = 0; i < count; ++i) {
-            // Random walk the particles
-            X_t.push_back(randomWalkParticle((*X_bar_t)[m]));
-            //X_t.push_back(X_bar_t[m]);
+    int n = 0;
+    for (int m = 0; m < M && n < M; ++m) {
+        int count = int(round(float(M) * X_bar_t.w[m]));
+        for (int i = 0; i < count && n < M; ++i, ++n) {
+            parents[n] = m;
         }
     }
+
+    for (; n < M; ++n) {
+        parents[n] = best;
+    }
+
+    // Random walk the particles
+    UpdateJob walk(this, UpdateJob::WALK, 0, 0);
+    runJob(&walk);
 }
 
-void MCL::lowVarianceResample(std::vector<Particle> * X_bar_t,
-                              float totalWeights) {
-    float r = ((static_cast<float>(rand()) /
-				static_cast<float>(RAND_MAX)) *
-			   (1.0f/static_cast<float>(M) ));
-    float c = (*X_bar_t)[0].weight / totalWeights;
-    int i = 0;
+/**
+ * Folds the weights the particles carried from the last frame into the new
+ * ones and normalizes them.  Weights only carry over when the last frame
+ * did not resample; after resampling they are all equal.  If every weight
+ * underflowed the particles start over equally weighted.
+ *
+ * @param totalWeights the totalWeights of the particle set X_bar_t
+ * @return The effective sample size, 1 / sum(w^2)
+ */
+float MCL::normalizeWeights(float totalWeights)
+{
+    totalWeights = 0.;
     for (int m = 0; m < M; ++m) {
+        X_bar_t.w[m] *= X_t.w[m];
+        totalWeights += X_bar_t.w[m];
+    }
 
-        float U = r = static_cast<float>(m) * (1.0f/static_cast<float>(M));
+    if (!(totalWeights > 0.0f)) {
+        const float w = 1.0f / static_cast<float>(M);
+        for (int m = 0; m < M; ++m) {
+            X_bar_t.w[m] = w;
+        }
+        return static_cast<float>(M);
+    }
 
-        // Normalize the particle weights
-        (*X_bar_t)[m].weight /= totalWeights;
+    float sumSquares = 0.;
+    for (int m = 0; m < M; ++m) {
+        X_bar_t.w[m] /= totalWeights;
+        sumSquares += X_bar_t.w[m] * X_bar_t.w[m];
+    }
+    return 1.0f / sumSquares;
+}
+
+/**
+ * @return The KLD sampling histogram bin of a pose
+ */
+int MCL::kldBin(float x, float y, float h) const
+{
+    int bx = static_cast<int>(floorf(x / KLD_BIN_XY));
+    int by = static_cast<int>(floorf(y / KLD_BIN_XY));
+    int bh = static_cast<int>(floorf((h + M_PI_FLOAT) / KLD_BIN_H));
+    // Particles may stray off the field
+    bx = max(0, min(KLD_BINS_X - 1, bx));
+    by = max(0, min(KLD_BINS_Y - 1, by));
+    bh = max(0, min(KLD_BINS_H - 1, bh));
+    return (bx * KLD_BINS_Y + by) * KLD_BINS_H + bh;
+}
+
+/**
+ * KLD sampling (Fox 2003): the number of particles needed so that, with
+ * probability 1 - delta, the particles are within KLD_EPSILON of the
+ * posterior, given the number k of histogram bins the posterior occupies.
+ * k is counted from the normalized weights of X_bar_t as the number of
+ * bins a systematic resample of n particles is expected to fill,
+ * sum(min(1, n * binWeight)), and n and k are refined together from
+ * maxParticles down.
+ *
+ * @return The number of particles to resample to
+ */
+int MCL::kldParticles()
+{
+    if (!useKLDSampling) {
+        return maxParticles;
+    }
+
+    for (int m = 0; m < M; ++m) {
+        const int bin = kldBin(X_bar_t.x[m], X_bar_t.y[m], X_bar_t.h[m]);
+        if (binWeights[bin] == 0.0f) {
+            occupiedBins.push_back(bin);
+        }
+        binWeights[bin] += X_bar_t.w[m];
+    }
+
+    int n = maxParticles;
+    for (int i = 0; i < 4; ++i) {
+        float k = 0;
+        for (unsigned int b = 0; b < occupiedBins.size(); ++b) {
+            k += min(1.0f, static_cast<float>(n) * binWeights[occupiedBins[b]]);
+        }
 
-        while ( U > c) {
+        int bound = minParticles;
+        if (k > 1.0f) {
+            const float a = 2.0f / (9.0f * (k - 1.0f));
+            const float c = 1.0f - a + sqrtf(a) * KLD_Z;
+            bound = static_cast<int>(ceilf((k - 1.0f) / (2.0f * KLD_EPSILON) *
+                                           c * c * c));
+        }
+        bound = max(minParticles, min(maxParticles, bound));
+        if (bound == n) {
+            break;
+        }
+        n = bound;
+    }
+
+    for (unsigned int b = 0; b < occupiedBins.size(); ++b) {
+        binWeights[occupiedBins[b]] = 0.0f;
+    }
+    occupiedBins.clear();
+
+    return n;
+}
+
+/**
+ * Low variance (systematic) resampling: a single random offset and newM
+ * evenly spaced pointers into the cumulative weights pick the surviving
+ * particles, in O(M).  The new particles are equally weighted.  Expects
+ * normalized weights.
+ *
+ * @param newM The number of particles to resample to
+ */
+void MCL::lowVarianceResample(int newM)
+{
+    const float step = 1.0f/static_cast<float>(newM);
+    const float r = ParticleRandom(seed, frameCounter,
+                                   ParticleRandom::RESAMPLE_STREAM,
+                                   0).uniform() * step;
+    float c = X_bar_t.w[0];
+    int i = 0;
+    for (int m = 0; m < newM; ++m) {
+        const float U = r + static_cast<float>(m) * step;
+
+        while (U > c && i < M - 1) {
             i++;
-            c += (*X_bar_t)[m].weight;
+            c += X_bar_t.w[i];
         }
-        X_t.push_back(randomWalkParticle((*X_bar_t)[i]));
+        parents[m] = i;
+    }
+
+    M = newM;
+    UpdateJob walk(this, UpdateJob::WALK, 0, 0);
+    runJob(&walk);
+
+    for (int m = 0; m < M; ++m) {
+        X_t.w[m] = step;
     }
 }
+
 /**
  * Prepare for the next update step without resampling the particles
- *
- * @param X_bar_t the set of updated particles
  */
-void MCL::noResample(std::vector<Particle> * X_bar_t) {
-    X_t = *X_bar_t;
+void MCL::noResample()
+{
+    X_t.swap(X_bar_t);
 }
 
 /**
@@ -250,17 +922,17 @@ void MCL::updateEstimates()
     float maxWeight = 0;
 
     // Calculate the weighted mean
-    for (unsigned int i = 0; i < X_t.size(); ++i) {
+    for (int i = 0; i < M; ++i) {
         // Sum the values
-        wMeans.x += X_t[i].pose.x*X_t[i].weight;
-        wMeans.y += X_t[i].pose.y*X_t[i].weight;
-        wMeans.h += X_t[i].pose.h*X_t[i].weight;
+        wMeans.x += X_t.x[i]*X_t.w[i];
+        wMeans.y += X_t.y[i]*X_t.w[i];
+        wMeans.h += X_t.h[i]*X_t.w[i];
         // Sum the weights
-        weightSum += X_t[i].weight;
+        weightSum += X_t.w[i];
 
-        if (X_t[i].weight > maxWeight) {
-            maxWeight = X_t[i].weight;
-            best = X_t[i].pose;
+        if (X_t.w[i] > maxWeight) {
+            maxWeight = X_t.w[i];
+            best = PoseEst(X_t.x[i], X_t.y[i], X_t.h[i]);
         }
     }
 
@@ -271,16 +943,10 @@ void MCL::updateEstimates()
     wMeans.h = NBMath::subPIAngle(wMeans.h);
 
     // Calculate the biased variances
-    for (unsigned int i=0; i < X_t.size(); ++i) {
-        bSDs.x += X_t[i].weight *
-            (X_t[i].pose.x - wMeans.x)*
-            (X_t[i].pose.x - wMeans.x);
-        bSDs.y += X_t[i].weight *
-            (X_t[i].pose.y - wMeans.y)*
-            (X_t[i].pose.y - wMeans.y);
-        bSDs.h += X_t[i].weight *
-            (X_t[i].pose.h - wMeans.h)*
-            (X_t[i].pose.h - wMeans.h);
+    for (int i = 0; i < M; ++i) {
+        bSDs.x += X_t.w[i] * (X_t.x[i] - wMeans.x) * (X_t.x[i] - wMeans.x);
+        bSDs.y += X_t.w[i] * (X_t.y[i] - wMeans.y) * (X_t.y[i] - wMeans.y);
+        bSDs.h += X_t.w[i] * (X_t.h[i] - wMeans.h) * (X_t.h[i] - wMeans.h);
     }
 
     bSDs.x /= weightSum;
@@ -298,6 +964,20 @@ void MCL::updateEstimates()
     curUncert = bSDs;
 }
 
+/**
+ * @return A copy of the current particles, built on demand for logging
+ */
+const vector<Particle> MCL::getParticles() const
+{
+    vector<Particle> particles;
+    particles.reserve(M);
+    for (int m = 0; m < M; ++m) {
+        particles.push_back(Particle(PoseEst(X_t.x[m], X_t.y[m], X_t.h[m]),
+                                     X_t.w[m]));
+    }
+    return particles;
+}
+
 //Helpers
 
 /**
@@ -309,7 +989,8 @@ void MCL::updateEstimates()
  * @param l    the landmark to be used as basis for the observation
  * @return     the probability of the observation
  */
-float MCL::determinePointWeight(Observation z, PoseEst x_t, PointLandmark pt)
+float MCL::determinePointWeight(const Observation& z, const PoseEst& x_t,
+                                const PointLandmark& pt)
 {
     // Expected dist and bearing
     float d_hat;
@@ -338,7 +1019,8 @@ float MCL::determinePointWeight(Observation z, PoseEst x_t, PointLandmark pt)
  * @param l    the landmark to be used as basis for the observation
  * @return     the probability of the observation
  */
-float MCL::determineLineWeight(Observation z, PoseEst x_t, LineLandmark line)
+float MCL::determineLineWeight(const Observation& z, const PoseEst& x_t,
+                               const LineLandmark& line)
 {
     // Distance and bearing for expected point
     float d_hat;
@@ -400,6 +1082,24 @@ float MCL::determineLineWeight(Observation z, PoseEst x_t, LineLandmark line)
     return getSimilarity(r_d, r_a, z);
 }
 
+/**
+ * Weighs a line observation by where it puts the seen point of the line on
+ * the field: the farther that lands from any field line, the less likely
+ * the particle.  Which line was seen does not matter, so the observation's
+ * possibilities are not used, and the point need not be the line's nearest.
+ *
+ * @param z    the line observation
+ * @param x_t  the a priori estimate of the robot pose.
+ * @return     the probability of the observation
+ */
+float MCL::determineLineGridWeight(const Observation& z, const PoseEst& x_t)
+{
+    const float a = x_t.h + z.getVisBearing();
+    const float r_d = lineGrid->distance(x_t.x + z.getVisDistance() * cosf(a),
+                                         x_t.y + z.getVisDistance() * sinf(a));
+    return max(getSimilarity(r_d, 0.0f, z), LINE_GRID_MIN_SIMILARITY);
+}
+
 /**
  * Determine the similarity of an observation to a landmark location
  *
@@ -409,7 +1109,7 @@ float MCL::determineLineWeight(Observation z, PoseEst x_t, LineLandmark line)
  * @param sigma_a The standard deviation of the bearing measurement
  * @return        The combined similarity of the landmark observation
  */
-float MCL::getSimilarity(float r_d, float r_a, Observation &z)
+float MCL::getSimilarity(float r_d, float r_a, const Observation &z)
 {
     // Similarity of observation and expectation
     float s_d_a;
@@ -429,29 +1129,20 @@ float MCL::getSimilarity(float r_d, float r_a, Observation &z)
  * Move a particle randomly in the x, y, and h directions proportional
  * to its weight, within a certian bounds.
  *
- * @param p The particle to be random walked
- *
- * @return The walked particle
+ * @param from Index of the particle in X_bar_t to be random walked
+ * @param to   Index in X_t that receives the walked particle
  */
-Particle MCL::randomWalkParticle(Particle p)
+void MCL::randomWalkParticle(int from, int to)
 {
-    p.pose.x += sampleNormalDistribution(MAX_CHANGE_X * (1.0f - p.weight));
-    p.pose.y += sampleNormalDistribution(MAX_CHANGE_Y * (1.0f - p.weight));
-    p.pose.h += sampleNormalDistribution(MAX_CHANGE_H * (1.0f - p.weight));
-
-    p.pose.h = NBMath::subPIAngle(p.pose.h);
-
-    return p;
-}
-
-float MCL::sampleNormalDistribution(float sd)
-{
-    float samp = 0;
-    for(int i = 0; i < 12; i++) {
-        samp += (2*(static_cast<float>(rand()) /
-					static_cast<float>(RAND_MAX)) * sd) - sd;
-    }
-    return 0.5f*samp;
+    const float w = X_bar_t.w[from];
+    // Keyed on the new slot, so copies of one parent walk apart
+    ParticleRandom random(seed, frameCounter, ParticleRandom::WALK_STREAM, to);
+
+    X_t.x[to] = X_bar_t.x[from] + random.normal(MAX_CHANGE_X * (1.0f - w));
+    X_t.y[to] = X_bar_t.y[from] + random.normal(MAX_CHANGE_Y * (1.0f - w));
+    X_t.h[to] = NBMath::subPIAngle(X_bar_t.h[from] +
+                                   random.normal(MAX_CHANGE_H * (1.0f - w)));
+    X_t.w[to] = w;
 }
 
 float MCL::sampleTriangularDistribution(float sd)
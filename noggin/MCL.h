@@ -12,6 +12,7 @@
 // STL
 #include <vector>
 #include <math.h>
+#include <boost/shared_ptr.hpp>
 // Local
 #include "Observation.h"
 #include "FieldConstants.h"
@@ -19,6 +20,16 @@
 #include "NBMath.h"
 #include "NogginStructs.h"
 #include "LocSystem.h"
+#include "ParticleWorkers.h"
+
+class LineGrid;
+
+// The vectorized likelihood evaluator works on 8 particles at a time with
+// AVX2 or 4 with SSE2.  Elsewhere, e.g. the Geode, only the scalar
+// measurement model is built.
+#if defined(__AVX2__) || defined(__SSE2__)
+#  define MCL_VECTOR_KERNEL
+#endif
 
 // Particle
 class Particle
@@ -37,9 +48,123 @@ public:
 
 };
 
+// Particle arrays are padded to a multiple of this many entries so the
+// vector kernel never needs a scalar tail
+static const int PARTICLE_PAD = 8;
+
+static inline int paddedParticles(int M) {
+    return (M + PARTICLE_PAD - 1) / PARTICLE_PAD * PARTICLE_PAD;
+}
+
+/**
+ * Particle storage with one array per pose component and one for the weights.
+ * The arrays are sized once to the number of particles and then reused, so a
+ * filter update only ever writes into memory it already owns.
+ */
+class ParticleSet
+{
+public:
+    void resize(int M) {
+        x.resize(paddedParticles(M));
+        y.resize(paddedParticles(M));
+        h.resize(paddedParticles(M));
+        w.resize(paddedParticles(M));
+    }
+
+    // Exchanges the storage of the two sets without copying any particles
+    void swap(ParticleSet& other) {
+        x.swap(other.x);
+        y.swap(other.y);
+        h.swap(other.h);
+        w.swap(other.w);
+    }
+
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> h;
+    std::vector<float> w;
+};
+
+/**
+ * Counter based random numbers.  The n-th number of a stream is a hash of the
+ * seed, the frame, the stream and particle it belongs to, and n.  A particle
+ * therefore draws the same numbers whichever thread updates it and whatever
+ * order the particles are updated in.
+ */
+class ParticleRandom
+{
+public:
+    // What the numbers are for, so the streams of one particle differ
+    enum Stream {
+        RESET_STREAM = 0,
+        MOTION_STREAM,
+        WALK_STREAM,
+        RESAMPLE_STREAM
+    };
+
+    ParticleRandom(unsigned int seed, unsigned int frame, Stream stream,
+                   unsigned int particle)
+        : key(mix(mix(static_cast<unsigned long long>(seed) << 32 | frame) ^
+                  (static_cast<unsigned long long>(stream) << 32 | particle))),
+          counter(0) {}
+
+    /**
+     * @return A uniform sample from [0, 1)
+     */
+    float uniform() {
+        return static_cast<float>(next() >> 40) * (1.0f / 16777216.0f);
+    }
+
+    /**
+     * @return A normal sample with mean 0 and standard deviation sd, by the
+     *         Box-Muller transform of two 24 bit uniforms
+     */
+    float normal(float sd) {
+        const unsigned long long r = next();
+        const float u1 = (static_cast<float>(r >> 40) + 0.5f) *
+            (1.0f / 16777216.0f);
+        const float u2 = static_cast<float>((r >> 16) & 0xffffff) *
+            (1.0f / 16777216.0f);
+        return sd * sqrtf(-2.0f * logf(u1)) * cosf(2.0f * M_PI_FLOAT * u2);
+    }
+
+private:
+    // The SplitMix64 finalizer
+    static unsigned long long mix(unsigned long long z) {
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    unsigned long long next() {
+        return mix(key + ++counter * 0x9e3779b97f4a7c15ULL);
+    }
+
+    const unsigned long long key;
+    unsigned long long counter;
+};
+
 // Constants
 static const float MIN_SIMILARITY = static_cast<float>(1.0e-20); // Minimum possible similarity
 
+// Least likelihood of a line point weighed by the line grid: the chance it
+// is noise or a line the field doesn't have, so that many points seen along
+// the lines can't single out a wrong pose by their sheer number
+static const float LINE_GRID_MIN_SIMILARITY = 0.05f;
+
+// Resample when the effective sample size drops below this fraction of M
+static const float DEFAULT_RESAMPLE_THRESHOLD = 0.5f;
+
+// KLD sampling: keep the error between the particles and the true posterior
+// below KLD_EPSILON with probability 1 - delta, z being the upper 1 - delta
+// quantile of the standard normal (delta = 0.01).  The posterior is
+// histogrammed in bins of KLD_BIN_XY cm by KLD_BIN_H radians.
+static const float KLD_EPSILON = 0.05f;
+static const float KLD_Z = 2.326f;
+static const float KLD_BIN_XY = 20.0f;
+static const float KLD_BIN_H = M_PI_FLOAT / 9.0f;
+static const int KLD_MIN_PARTICLES = 50;
+
 // The Monte Carlo Localization class
 class MCL : public LocSystem
 {
@@ -49,8 +174,8 @@ public:
     virtual ~MCL();
 
     // Core Functions
-    virtual void updateLocalization(MotionModel u_t,
-                                    std::vector<Observation> z_t);
+    virtual void updateLocalization(const MotionModel& u_t,
+                                    const std::vector<Observation>& z_t);
     virtual void reset();
 
     // Getters
@@ -108,10 +233,16 @@ public:
 
     const MotionModel getLastOdo() const { return lastOdo; }
 
+    const std::vector<Observation> getLastObservations() const {
+        return std::vector<Observation>(lastObservations.begin(),
+                                        lastObservations.begin() +
+                                        numLastObservations);
+    }
+
     /**
      * @return The current set of particles in the filter
      */
-    const std::vector<Particle> getParticles() const { return X_t; }
+    const std::vector<Particle> getParticles() const;
 
     // Setters
     /**
@@ -146,31 +277,152 @@ public:
 
     void setUseBest(bool _new) { useBest = _new; }
 
+    /**
+     * Weigh particles with the vectorized log space likelihood evaluator.
+     * Ignored when the kernel is not built for this machine.
+     */
+    void setUseVectorLikelihood(bool _new) { useVectorLikelihood = _new; }
+
+    /**
+     * Weigh line observations by looking up, in a precomputed distance
+     * field, how far the seen point lands from any field line, instead of
+     * matching each possible line.  A null grid goes back to the lines.
+     */
+    void setLineGrid(boost::shared_ptr<LineGrid> grid) { lineGrid = grid; }
+
+    /**
+     * Resample every frame with the proportional scheme, as the filter first
+     * did, instead of systematically when the effective sample size drops.
+     * The particle count stays fixed.
+     */
+    void setUseProportionalResample(bool _new) {
+        useProportionalResample = _new;
+    }
+
+    /**
+     * @param _new Resample when the effective sample size is below this
+     *             fraction of the particles; 1 or more resamples
+     *             every frame.
+     */
+    void setResampleThreshold(float _new) { resampleThreshold = _new; }
+
+    /**
+     * Size the particle set by KLD sampling at each resample, between the
+     * minimum particles and the number the filter was made with.  Off by
+     * default: the smaller set is slow to find the robot again after it
+     * has been moved.  Off, systematic resampling goes back to the number
+     * it was made with.
+     */
+    void setUseKLDSampling(bool _new) { useKLDSampling = _new; }
+    void setMinParticles(int _new) {
+        minParticles = _new < maxParticles ? _new : maxParticles;
+    }
+
+    /**
+     * @return The number of particles in use
+     */
+    int getNumParticles() const { return M; }
+
+    /**
+     * Seeds the filter's random numbers and resets the particles.  Updates
+     * with the same seed, odometry and observations give the same particles,
+     * bit for bit, with any number of threads.
+     */
+    void setSeed(unsigned int _seed) { seed = _seed; reset(); }
+
+    void setThreads(int threads);
+    int getThreads() const;
+
+#ifdef MCL_VECTOR_KERNEL
+    bool compareLikelihoodKernels(const std::vector<Observation>& z_t,
+                                  int iterations);
+#endif
+
 private:
     // Class variables
     PoseEst curEst; // Current {x,y,h} esitamates
     PoseEst curBest; // Current {x,y,h} esitamate of the highest weighted particle
     PoseEst curUncert; // Associated {x,y,h} uncertainties (standard deviations)
-    std::vector<Particle> X_t; // Current set of particles
+    ParticleSet X_t; // Current set of particles
+    ParticleSet X_bar_t; // A priori set, filled in before resampling
     bool useBest;
+    bool useVectorLikelihood;
+    bool useProportionalResample;
+    bool useKLDSampling;
+    float resampleThreshold;
+    int minParticles;
     MotionModel lastOdo;
+    // The first numLastObservations are last frame's; the rest keep their
+    // storage for frames that see more
+    std::vector<Observation> lastObservations;
+    unsigned int numLastObservations;
+    // Scratch for the vector kernel: summed and per observation log weights
+    std::vector<float> logWeights;
+    std::vector<float> obsLogWeights;
+    // Heading cosines and sines for the line grid in the vector kernel
+    std::vector<float> headCos;
+    std::vector<float> headSin;
+    boost::shared_ptr<LineGrid> lineGrid;
+    // Which particle of X_bar_t each particle of X_t is resampled from
+    std::vector<int> parents;
+    unsigned int seed;
+    boost::shared_ptr<ParticleWorkers> workers;
+    // KLD sampling histogram of the weights, and the bins holding any
+    std::vector<float> binWeights;
+    std::vector<int> occupiedBins;
+
+    // The steps of an update that are split between threads
+    class UpdateJob : public ParticleJob
+    {
+    public:
+        enum Step {
+            PREDICT,
+            WEIGH,
+            WEIGH_VECTOR,
+            EXPONENTIATE,
+            WALK
+        };
+        UpdateJob(MCL *_mcl, Step _step, const MotionModel *_u_t,
+                  const std::vector<Observation> *_z_t)
+            : mcl(_mcl), step(_step), u_t(_u_t), z_t(_z_t) {}
+        void run(int first, int last);
+    private:
+        MCL *mcl;
+        Step step;
+        const MotionModel *u_t;
+        const std::vector<Observation> *z_t;
+    };
+    friend class UpdateJob;
+    void runJob(UpdateJob *job);
 
     // Core Functions
-    PoseEst updateMotionModel(PoseEst x_t, MotionModel u_t);
-    float updateMeasurementModel(std::vector<Observation> z_t, PoseEst x_t);
-    void resample(std::vector<Particle> * X_bar_t, float totalWeights);
-    void lowVarianceResample(std::vector<Particle> * X_bar_t,
-                             float totalWeights);
-    void noResample(std::vector<Particle> * X_bar_t);
+    PoseEst updateMotionModel(PoseEst x_t, MotionModel u_t,
+                              ParticleRandom& random);
+    float updateMeasurementModel(const std::vector<Observation>& z_t,
+                                 const PoseEst& x_t);
+    float weighParticles(const std::vector<Observation>& z_t,
+                         bool vectorKernel);
+#ifdef MCL_VECTOR_KERNEL
+    void vectorLogWeights(const std::vector<Observation>& z_t,
+                          int first, int last);
+    void exponentiateWeights(int first, int last);
+#endif
+    void resample(float totalWeights);
+    float normalizeWeights(float totalWeights);
+    int kldParticles();
+    int kldBin(float x, float y, float h) const;
+    void lowVarianceResample(int newM);
+    void noResample();
     void updateEstimates();
 
     // Helpers
-    float determinePointWeight(Observation z, PoseEst x_t,
-                               PointLandmark landmark);
-    float determineLineWeight(Observation z, PoseEst x_t, LineLandmark _line);
-    float getSimilarity(float r_d, float r_a, Observation &z);
-    Particle randomWalkParticle(Particle p);
-    float sampleNormalDistribution(float sd);
+    float determinePointWeight(const Observation& z, const PoseEst& x_t,
+                               const PointLandmark& landmark);
+    float determineLineWeight(const Observation& z, const PoseEst& x_t,
+                              const LineLandmark& _line);
+    float determineLineGridWeight(const Observation& z, const PoseEst& x_t);
+    float getSimilarity(float r_d, float r_a, const Observation &z);
+    void randomWalkParticle(int from, int to);
     float sampleTriangularDistribution(float sd);
 
 public:
@@ -178,7 +430,8 @@ public:
     //     return o << "Est: " << c.curEst << "\nUnct: " << c.curUncert;
     // }
     int frameCounter;
-    const int M; // Number of particles
+    const int maxParticles; // Room for this many particles
+    int M; // Number of particles
 };
 
 #endif // _MCL_H_DEFINED
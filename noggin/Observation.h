@@ -82,14 +82,14 @@ public:
     /*
      * @return The list of possible line landmarks
      */
-    const std::vector<LineLandmark> getLinePossibilities() const {
+    const std::vector<LineLandmark>& getLinePossibilities() const {
         return linePossibilities;
     }
 
     /*
      * @return The list of possible point landmarks
      */
-    const std::vector<PointLandmark> getPointPossibilities() const {
+    const std::vector<PointLandmark>& getPointPossibilities() const {
         return pointPossibilities;
     }
 
@@ -0,0 +1,126 @@
+/**
+ * ParticleWorkers.cpp - Threads for the per particle work of the particle
+ * filter.
+ */
+
+#include "ParticleWorkers.h"
+
+ParticleWorkers::ParticleWorkers(int threads)
+    : numThreads(1), job(0), count(0), align(1), generation(0), pending(0),
+      running(true)
+{
+    if (threads > 1) {
+        numThreads = threads < MAX_PARTICLE_THREADS ?
+            threads : MAX_PARTICLE_THREADS;
+    }
+
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&startCond, NULL);
+    pthread_cond_init(&doneCond, NULL);
+
+    // Slice 0 belongs to the calling thread
+    for (int s = 1; s < numThreads; ++s) {
+        workers[s].owner = this;
+        workers[s].slice = s;
+        if (pthread_create(&workers[s].thread, NULL, runWorker,
+                           &workers[s]) != 0) {
+            // Use the threads we could start
+            numThreads = s;
+            break;
+        }
+    }
+}
+
+ParticleWorkers::~ParticleWorkers()
+{
+    pthread_mutex_lock(&mutex);
+    running = false;
+    pthread_cond_broadcast(&startCond);
+    pthread_mutex_unlock(&mutex);
+
+    for (int s = 1; s < numThreads; ++s) {
+        pthread_join(workers[s].thread, NULL);
+    }
+
+    pthread_cond_destroy(&doneCond);
+    pthread_cond_destroy(&startCond);
+    pthread_mutex_destroy(&mutex);
+}
+
+/**
+ * Runs the job over every particle, one slice per thread, and blocks until
+ * all of the slices are done.
+ *
+ * @param _job   The work to do
+ * @param _count The number of particles
+ * @param _align Slices start on multiples of this
+ */
+void ParticleWorkers::run(ParticleJob *_job, int _count, int _align)
+{
+    if (numThreads == 1) {
+        _job->run(0, _count);
+        return;
+    }
+
+    pthread_mutex_lock(&mutex);
+    job = _job;
+    count = _count;
+    align = _align;
+    generation++;
+    pending = numThreads - 1;
+    pthread_cond_broadcast(&startCond);
+    pthread_mutex_unlock(&mutex);
+
+    runSlice(0);
+
+    pthread_mutex_lock(&mutex);
+    while (pending > 0) {
+        pthread_cond_wait(&doneCond, &mutex);
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+void ParticleWorkers::runSlice(int slice)
+{
+    const int blocks = (count + align - 1) / align;
+    const int first = blocks * slice / numThreads * align;
+    int last = blocks * (slice + 1) / numThreads * align;
+    if (last > count) {
+        last = count;
+    }
+    if (first < last) {
+        job->run(first, last);
+    }
+}
+
+void* ParticleWorkers::runWorker(void *arg)
+{
+    Worker *worker = reinterpret_cast<Worker*>(arg);
+    worker->owner->workerLoop(worker->slice);
+    return NULL;
+}
+
+void ParticleWorkers::workerLoop(int slice)
+{
+    int lastGeneration = 0;
+    for (;;) {
+        pthread_mutex_lock(&mutex);
+        while (running && generation == lastGeneration) {
+            pthread_cond_wait(&startCond, &mutex);
+        }
+        if (!running) {
+            pthread_mutex_unlock(&mutex);
+            return;
+        }
+        lastGeneration = generation;
+        pthread_mutex_unlock(&mutex);
+
+        runSlice(slice);
+
+        pthread_mutex_lock(&mutex);
+        if (--pending == 0) {
+            pthread_cond_signal(&doneCond);
+        }
+        pthread_mutex_unlock(&mutex);
+    }
+}
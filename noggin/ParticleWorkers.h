@@ -0,0 +1,70 @@
+/**
+ * ParticleWorkers.h - A small pool of threads that splits per particle work
+ * of the particle filter between them.
+ *
+ * The particles are cut into one contiguous slice per thread.  The calling
+ * thread works the first slice and a worker thread each of the others, and
+ * run() returns once every slice is done.  Slices start on multiples of the
+ * given alignment so vector code never shares a block of particles with
+ * another thread.  With a single thread no threads are started at all and
+ * run() calls the job directly.
+ */
+
+#ifndef ParticleWorkers_h_DEFINED
+#define ParticleWorkers_h_DEFINED
+
+#include <pthread.h>
+
+static const int MAX_PARTICLE_THREADS = 8;
+
+/**
+ * Work to be done on a range of particles.  run() is called on several
+ * threads at once, each with its own range.
+ */
+class ParticleJob
+{
+public:
+    virtual ~ParticleJob() {}
+    virtual void run(int first, int last) = 0;
+};
+
+class ParticleWorkers
+{
+public:
+    ParticleWorkers(int threads);
+    virtual ~ParticleWorkers();
+
+    // Runs job over [0, count) and waits for it to finish
+    void run(ParticleJob *job, int count, int align);
+
+    int getNumThreads() const { return numThreads; }
+
+private:
+    struct Worker {
+        ParticleWorkers *owner;
+        int slice;
+        pthread_t thread;
+    };
+
+    static void* runWorker(void *arg);
+    void workerLoop(int slice);
+    void runSlice(int slice);
+
+    int numThreads;
+    Worker workers[MAX_PARTICLE_THREADS];
+
+    // The job being run and how it is sliced
+    ParticleJob *job;
+    int count;
+    int align;
+
+    // Hand-off between the calling thread and the workers
+    pthread_mutex_t mutex;
+    pthread_cond_t startCond;
+    pthread_cond_t doneCond;
+    int generation;
+    int pending;
+    bool running;
+};
+
+#endif // ParticleWorkers_h_DEFINED
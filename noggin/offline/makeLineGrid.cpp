@@ -0,0 +1,119 @@
+/**
+ * makeLineGrid: writes the .lgd distance field of the field lines that MCL
+ * can weigh line observations with, then maps it back and checks it against
+ * the exact distances.  See the README in this directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "Common.h"
+#include "FieldConstants.h"
+#include "ConcreteLine.h"
+#include "LineGrid.h"
+
+using namespace std;
+
+static const int CHECK_POINTS = 1000000;
+
+// The distance LineGrid::build() works out, at any point
+static float exactDistance(float x, float y)
+{
+    const vector<const ConcreteLine*>& lines = ConcreteLine::concreteLines();
+    float nearest = HUGE_VAL;
+    for (unsigned int l = 0; l < lines.size(); ++l) {
+        const float x1 = lines[l]->getFieldX1();
+        const float y1 = lines[l]->getFieldY1();
+        const float dx = lines[l]->getFieldX2() - x1;
+        const float dy = lines[l]->getFieldY2() - y1;
+        float t = ((x - x1) * dx + (y - y1) * dy) / (dx * dx + dy * dy);
+        t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+        const float d = hypotf(x1 + t * dx - x, y1 + t * dy - y);
+        if (d < nearest) {
+            nearest = d;
+        }
+    }
+    return nearest;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        printf("Usage: %s output.lgd [cell size cm]\n", argv[0]);
+        return 1;
+    }
+    const float cellSize = argc > 2 ? static_cast<float>(atof(argv[2])) :
+        DEFAULT_LINE_GRID_CELL;
+    if (!(cellSize > 0.0f)) {
+        printf("The cell size must be positive\n");
+        return 1;
+    }
+
+    LineGrid built;
+    long long start = micro_time();
+    built.build(cellSize);
+    const long long buildTime = micro_time() - start;
+
+    FILE *out = fopen(argv[1], "wb");
+    if (out == NULL || !built.write(out)) {
+        printf("Could not write %s\n", argv[1]);
+        return 1;
+    }
+    fclose(out);
+
+    LineGrid grid;
+    if (!grid.map(argv[1])) {
+        printf("Could not map %s back\n", argv[1]);
+        return 1;
+    }
+    printf("%s: %dx%d cells of %.1f cm, %d bytes, built in %lld ms\n",
+           argv[1], grid.getWidth(), grid.getHeight(), grid.getCellSize(),
+           static_cast<int>(grid.getWidth() * grid.getHeight() *
+                            sizeof(unsigned short)), buildTime / 1000);
+
+    // The same points for both, anywhere on the green
+    vector<float> xs(CHECK_POINTS), ys(CHECK_POINTS);
+    unsigned int seed = 1;
+    for (int i = 0; i < CHECK_POINTS; ++i) {
+        seed = seed * 1103515245u + 12345u;
+        xs[i] = FIELD_WIDTH * static_cast<float>((seed >> 8) & 0xffff) /
+            65536.0f;
+        seed = seed * 1103515245u + 12345u;
+        ys[i] = FIELD_HEIGHT * static_cast<float>((seed >> 8) & 0xffff) /
+            65536.0f;
+    }
+
+    double exactSum = 0, gridSum = 0;
+    float maxError = 0;
+    start = micro_time();
+    for (int i = 0; i < CHECK_POINTS; ++i) {
+        exactSum += exactDistance(xs[i], ys[i]);
+    }
+    const long long exactTime = micro_time() - start;
+
+    start = micro_time();
+    for (int i = 0; i < CHECK_POINTS; ++i) {
+        gridSum += grid.distance(xs[i], ys[i]);
+    }
+    const long long gridTime = micro_time() - start;
+
+    for (int i = 0; i < CHECK_POINTS; ++i) {
+        const float error = fabsf(grid.distance(xs[i], ys[i]) -
+                                  exactDistance(xs[i], ys[i]));
+        if (error > maxError) {
+            maxError = error;
+        }
+    }
+
+    // Within half a cell's diagonal plus the rounding to mm
+    const float bound = cellSize * 0.7072f + 0.05f;
+    printf("distance: %d lines %.1f ns/point, grid %.1f ns/point, "
+           "max error %.2f cm (bound %.2f), mean %.1f / %.1f cm, %s\n",
+           static_cast<int>(ConcreteLine::concreteLines().size()),
+           static_cast<float>(exactTime) * 1000.0f / CHECK_POINTS,
+           static_cast<float>(gridTime) * 1000.0f / CHECK_POINTS,
+           maxError, bound, exactSum / CHECK_POINTS, gridSum / CHECK_POINTS,
+           maxError <= bound ? "agree" : "MISMATCH");
+    return maxError <= bound ? 0 : 1;
+}
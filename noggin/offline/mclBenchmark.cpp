@@ -0,0 +1,529 @@
+/* mclBenchmark.cpp */
+
+/**
+ * Times MCL::updateLocalization() over a range of particle counts.
+ *
+ * Two scenarios are available.  By default a robot standing at a fixed pose
+ * sees the same set of landmarks every frame: a distinct goal post, an
+ * ambiguous post, an ambiguous goal box corner and an ambiguous sideline.
+ * With -walk the robot instead walks a loop around the center circle and
+ * sees whatever the faker would show it: posts, corners (half of them
+ * ambiguous) and lines within view, with noisy distances.
+ *
+ * With -kidnap the robot is also picked up a third of the way round and
+ * put down a quarter of the loop further on, without odometry telling the
+ * filter.
+ *
+ * For each particle count the mean update time is reported along with the
+ * mean number of particles in use, the number of heap allocations made
+ * during the timed updates and, for -walk, the mean distance between the
+ * estimate and the true pose over the second half of the loop.  Either way
+ * an update should make no allocations.  -kidnap
+ * adds the number of frames from the kidnapping until the estimate is
+ * within RECOVERED_ERROR of the truth for good.  The last column is a
+ * checksum of the final particles; runs with the same seed must print the
+ * same checksum whatever the number of threads.
+ *
+ * usage: mclBenchmark [-walk] [-kidnap] [-vector] [-compare] [-proportional]
+ *                     [-kld] [-threads N] [-seed S] [-lineGrid file.lgd]
+ *                     [-linePoints N] [numParticles ...]
+ *   -vector       weigh particles with the vectorized likelihood kernel
+ *   -compare      check the vector kernel against the scalar model and time
+ *                 both
+ *   -proportional resample every frame with the old proportional scheme
+ *   -kld          size the particle set by KLD sampling, up to numParticles
+ *   -threads      split each update between N threads (default 1)
+ *   -seed         seed for the filter's random numbers (default 1)
+ *   -lineGrid     weigh lines by the distance field from makeLineGrid
+ *                 instead of matching each possible line
+ *   -linePoints   see N points spread along each line in view on the walk
+ *                 instead of just its nearest point
+ */
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <new>
+#include <vector>
+
+#include "MCL.h"
+#include "LineGrid.h"
+#include "Common.h"
+#include "VisionDef.h" // For NAO_FOV_X_DEG
+using namespace std;
+
+// Every heap allocation in the process goes through here so the benchmark
+// can report how many of them an update makes.  Not inlined, or gcc takes
+// the malloc and free inside them for a mismatched new and delete.
+static long allocations = 0;
+
+void* __attribute__((noinline)) operator new(size_t size)
+{
+    ++allocations;
+    void *p = malloc(size);
+    if (p == NULL) {
+        throw bad_alloc();
+    }
+    return p;
+}
+
+void* __attribute__((noinline)) operator new[](size_t size)
+{
+    ++allocations;
+    void *p = malloc(size);
+    if (p == NULL) {
+        throw bad_alloc();
+    }
+    return p;
+}
+
+void __attribute__((noinline)) operator delete(void *p) throw()
+{
+    free(p);
+}
+
+void __attribute__((noinline)) operator delete[](void *p) throw()
+{
+    free(p);
+}
+
+static const PoseEst ROBOT_POSE(CENTER_FIELD_X - 100.0f,
+                                CENTER_FIELD_Y - 50.0f,
+                                0.3f);
+static const float DIST_SD = 20.0f;
+static const float BEARING_SD = 0.1f;
+
+// Walk scenario, after the faker: half the camera's view plus head pan, view
+// ranges and distance noise
+static const float FOV_OFFSET = NAO_FOV_X_DEG * M_PI_FLOAT / 360.0f +
+    M_PI_FLOAT / 4.0f;
+static const float FO_MAX_VIEW_RANGE = 575.0f;
+static const float CORNER_MAX_VIEW_RANGE = 200.0f;
+static const float LINE_MAX_VIEW_RANGE = 250.0f;
+static const float NOISE_LEVEL = 0.05f;
+static const float WALK_RADIUS = 150.0f;
+static const float WALK_STEP = 2.0f;
+static const int WALK_FRAMES = 480;
+static const int KIDNAP_FRAME = WALK_FRAMES / 3;
+static const float KIDNAP_ANGLE = M_PI_FLOAT / 2.0f;
+static const float RECOVERED_ERROR = 50.0f;
+
+static Observation seePoint(int id, const PointLandmark& truth)
+{
+    const float dist = static_cast<float>(hypot(truth.x - ROBOT_POSE.x,
+                                                truth.y - ROBOT_POSE.y));
+    const float bearing = NBMath::subPIAngle(atan2(truth.y - ROBOT_POSE.y,
+                                                   truth.x - ROBOT_POSE.x) -
+                                             ROBOT_POSE.h);
+    return Observation(id, dist, bearing, DIST_SD, BEARING_SD, false);
+}
+
+static vector<Observation> makeObservations()
+{
+    vector<Observation> z;
+
+    // Distinct post
+    PointLandmark bluePost(LANDMARK_BLUE_GOAL_BOTTOM_POST_X,
+                           LANDMARK_BLUE_GOAL_BOTTOM_POST_Y);
+    z.push_back(seePoint(0, bluePost));
+    z.back().addPointPossibility(bluePost);
+
+    // Ambiguous post
+    PointLandmark yellowTop(LANDMARK_YELLOW_GOAL_TOP_POST_X,
+                            LANDMARK_YELLOW_GOAL_TOP_POST_Y);
+    PointLandmark yellowBottom(LANDMARK_YELLOW_GOAL_BOTTOM_POST_X,
+                               LANDMARK_YELLOW_GOAL_BOTTOM_POST_Y);
+    z.push_back(seePoint(1, yellowTop));
+    z.back().addPointPossibility(yellowTop);
+    z.back().addPointPossibility(yellowBottom);
+
+    // Ambiguous corner, any of the four goal box corners
+    PointLandmark boxTop(BLUE_GOALBOX_RIGHT_X, BLUE_GOALBOX_TOP_Y);
+    z.push_back(seePoint(2, boxTop));
+    z.back().addPointPossibility(boxTop);
+    z.back().addPointPossibility(PointLandmark(BLUE_GOALBOX_RIGHT_X,
+                                               BLUE_GOALBOX_BOTTOM_Y));
+    z.back().addPointPossibility(PointLandmark(FIELD_WHITE_RIGHT_SIDELINE_X -
+                                               GOALBOX_DEPTH,
+                                               BLUE_GOALBOX_TOP_Y));
+    z.back().addPointPossibility(PointLandmark(FIELD_WHITE_RIGHT_SIDELINE_X -
+                                               GOALBOX_DEPTH,
+                                               BLUE_GOALBOX_BOTTOM_Y));
+
+    // Ambiguous line, seen straight ahead of the bottom sideline
+    const float lineDist = ROBOT_POSE.y - FIELD_WHITE_BOTTOM_SIDELINE_Y;
+    z.push_back(Observation(50, lineDist,
+                            NBMath::subPIAngle(-M_PI_FLOAT / 2.0f -
+                                               ROBOT_POSE.h),
+                            DIST_SD, BEARING_SD, true));
+    z.back().addLinePossibility(LineLandmark(FIELD_WHITE_LEFT_SIDELINE_X,
+                                             FIELD_WHITE_BOTTOM_SIDELINE_Y,
+                                             FIELD_WHITE_RIGHT_SIDELINE_X,
+                                             FIELD_WHITE_BOTTOM_SIDELINE_Y));
+    z.back().addLinePossibility(LineLandmark(FIELD_WHITE_LEFT_SIDELINE_X,
+                                             FIELD_WHITE_TOP_SIDELINE_Y,
+                                             FIELD_WHITE_RIGHT_SIDELINE_X,
+                                             FIELD_WHITE_TOP_SIDELINE_Y));
+    return z;
+}
+
+// The walk has its own generator so every run sees the same observations
+static unsigned int walkSeed = 1;
+
+static float walkUniform()
+{
+    walkSeed = walkSeed * 1103515245u + 12345u;
+    return static_cast<float>((walkSeed >> 8) & 0xffff) / 65536.0f;
+}
+
+static float walkNormal(float sd)
+{
+    float samp = 0;
+    for (int i = 0; i < 12; ++i) {
+        samp += walkUniform();
+    }
+    return (samp - 6.0f) * sd;
+}
+
+static bool inView(const PoseEst& pose, float x, float y, float range,
+                   float *dist, float *bearing)
+{
+    *dist = static_cast<float>(hypot(x - pose.x, y - pose.y));
+    *bearing = NBMath::subPIAngle(atan2(y - pose.y, x - pose.x) - pose.h);
+    return *bearing > -FOV_OFFSET && *bearing < FOV_OFFSET && *dist < range;
+}
+
+static Observation seen(int id, float dist, float bearing, bool line)
+{
+    dist += walkNormal(dist * NOISE_LEVEL);
+    return Observation(id, dist, bearing, max(10.0f, dist * 0.15f),
+                       BEARING_SD, line);
+}
+
+// Points seen along each line in view; 0 sees only the nearest point
+static int linePoints = 0;
+
+static void seeLines(const PoseEst& pose, const ConcreteLine& toView,
+                     vector<Observation> *z)
+{
+    LineLandmark ll(toView.getFieldX1(), toView.getFieldY1(),
+                    toView.getFieldX2(), toView.getFieldY2());
+    const float lx = ll.x2 - ll.x1, ly = ll.y2 - ll.y1;
+
+    bool chosen = false;
+    const vector<const ConcreteLine*> *family = 0;
+    for (int k = 0; k < max(1, linePoints); ++k) {
+        float t;
+        if (linePoints == 0) {
+            // Nearest point of the segment
+            t = ((pose.x - ll.x1) * lx + (pose.y - ll.y1) * ly) /
+                (lx * lx + ly * ly);
+            t = max(0.0f, min(1.0f, t));
+        } else {
+            t = (static_cast<float>(k) + 0.5f) /
+                static_cast<float>(linePoints);
+        }
+
+        float dist, bearing;
+        if (!inView(pose, ll.x1 + t * lx, ll.y1 + t * ly,
+                    LINE_MAX_VIEW_RANGE, &dist, &bearing)) {
+            continue;
+        }
+        z->push_back(seen(toView.getID(), dist, bearing, true));
+
+        // Half the time the line could be any sideline or goal box line
+        if (!chosen && walkUniform() < 0.5f) {
+            const vector<const ConcreteLine*>& sides =
+                ConcreteLine::sidelines();
+            const vector<const ConcreteLine*>& boxes =
+                ConcreteLine::goalboxLines();
+            if (find(sides.begin(), sides.end(), &toView) != sides.end()) {
+                family = &sides;
+            } else if (find(boxes.begin(), boxes.end(), &toView) !=
+                       boxes.end()) {
+                family = &boxes;
+            }
+        }
+        chosen = true;
+
+        if (family == 0) {
+            z->back().addLinePossibility(ll);
+            continue;
+        }
+        for (unsigned int i = 0; i < family->size(); ++i) {
+            // sidelines() only fills in two of its entries
+            const ConcreteLine *l = (*family)[i];
+            if (l == 0) {
+                continue;
+            }
+            z->back().addLinePossibility(LineLandmark(l->getFieldX1(),
+                                                      l->getFieldY1(),
+                                                      l->getFieldX2(),
+                                                      l->getFieldY2()));
+        }
+    }
+}
+
+static vector<Observation> walkObservations(const PoseEst& pose)
+{
+    vector<Observation> z;
+    float dist, bearing;
+
+    for (int i = 0; i < ConcreteFieldObject::NUM_FIELD_OBJECTS; ++i) {
+        const ConcreteFieldObject* toView =
+            ConcreteFieldObject::concreteFieldObjectList[i];
+        if (inView(pose, toView->getFieldX(), toView->getFieldY(),
+                   FO_MAX_VIEW_RANGE, &dist, &bearing)) {
+            z.push_back(seen(toView->getID(), dist, bearing, false));
+            z.back().addPointPossibility(PointLandmark(toView->getFieldX(),
+                                                       toView->getFieldY()));
+        }
+    }
+
+    const vector<const ConcreteCorner*>& corners =
+        ConcreteCorner::concreteCorners();
+    for (unsigned int i = 0; i < corners.size(); ++i) {
+        const ConcreteCorner* toView = corners[i];
+        if (toView->getID() == CENTER_CIRCLE ||
+            !inView(pose, toView->getFieldX(), toView->getFieldY(),
+                    CORNER_MAX_VIEW_RANGE, &dist, &bearing)) {
+            continue;
+        }
+        z.push_back(seen(toView->getID(), dist, bearing, false));
+
+        // Half the time the corner could be any corner of its shape
+        if (walkUniform() < 0.5f) {
+            const vector<const ConcreteCorner*>& possible =
+                ConcreteCorner::getPossibleCorners(
+                    ConcreteCorner::inferCornerType(toView->getID()));
+            for (unsigned int j = 0; j < possible.size(); ++j) {
+                z.back().addPointPossibility(
+                    PointLandmark(possible[j]->getFieldX(),
+                                  possible[j]->getFieldY()));
+            }
+        } else {
+            z.back().addPointPossibility(PointLandmark(toView->getFieldX(),
+                                                       toView->getFieldY()));
+        }
+    }
+
+    const vector<const ConcreteLine*>& lines = ConcreteLine::concreteLines();
+    for (unsigned int i = 0; i < lines.size(); ++i) {
+        seeLines(pose, *lines[i], &z);
+    }
+    return z;
+}
+
+/**
+ * Builds the walk: a loop around the center circle, with the odometry for
+ * each frame, the observations seen after it and the true pose.
+ *
+ * @param kidnap Move the robot KIDNAP_ANGLE further round the loop at
+ *               KIDNAP_FRAME, leaving it out of the odometry
+ */
+static void makeWalk(vector<MotionModel> *odos,
+                     vector<vector<Observation> > *sightings,
+                     vector<PoseEst> *truth, bool kidnap)
+{
+    PoseEst pose(CENTER_FIELD_X, CENTER_FIELD_Y - WALK_RADIUS, 0.0f);
+    const MotionModel step(WALK_STEP, 0.0f, WALK_STEP / WALK_RADIUS);
+
+    for (int f = 0; f < WALK_FRAMES; ++f) {
+        pose += step;
+        if (kidnap && f == KIDNAP_FRAME) {
+            // The loop's pose at heading h is the center plus
+            // R (sin h, -cos h)
+            pose.h += KIDNAP_ANGLE;
+            pose.x = CENTER_FIELD_X + WALK_RADIUS * sinf(pose.h);
+            pose.y = CENTER_FIELD_Y - WALK_RADIUS * cosf(pose.h);
+        }
+        pose.h = NBMath::subPIAngle(pose.h);
+        odos->push_back(step);
+        sightings->push_back(walkObservations(pose));
+        truth->push_back(pose);
+    }
+}
+
+// FNV-1a over the bits of every particle
+static unsigned int particleChecksum(const MCL& mcl)
+{
+    const vector<Particle> particles = mcl.getParticles();
+    unsigned int hash = 2166136261u;
+    for (unsigned int i = 0; i < particles.size(); ++i) {
+        const float values[] = { particles[i].pose.x, particles[i].pose.y,
+                                 particles[i].pose.h, particles[i].weight };
+        const unsigned char *bytes =
+            reinterpret_cast<const unsigned char*>(values);
+        for (unsigned int b = 0; b < sizeof(values); ++b) {
+            hash = (hash ^ bytes[b]) * 16777619u;
+        }
+    }
+    return hash;
+}
+
+int main(int argc, char** argv)
+{
+    bool walk = false, kidnap = false, vectorKernel = false, compare = false;
+    bool proportional = false, kld = false;
+    int threads = 1;
+    unsigned int seed = 1;
+    boost::shared_ptr<LineGrid> lineGrid;
+    vector<int> counts;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-walk") == 0) {
+            walk = true;
+        } else if (strcmp(argv[i], "-kidnap") == 0) {
+            walk = kidnap = true;
+        } else if (strcmp(argv[i], "-proportional") == 0) {
+            proportional = true;
+        } else if (strcmp(argv[i], "-kld") == 0) {
+            kld = true;
+        } else if (strcmp(argv[i], "-vector") == 0) {
+            vectorKernel = true;
+        } else if (strcmp(argv[i], "-compare") == 0) {
+            compare = true;
+        } else if (strcmp(argv[i], "-threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-seed") == 0 && i + 1 < argc) {
+            seed = static_cast<unsigned int>(strtoul(argv[++i], 0, 10));
+        } else if (strcmp(argv[i], "-lineGrid") == 0 && i + 1 < argc) {
+            lineGrid = boost::shared_ptr<LineGrid>(new LineGrid());
+            if (!lineGrid->map(argv[++i])) {
+                cerr << "Could not map the line grid " << argv[i] << endl;
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-linePoints") == 0 && i + 1 < argc) {
+            linePoints = atoi(argv[++i]);
+        } else {
+            counts.push_back(atoi(argv[i]));
+        }
+    }
+    if (counts.empty()) {
+        const int defaults[] = {100, 200, 500, 1000, 2000, 5000, 10000};
+        counts.assign(defaults, defaults + sizeof(defaults)/sizeof(int));
+    }
+#ifndef MCL_VECTOR_KERNEL
+    if (vectorKernel || compare) {
+        cerr << "The vector likelihood kernel is not built on this machine"
+             << endl;
+        return 1;
+    }
+#endif
+
+    vector<MotionModel> odos;
+    vector<vector<Observation> > sightings;
+    vector<PoseEst> truth;
+    if (walk) {
+        makeWalk(&odos, &sightings, &truth, kidnap);
+    } else {
+        odos.assign(1, MotionModel(2.0f, 0.0f, 0.01f));
+        sightings.assign(1, makeObservations());
+    }
+
+    int seenLines = 0, seenPoints = 0;
+    for (unsigned int f = 0; f < sightings.size(); ++f) {
+        for (unsigned int i = 0; i < sightings[f].size(); ++i) {
+            ++(sightings[f][i].isLine() ? seenLines : seenPoints);
+        }
+    }
+    cout << fixed << setprecision(1)
+         << static_cast<float>(seenPoints) / sightings.size()
+         << " points and "
+         << static_cast<float>(seenLines) / sightings.size()
+         << " lines seen per frame" << endl;
+
+    cout << setw(10) << "particles" << setw(10) << "frames"
+         << setw(14) << "us/update" << setw(14) << "ns/particle"
+         << setw(10) << "mean M" << setw(14) << "allocs/update";
+    if (walk) {
+        cout << setw(12) << "error cm";
+    }
+    if (kidnap) {
+        cout << setw(10) << "recover";
+    }
+    cout << setw(12) << "checksum" << endl;
+
+    for (unsigned int i = 0; i < counts.size(); ++i) {
+        const int M = counts[i];
+        // Keep the total work per row roughly constant
+        const int frames = walk ? WALK_FRAMES : max(20, 1000000 / M);
+
+        MCL mcl(M);
+        mcl.setUseVectorLikelihood(vectorKernel);
+        mcl.setUseProportionalResample(proportional);
+        mcl.setUseKLDSampling(kld);
+        mcl.setThreads(threads);
+        mcl.setLineGrid(lineGrid);
+        mcl.setSeed(seed);
+#ifdef MCL_VECTOR_KERNEL
+        // Particles spread over the field, many floored by the scalar model
+        if (compare) {
+            mcl.compareLikelihoodKernels(sightings[0], 3);
+        }
+#endif
+        // Warm up, so the stored observations have grown to what is seen.
+        // The walk is walked once and the filter started over.
+        if (!walk) {
+            for (int f = 0; f < 5; ++f) {
+                mcl.updateLocalization(odos[0], sightings[0]);
+            }
+        } else {
+            for (int f = 0; f < frames; ++f) {
+                mcl.updateLocalization(odos[f], sightings[f]);
+            }
+            mcl.reset();
+        }
+
+        double error = 0, particles = 0;
+        int lastLost = -1;
+        const long allocsBefore = allocations;
+        const long long start = micro_time();
+        for (int f = 0; f < frames; ++f) {
+            const unsigned int s = walk ? f : 0;
+            mcl.updateLocalization(odos[s], sightings[s]);
+            particles += mcl.getNumParticles();
+            if (walk) {
+                const double e = hypot(mcl.getXEst() - truth[f].x,
+                                       mcl.getYEst() - truth[f].y);
+                if (f >= frames / 2) {
+                    error += e;
+                }
+                if (!(e < RECOVERED_ERROR)) {
+                    lastLost = f;
+                }
+            }
+        }
+        const long long elapsed = micro_time() - start;
+        const long allocs = allocations - allocsBefore;
+
+        const double perUpdate = static_cast<double>(elapsed) / frames;
+        cout << setw(10) << M << setw(10) << frames
+             << setw(14) << fixed << setprecision(1) << perUpdate
+             << setw(14) << setprecision(1)
+             << perUpdate * 1000.0 * frames / particles
+             << setw(10) << setprecision(0) << particles / frames
+             << setw(14) << setprecision(2)
+             << static_cast<double>(allocs) / frames;
+        if (walk) {
+            cout << setw(12) << setprecision(1) << error / (frames / 2);
+        }
+        if (kidnap) {
+            if (lastLost == frames - 1) {
+                cout << setw(10) << "never";
+            } else {
+                cout << setw(10) << max(0, lastLost - KIDNAP_FRAME + 1);
+            }
+        }
+        cout << setw(12) << hex << particleChecksum(mcl) << dec << endl;
+
+#ifdef MCL_VECTOR_KERNEL
+        // Particles gathered around the robot
+        if (compare) {
+            mcl.compareLikelihoodKernels(sightings[walk ? frames - 1 : 0], 3);
+        }
+#endif
+    }
+
+    return 0;
+}
@@ -84,6 +84,14 @@ Ball::Ball(Vision* vis, Threshold* thr, Field* fie, int _color)
 	blobs = new Blobs(MAX_BALLS);
     init(0.0);
     allocateColorRuns();
+#ifdef OFFLINE
+    candidateFrames = 0;
+    candidateTime = 0;
+    candidates = ballsFound = 0;
+    for (int i = 0; i < NUM_SCREENS; i++) {
+        screened[i] = 0;
+    }
+#endif
 }
 
 
@@ -108,9 +116,41 @@ void Ball::init(float s)
  */
 
 void Ball::createBall(int h) {
+#ifdef OFFLINE
+        const long long start = micro_time();
         balls(h, vision->ball);
+        candidateTime += micro_time() - start;
+        candidateFrames++;
+#else
+        balls(h, vision->ball);
+#endif
 }
 
+#ifdef OFFLINE
+/* Where the ball search screened its candidates and how long it took, over
+ * every frame so far.  frameReplay -s prints it after replaying logged
+ * frames, preferably ones with plenty of orange that is not the ball
+ * (robots, red jerseys); the profiler's P_OBJECT times the rest.
+ */
+void Ball::printCandidateStats() {
+    static const char *names[NUM_SCREENS] = {
+        "horizon", "size", "color", "surround"
+    };
+    if (candidateFrames == 0) {
+        return;
+    }
+    const float frames = static_cast<float>(candidateFrames);
+    print("ball candidates: %d frames, ball %.0f us/frame, "
+          "%.1f candidates/frame, %d balls", candidateFrames,
+          static_cast<float>(candidateTime) / frames,
+          static_cast<float>(candidates) / frames, ballsFound);
+    for (int i = 0; i < NUM_SCREENS; i++) {
+        print("  screened for %-8s %.1f/frame", names[i],
+              static_cast<float>(screened[i]) / frames);
+    }
+}
+#endif
+
 
 /* See if there is a ball onscreen.  Basically we get all of the orange blobs
  * and test them for viability.  Once we've screened all of the obviously bad
@@ -178,15 +218,22 @@ int Ball::balls(int horizon, VisualBall *thisBall)
 		}
 	}
 
-    // pre-screen blobs that don't meet our criteria
+    // pre-screen blobs that don't meet our criteria.  The checks go cheapest
+	// first: where the blob is and how big it is cost nothing, only the
+	// blobs that pass them have their colors counted.
     //cout << "horizon " << horizon << " " << slope << endl;
     for (int i = 0; i < blobs->number(); i++) {
         int ar = blobs->get(i).getArea();
-        float perc = rightColor(blobs->get(i), ORANGE);
         int diam = max(blobs->get(i).width(), blobs->get(i).height());
 		if (blobs->get(i).getArea() > 0) {
+#ifdef OFFLINE
+			candidates++;
+#endif
 			if (blobs->get(i).getLeftBottomY() + diam <
 				horizonAt(blobs->get(i).getLeftTopX())) {
+#ifdef OFFLINE
+				screened[SCREEN_HORIZON]++;
+#endif
 				blobs->init(i);
 				if (BALLDEBUG) {
 					cout << "Screened one for horizon problems " << endl;
@@ -261,6 +308,9 @@ int Ball::balls(int horizon, VisualBall *thisBall)
 								cout << "Screened one that was too big " << diam << endl;
 								drawBlob(blobs->get(i), NAVY);
 							}
+#ifdef OFFLINE
+							screened[SCREEN_SIZE]++;
+#endif
 							blobs->init(i);
 						}
 					}
@@ -269,30 +319,46 @@ int Ball::balls(int horizon, VisualBall *thisBall)
 					int newHeight = blobs->get(i).width();
 					blobs->setBottom(i, blobs->get(i).getLeftTopY() + newHeight);
 				}
-			} else if (ar > MIN_AREA && perc > MINORANGEPERCENT) {
-				// don't do anything
-				if (BALLDEBUG) {
-					cout << "Candidate ball " << endl;
-					printBlob(blobs->get(i));
-				}
-			} else if (ar > MAX_AREA && rightHalfColor(blobs->get(i)) > MINORANGEPERCENT)
-			{
+			} else if (ar <= MIN_AREA) {
 				if (BALLDEBUG) {
-					cout << "Candidate ball " << endl;
+					drawBlob(blobs->get(i), BLACK);
 					printBlob(blobs->get(i));
+					cout << "Screened one for being too small - its area is " << ar << endl;
 				}
+#ifdef OFFLINE
+				screened[SCREEN_SIZE]++;
+#endif
+				blobs->init(i);
 			} else {
-				if (BALLDEBUG) {
-					drawBlob(blobs->get(i), BLACK);
-					printBlob(blobs->get(i));
-					if (perc < MINORANGEPERCENT) {
+				// one pass over the blob does for both color checks
+				ballColors colors;
+				countColors(blobs->get(i), colors);
+				float perc = rightColor(blobs->get(i), ORANGE, colors);
+				if (perc > MINORANGEPERCENT) {
+					// don't do anything
+					if (BALLDEBUG) {
+						cout << "Candidate ball " << endl;
+						printBlob(blobs->get(i));
+					}
+				} else if (ar > MAX_AREA &&
+						   rightHalfColor(blobs->get(i), colors) > MINORANGEPERCENT)
+				{
+					if (BALLDEBUG) {
+						cout << "Candidate ball " << endl;
+						printBlob(blobs->get(i));
+					}
+				} else {
+					if (BALLDEBUG) {
+						drawBlob(blobs->get(i), BLACK);
+						printBlob(blobs->get(i));
 						cout << "Screened one for not being orange enough, its percentage is "
 							 << perc << endl;
-					} else {
-						cout << "Screened one for being too small - its area is " << ar << endl;
 					}
+#ifdef OFFLINE
+					screened[SCREEN_COLOR]++;
+#endif
+					blobs->init(i);
 				}
-				blobs->init(i);
 			}
 		}
     }
@@ -366,6 +432,9 @@ int Ball::balls(int horizon, VisualBall *thisBall)
                 drawBlob(*topBlob, BLACK);
                 cout << "Screening for lack of green and bad surround" << endl;
             }
+#ifdef OFFLINE
+			screened[SCREEN_SURROUND]++;
+#endif
 			topBlob->init();
             done = false;
         } else {
@@ -401,6 +470,9 @@ int Ball::balls(int horizon, VisualBall *thisBall)
 			// SORT OUT BALL INFORMATION
 			setBallInfo(w, h, thisBall);
 			done = true;
+#ifdef OFFLINE
+			ballsFound++;
+#endif
 			float distanceDifference = fabs(e.dist - thisBall->getDistance());
 			const float DISTANCE_MISMATCH = 50.0f;
 			/*if (distanceDifference > DISTANCE_MISMATCH &&
@@ -704,6 +776,70 @@ int Ball::horizonAt(int x) {
 }
 
 
+/* Count the colors of the pixels in a box, clipped to the image, into
+ * count (which is added to, not cleared).
+ * @param x      left edge of the box
+ * @param y      top edge
+ * @param w      width
+ * @param h      height
+ * @param count  pixels of each color
+ */
+void Ball::addColors(int x, int y, int w, int h, int *count)
+{
+    const int left = max(x, 0), right = min(x + w, IMAGE_WIDTH);
+    const int top = max(y, 0), bottom = min(y + h, IMAGE_HEIGHT);
+    for (int i = top; i < bottom; i++) {
+        const unsigned char *row = thresh->thresholded[i];
+        for (int j = left; j < right; j++) {
+            count[row[j]]++;
+        }
+    }
+}
+
+/* Count the colors in a ball candidate once, for rightColor() and
+ * rightHalfColor() both.  The rows are counted in three pieces so that the
+ * orange in the halves rightHalfColor() wants falls out of the running
+ * totals, and the inner loops are just table increments with no tests.
+ * @param b        the candidate ball
+ * @param colors   where the counts go
+ */
+void Ball::countColors(Blob b, ballColors &colors)
+{
+    for (int c = 0; c < BALL_COLOR_VALUES; c++) {
+        colors.count[c] = 0;
+    }
+    colors.bottomHalf = colors.leftHalf = colors.rightHalf = 0;
+
+    const int x = b.getLeftTopX();
+    const int y = b.getLeftTopY();
+    // rightHalfColor() leaves out the last row and column
+    const int spanX = b.width() - 1;
+    const int spanY = b.height() - 1;
+    const int cuts[3] = { spanX / 2, spanX, spanX + 1 };
+    int *count = colors.count;
+    for (int i = max(0, -y); i <= spanY && y + i < IMAGE_HEIGHT; i++) {
+        const unsigned char *row = thresh->thresholded[y + i];
+        int j = max(0, -x);
+        int orange[4];
+        orange[0] = count[ORANGE] + count[ORANGERED] + count[ORANGEYELLOW];
+        for (int piece = 0; piece < 3; piece++) {
+            const int end = min(cuts[piece], IMAGE_WIDTH - x);
+            for (; j < end; j++) {
+                count[row[x + j]]++;
+            }
+            orange[piece + 1] = count[ORANGE] + count[ORANGERED] +
+                count[ORANGEYELLOW];
+        }
+        if (i < spanY) {
+            colors.leftHalf += orange[1] - orange[0];
+            colors.rightHalf += orange[2] - orange[1];
+            if (i >= spanY / 2) {
+                colors.bottomHalf += orange[2] - orange[0];
+            }
+        }
+    }
+}
+
 /*  Normally we want our balls to be orange and can just check the number of
  * pixels within the blob
  * that are orange.  However, sometimes the balls are occluded.
@@ -712,51 +848,20 @@ int Ball::horizonAt(int x) {
  * different halves of the blob
  * to see if one of them is properly orange.
  * @param tempobj      the current ball candidate
+ * @param colors       its colors, from countColors()
  * @return             the best percentage we found
  */
 // only called on really big orange blobs
-float Ball::rightHalfColor(Blob tempobj)
+float Ball::rightHalfColor(Blob tempobj, const ballColors &colors)
 {
     const float COLOR_THRESH = 0.15f;
 	const float POOR_VALUE = 0.10f;
 
-    int x = tempobj.getLeftTopX();
-    int y = tempobj.getLeftTopY();
     int spanY = tempobj.height() - 1;
     int spanX = tempobj.width() - 1;
-    int good = 0, good1 = 0, good2 = 0;
-    int pix;
-    if (rightColor(tempobj, ORANGE) < COLOR_THRESH) return POOR_VALUE;
-    for (int i = spanY / 2; i < spanY; i++) {
-        for (int j = 0; j < spanX; j++) {
-            pix = thresh->thresholded[y + i][x + j];
-            if (y + i > -1 && x + j > -1 && (y + i) < IMAGE_HEIGHT &&
-                x + j < IMAGE_WIDTH && (pix == ORANGE || pix == ORANGERED ||
-										pix == ORANGEYELLOW)) {
-                good++;
-            }
-        }
-    }
-    for (int i = 0; i < spanY; i++) {
-        for (int j = 0; j < spanX / 2; j++) {
-            pix = thresh->thresholded[y + i][x + j];
-            if (y + i > -1 && x + j > -1 && (y + i) < IMAGE_HEIGHT &&
-                x + j < IMAGE_WIDTH && (pix == ORANGE || pix == ORANGERED ||
-										pix == ORANGEYELLOW)) {
-                good1++;
-            }
-        }
-    }
-    for (int i = 0; i < spanY; i++) {
-        for (int j = spanX / 2; j < spanX; j++) {
-            pix = thresh->thresholded[y + i][x + j];
-            if (y + i > -1 && x + j > -1 && (y + i) < IMAGE_HEIGHT &&
-                x + j < IMAGE_WIDTH && (pix == ORANGE || pix == ORANGERED ||
-										pix == ORANGEYELLOW)) {
-                good2++;
-            }
-        }
-    }
+    int good = colors.bottomHalf, good1 = colors.leftHalf,
+        good2 = colors.rightHalf;
+    if (rightColor(tempobj, ORANGE, colors) < COLOR_THRESH) return POOR_VALUE;
     if (BALLDEBUG) {
         cout << "Checking half color " << good << " " << good1 << " " <<
 			good2 << " " << (spanX * spanY / 2) << endl;
@@ -766,14 +871,28 @@ float Ball::rightHalfColor(Blob tempobj)
     return percent;
 }
 
+/* Checks out how much of the current blob is orange.
+ * @param tempobj     the candidate ball blob
+ * @param col         ???
+ * @return            the percentage (unless a special situation occurred)
+ */
+float Ball::rightColor(Blob tempobj, int col)
+{
+    if (tempobj.width() < 2 || tempobj.height() < 2) return false;
+    ballColors colors;
+    countColors(tempobj, colors);
+    return rightColor(tempobj, col, colors);
+}
+
 /* Checks out how much of the current blob is orange.
  * Also looks for too much red.
  * @param tempobj     the candidate ball blob
  * @param col         ???
+ * @param colors      the blob's colors, from countColors()
  * @return            the percentage (unless a special situation occurred)
  */
 
-float Ball::rightColor(Blob tempobj, int col)
+float Ball::rightColor(Blob tempobj, int col, const ballColors &colors)
 {
     const int MIN_BLOB_SIZE = 1000;
 	const float RED_PERCENT = 0.10f;
@@ -781,33 +900,14 @@ float Ball::rightColor(Blob tempobj, int col)
 	const float ORANGEYELLOW_PERCENT = 0.40f;
 	const float GOOD_PERCENT = 0.65f;
 
-    int x = tempobj.getLeftTopX();
-    int y = tempobj.getLeftTopY();
     int spanY = tempobj.height();
     int spanX = tempobj.width();
     if (spanX < 2 || spanY < 2) return false;
-    int good = 0;
-    int ogood = 0;
-    int orgood = 0;
-    int oygood = 0;
-    int red = 0;
-    for (int i = 0; i < spanY; i++) {
-        for (int j = 0; j < spanX; j++) {
-            int pix = thresh->thresholded[y + i][x + j];
-            if (y + i > -1 && x + j > -1 && (y + i) < IMAGE_HEIGHT &&
-                x + j < IMAGE_WIDTH && (pix == ORANGE || pix == ORANGERED ||
-                                        pix == ORANGEYELLOW)) {
-                good++;
-                if (pix == ORANGE)
-                    ogood++;
-                else if (pix == ORANGEYELLOW)
-                    oygood++;
-                else
-                    orgood++;
-            } else if (pix == RED)
-                red++;
-        }
-    }
+    int ogood = colors.count[ORANGE];
+    int orgood = colors.count[ORANGERED];
+    int oygood = colors.count[ORANGEYELLOW];
+    int good = ogood + orgood + oygood;
+    int red = colors.count[RED];
     // here's a big hack - if we have a ton of orange, let's say it is enough
 	// unless the percentage is really low
     if (BALLDEBUG) {
@@ -1216,41 +1316,31 @@ bool Ball::badSurround(Blob b) {
     int w = b.width();
     int h = b.height();
 	int surround = min(SURROUND, w/2);
-    int greens = 0, orange = 0, red = 0, borange = 0, pix, realred = 0,
-		yellows = 0;
+	int count[BALL_COLOR_VALUES];
 
 	// first collect information on the ball itself
-    for (int i = -1; i < w+1; i++) {
-        for (int j = -1; j < h+1; j++) {
-			if (x + i > -1 && x + i < IMAGE_WIDTH && y + j > -1 &&
-				y + j < IMAGE_HEIGHT) {
-				pix = thresh->thresholded[y + j][x + i];
-				if (pix == ORANGE)
-					borange++;
-			}
-        }
-    }
+	for (int c = 0; c < BALL_COLOR_VALUES; c++) {
+		count[c] = 0;
+	}
+	addColors(x - 1, y - 1, w + 2, h + 2, count);
+	int borange = count[ORANGE];
 
-	// now collect information on the area surrounding the ball
+	// now collect information on the area surrounding the ball, yellow only
+	// counts above it
     x = max(0, x - surround);
     y = max(0, y - surround);
     w = w + surround * 2;
     h = h + surround * 2;
-    for (int i = 0; i < w && x + i < IMAGE_WIDTH; i++) {
-        for (int j = 0; j < h && y + j < IMAGE_HEIGHT; j++) {
-            pix = thresh->thresholded[y + j][x + i];
-            if (pix == ORANGE || pix == ORANGEYELLOW)
-                orange++;
-            else if (pix == RED)
-                realred++;
-			else if (pix == ORANGERED)
-				red++;
-            else if (pix == GREEN)
-                greens++;
-			else if (pix == YELLOW && j < surround)
-				yellows++;
-        }
-    }
+	for (int c = 0; c < BALL_COLOR_VALUES; c++) {
+		count[c] = 0;
+	}
+	addColors(x, y, w, surround, count);
+	int yellows = count[YELLOW];
+	addColors(x, y + surround, w, h - surround, count);
+	int orange = count[ORANGE] + count[ORANGEYELLOW];
+	int realred = count[RED];
+	int red = count[ORANGERED];
+	int greens = count[GREEN];
     if (BALLDEBUG) {
         cout << "Surround information " << red << " " << realred << " "
 			 << orange << " " << borange << " " << greens << " "
@@ -1373,8 +1463,16 @@ bool Ball::rightBlobColor(Blob tempobj, float minpercent) {
     int spanX = tempobj.width();
     int spanY = tempobj.height();
     if (spanX < 2 || spanY < 2) return false;
-    int ny, nx, starty, startx;
     int good = 0, total = 0;
+#ifdef USE_INTEGRAL_IMAGE
+    const int left = max(x, 0), right = min(x + spanX, IMAGE_WIDTH) - 1;
+    const int top = max(y, 0), bottom = min(y + spanY, IMAGE_HEIGHT) - 1;
+    if (right >= left && bottom >= top) {
+        total = (right - left + 1) * (bottom - top + 1);
+        good = thresh->integrals.count(color, left, top, right, bottom);
+    }
+#else
+    int ny, nx, starty, startx;
     for (int i = 0; i < spanY; i++) {
         starty = y + i;
         startx = x;
@@ -1389,6 +1487,7 @@ bool Ball::rightBlobColor(Blob tempobj, float minpercent) {
             }
         }
     }
+#endif
     float percent = (float)good / (float) (total);
     if (percent > minpercent) {
         return true;
@@ -44,6 +44,16 @@ static const int MAX_NUM_BALL_RUNS = 500; //never use this!
 static const int BALL_RUNS_MALLOC_SIZE = 10000;
 static const int BAD_VALUE = -10000;
 static const int NOISE_SKIPS = 1;
+// thresholded pixels are bytes, so this many colors can turn up
+static const int BALL_COLOR_VALUES = 256;
+
+// Pixels of each color in a ball candidate's box, and how many are ball
+// colored in each of the halves rightHalfColor() looks at.  Counted in one
+// pass by Ball::countColors().
+struct ballColors {
+    int count[BALL_COLOR_VALUES];
+    int bottomHalf, leftHalf, rightHalf;
+};
 
 class Ball {
 public:
@@ -68,8 +78,10 @@ public:
     void createBall(int c);
 
     // ball stuff
+    void countColors(Blob obj, ballColors &colors);
     float rightColor(Blob obj, int c);
-    float rightHalfColor(Blob obj);
+    float rightColor(Blob obj, int c, const ballColors &colors);
+    float rightHalfColor(Blob obj, const ballColors &colors);
     bool greenCheck(Blob b);
     bool greenSide(Blob b);
     int scanOut(int start_x, int start_y, float slope,int dir);
@@ -95,6 +107,11 @@ public:
     void paintRun(int x,int y, int h, int c);
     void drawRun(const run& run, int c);
 
+#ifdef OFFLINE
+    // where balls() screened its candidates, for frameReplay -s
+    void printCandidateStats();
+#endif
+
 
 private:
     // class pointers
@@ -122,6 +139,17 @@ private:
     int numPoints;
     float points[MAX_BALL_POINTS*2];
 
+    void addColors(int x, int y, int w, int h, int *count);
+
+#ifdef OFFLINE
+    // where balls() screened its candidates, for printCandidateStats()
+    enum { SCREEN_HORIZON = 0, SCREEN_SIZE, SCREEN_COLOR,
+           SCREEN_SURROUND, NUM_SCREENS };
+    int candidateFrames;
+    long long candidateTime;
+    int candidates, screened[NUM_SCREENS], ballsFound;
+#endif
+
 };
 
 #endif // Ball_h_DEFINED
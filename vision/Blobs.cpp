@@ -33,6 +33,7 @@ Blobs::Blobs(int howMany) {
 	for (int i = 0; i < howMany; i++) {
 		blobs[i] = Blob();
 	}
+	active = (int*)malloc(sizeof(int) * howMany);
 	init();
 }
 
@@ -42,6 +43,9 @@ void Blobs::init() {
 		blobs[i].init();
 	}
 	numBlobs = 0;
+	numActive = 0;
+	sweepX = 0;
+	droppedRuns = 0;
 }
 
 void Blobs::setLeft(int i, int x) {
@@ -64,6 +68,10 @@ void Blobs::setBottom(int i, int y) {
 	blobs[i].setRightBottomY(y);
 }
 
+void Blobs::setPixels(int i, int p) {
+	blobs[i].setPixels(p);
+}
+
 /*
  * Pseudo-blobbing used for goal recognition.  Since the goals are rectangles we
  * should be able to just paste the new runs in to a main blob directly.
@@ -74,6 +82,16 @@ void Blobs::setBottom(int i, int y) {
  * an existing run or create a new run. In theory we can fragment runs this way.
  * In fact, we should probably check on that.
  *
+ * The runs come in column order, and a blob can only take a run that starts
+ * less than WHAT_IS_CONTIGUOUS columns past its right edge.  So rather than
+ * checking every blob we keep a list (in blob order) of those still within
+ * reach of the current column, and drop blobs from it as the columns move
+ * past them.  Which blob a run joins is the same as checking them all.  If
+ * a run ever comes in left of the last one we just start over with all blobs.
+ *
+ * When there is no room for another blob the run is dropped (and counted, see
+ * dropped()); the blobs we have are kept.
+ *
  * @param x        x value of run
  * @param y        y value of run
  * @param h        height of run
@@ -81,28 +99,31 @@ void Blobs::setBottom(int i, int y) {
 void Blobs::blobIt(int x, int y, int h)
 {
     const int WHAT_IS_CONTIGUOUS = 4;  // fudge factor for juding contiguity
-    const int MIN_BLOB_SIZE = 20;      // number of blobs before changing standard
-
-    // start out deciding to make a new blob
-    // the loop will decide not to run it
-    bool newBlob = true;
-    int contig = WHAT_IS_CONTIGUOUS;
+    const int contig = WHAT_IS_CONTIGUOUS;
 
     //cout << x << " " << y << " " << h << endl;
-    // sanity check: too many blobs on screen
-    if (numBlobs >= total) {
-        //cout << "Ran out of blob space " << color << endl;
-        // We're seeing too many blobs -it is unlikely we can do anything
-        // useful with this color
-        numBlobs = 0;
-        numberOfRuns = 0;
-        return;
-    } else if (numBlobs > MIN_BLOB_SIZE) {
-        contig = WHAT_IS_CONTIGUOUS;
+    if (x < sweepX) {
+        // out of order, every blob is back in reach
+        for (int i = 0; i < numBlobs; i++) {
+            active[i] = i;
+        }
+        numActive = numBlobs;
+        sweepX = x;
+    } else if (x > sweepX) {
+        // forget the blobs the sweep has moved past
+        int kept = 0;
+        for (int a = 0; a < numActive; a++) {
+            if (blobs[active[a]].getRightTopX() + contig > x) {
+                active[kept++] = active[a];
+            }
+        }
+        numActive = kept;
+        sweepX = x;
     }
 
     // is this run contiguous with any previous blob?
-    for (int i = 0; i < numBlobs; i++) {
+    for (int a = 0; a < numActive; a++) {
+        Blob &blob = blobs[active[a]];
 
         // first check: if currentBlob x is greater than blob left and less than
         // a little bit more than the blob right.
@@ -110,63 +131,68 @@ void Blobs::blobIt(int x, int y, int h)
         // second check: currentBlob y is within fits within current blob
         // OR
         // currentBlob's bottom is within blob and height makes it higher
-        if ((x > blobs[i].getLeftTopX()  && x < blobs[i].getRightTopX()
-			 + contig) && ((y >= blobs[i].getLeftTopY() - contig &&
-							y < blobs[i].getLeftBottomY() + contig) ||
-						   (y < blobs[i].getLeftTopY() &&
-							y+h+contig > blobs[i].getLeftTopY()))) {
+        if ((x > blob.getLeftTopX()  && x < blob.getRightTopX()
+			 + contig) && ((y >= blob.getLeftTopY() - contig &&
+							y < blob.getLeftBottomY() + contig) ||
+						   (y < blob.getLeftTopY() &&
+							y+h+contig > blob.getLeftTopY()))) {
 
             /* BOUNDING BOX CHECKS
              * if current x or y increases the size of the box, do so and keep
              * track of the corresponding x or y value
              */
             //assign the right, if it is better
-            if (x > blobs[i].getRightTopX()) {
-                blobs[i].setRightTopX(x);
-                blobs[i].setRightBottomX(x);
+            if (x > blob.getRightTopX()) {
+                blob.setRightTopX(x);
+                blob.setRightBottomX(x);
             }
 
             //assign the top, if it is better
-            if (blobs[i].getLeftTopY() > y) {
-                blobs[i].setLeftTopY(y);
-                blobs[i].setRightTopY(y);
+            if (blob.getLeftTopY() > y) {
+                blob.setLeftTopY(y);
+                blob.setRightTopY(y);
             }
 
             // assign the bottom, if it is better
-            if (y+h > blobs[i].getLeftBottomY()) {
-                blobs[i].setLeftBottomY(y+h);
-                blobs[i].setRightBottomY(y + h);
+            if (y+h > blob.getLeftBottomY()) {
+                blob.setLeftBottomY(y+h);
+                blob.setRightBottomY(y + h);
             }
 
             //add the run length to the number of real pixels in the blob
             //calculate the area of this blob under consideration
-            int s = (blobs[i].getRightTopX() - blobs[i].getLeftTopX() + 1) *
-                (blobs[i].getLeftBottomY() - blobs[i].getLeftTopY() + 1);
-            blobs[i].setArea(s); //store the area for later.
-            blobs[i].setPixels(blobs[i].getPixels() + h);
+            int s = (blob.getRightTopX() - blob.getLeftTopX() + 1) *
+                (blob.getLeftBottomY() - blob.getLeftTopY() + 1);
+            blob.setArea(s); //store the area for later.
+            blob.setPixels(blob.getPixels() + h);
 
             // don't create a blob
-            newBlob = false;
-            break;
+            return;
         }
         // no else
     } // END blob for loop
 
-    // create newBlob
-    if (newBlob) {
-        // bounding box
-        blobs[numBlobs].setLeftTopX(x);
-        blobs[numBlobs].setLeftTopY(y);
-        blobs[numBlobs].setRightTopX(x);
-        blobs[numBlobs].setRightTopY(y);
-        blobs[numBlobs].setLeftBottomX(x);
-        blobs[numBlobs].setLeftBottomY(y + h);
-        blobs[numBlobs].setRightBottomX(x);
-        blobs[numBlobs].setRightBottomY(y + h);
-        blobs[numBlobs].setPixels(h);
-        blobs[numBlobs].setArea(h);
-        numBlobs++;
+    // sanity check: too many blobs on screen
+    if (numBlobs >= total) {
+        //cout << "Ran out of blob space " << endl;
+        droppedRuns++;
+        return;
     }
+
+    // create newBlob
+    // bounding box
+    blobs[numBlobs].setLeftTopX(x);
+    blobs[numBlobs].setLeftTopY(y);
+    blobs[numBlobs].setRightTopX(x);
+    blobs[numBlobs].setRightTopY(y);
+    blobs[numBlobs].setLeftBottomX(x);
+    blobs[numBlobs].setLeftBottomY(y + h);
+    blobs[numBlobs].setRightBottomX(x);
+    blobs[numBlobs].setRightBottomY(y + h);
+    blobs[numBlobs].setPixels(h);
+    blobs[numBlobs].setArea(h);
+    active[numActive++] = numBlobs;
+    numBlobs++;
 }
 
 /*
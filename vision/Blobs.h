@@ -22,6 +22,7 @@ public:
 	void setRight(int which, int a);
 	void setTop(int which, int a);
 	void setBottom(int which, int a);
+	void setPixels(int which, int p);
 	Blob* getTopAndMerge(int maxY);
 	Blob* getWidest();
 	void zeroTheBlob(int which);
@@ -29,6 +30,8 @@ public:
 
 // getters
 	int number() {return numBlobs;}
+	// runs since init() that found no blob and no room for a new one
+	int dropped() {return droppedRuns;}
 	Blob get(int which) {return blobs[which];}
 
 private:
@@ -42,5 +45,11 @@ private:
     int numBlobs;
     //blob checker, obj, pole, leftBox, rightBox;
     Blob* blobs;
+
+    // blobs still in reach of the column blobIt() is at, in blob order
+    int* active;
+    int numActive;
+    int sweepX;
+    int droppedRuns;
 };
 #endif
@@ -0,0 +1,186 @@
+// This file is part of Man, a robotic perception, locomotion, and
+// team strategy application created by the Northern Bites RoboCup
+// team of Bowdoin College in Brunswick, Maine, for the Aldebaran
+// Nao robot.
+//
+// Man is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Man is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// and the GNU Lesser Public License along with Man.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <map>
+#include <string>
+
+#include "ColorTable.h"
+
+using namespace std;
+
+static const char CTB_MAGIC[4] = { 'N', 'B', 'C', 'T' };
+
+// Until a table is loaded every lookup lands on a single row of zeros (GREY)
+CompactColorTable::CompactColorTable()
+    : rows(VMAX, 0), numRows(1)
+{
+    memset(rowIndex, 0, sizeof(rowIndex));
+}
+
+/* Collapse a flat color cube into distinct rows.  Rows are keyed by their
+ * contents, so identical rows anywhere in the cube share storage.
+ * @param cube      YMAX * UMAX * VMAX colors, laid out like bigTable
+ */
+void CompactColorTable::build(const unsigned char *cube)
+{
+    map<string, unsigned short> seen;
+    rows.clear();
+    numRows = 0;
+
+    for (int y = 0; y < YMAX; y++) {
+        for (int u = 0; u < UMAX; u++) {
+            const unsigned char *row = cube + ((y << UV_BITS) | (u << V_BITS));
+            const string key(reinterpret_cast<const char*>(row), VMAX);
+
+            map<string, unsigned short>::iterator i = seen.find(key);
+            if (i == seen.end()) {
+                // YMAX * UMAX rows at most, which always fits in 16 bits
+                i = seen.insert(make_pair(key, static_cast<unsigned short>(
+                                              numRows))).first;
+                rows.insert(rows.end(), row, row + VMAX);
+                numRows++;
+            }
+            rowIndex[y][u] = i->second;
+        }
+    }
+}
+
+/* Read a compact table in .ctb format (see ColorTable.h).
+ * @return   false if the file is not a .ctb for this table size
+ */
+bool CompactColorTable::read(FILE *fp)
+{
+    char magic[4];
+    int dims[4];
+    if (fread(magic, sizeof(char), 4, fp) != 4 ||
+        memcmp(magic, CTB_MAGIC, 4) != 0 ||
+        fread(dims, sizeof(int), 4, fp) != 4 ||
+        dims[0] != YMAX || dims[1] != UMAX || dims[2] != VMAX ||
+        dims[3] < 1 || dims[3] > YMAX * UMAX) {
+        return false;
+    }
+
+    unsigned short index[YMAX][UMAX];
+    vector<unsigned char> newRows(dims[3] * VMAX);
+    if (fread(index, sizeof(unsigned short), YMAX * UMAX, fp) !=
+        static_cast<size_t>(YMAX * UMAX) ||
+        fread(&newRows[0], sizeof(unsigned char), newRows.size(), fp) !=
+        newRows.size()) {
+        return false;
+    }
+    for (int y = 0; y < YMAX; y++) {
+        for (int u = 0; u < UMAX; u++) {
+            if (index[y][u] >= dims[3]) {
+                return false;
+            }
+        }
+    }
+
+    memcpy(rowIndex, index, sizeof(rowIndex));
+    rows.swap(newRows);
+    numRows = dims[3];
+    return true;
+}
+
+bool CompactColorTable::write(FILE *fp) const
+{
+    const int dims[4] = { YMAX, UMAX, VMAX, numRows };
+    return fwrite(CTB_MAGIC, sizeof(char), 4, fp) == 4 &&
+        fwrite(dims, sizeof(int), 4, fp) == 4 &&
+        fwrite(rowIndex, sizeof(unsigned short), YMAX * UMAX, fp) ==
+        static_cast<size_t>(YMAX * UMAX) &&
+        fwrite(&rows[0], sizeof(unsigned char), rows.size(), fp) ==
+        rows.size();
+}
+
+// What a buffer with no table in it reads: all GREY
+static const unsigned char EMPTY_CUBE[COLOR_CUBE_SIZE] = { 0 };
+
+ColorTableBuffer::ColorTableBuffer()
+    : cube(EMPTY_CUBE), mapping(0)
+{
+}
+
+ColorTableBuffer::~ColorTableBuffer()
+{
+    release();
+}
+
+/* Map a flat .mtb table.  The file must not be written to in place while it
+ * is mapped; write a new table to another file and rename it over the old.
+ * @return   false if the file can't be opened
+ */
+bool ColorTableBuffer::map(const char *filename)
+{
+    const int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return false;
+    }
+
+    release();
+    if (static_cast<size_t>(info.st_size) >= COLOR_CUBE_SIZE) {
+        void *m = mmap(0, COLOR_CUBE_SIZE, PROT_READ, MAP_SHARED, fd, 0);
+        if (m != MAP_FAILED) {
+            // start reading it in now, rather than on the first frame
+            madvise(m, COLOR_CUBE_SIZE, MADV_WILLNEED);
+            mapping = m;
+            cube = static_cast<const unsigned char*>(m);
+            close(fd);
+            return true;
+        }
+    }
+
+    // a short file (mapping past its end would fault) is read in instead
+    unsigned char *to = allocate();
+    size_t got = 0;
+    ssize_t n;
+    while (got < COLOR_CUBE_SIZE &&
+           (n = read(fd, to + got, COLOR_CUBE_SIZE - got)) > 0) {
+        got += n;
+    }
+    close(fd);
+    return true;
+}
+
+unsigned char* ColorTableBuffer::allocate()
+{
+    release();
+    memory.assign(COLOR_CUBE_SIZE, 0);
+    cube = &memory[0];
+    return &memory[0];
+}
+
+void ColorTableBuffer::release()
+{
+    if (mapping != 0) {
+        munmap(mapping, COLOR_CUBE_SIZE);
+        mapping = 0;
+    }
+    cube = EMPTY_CUBE;
+}
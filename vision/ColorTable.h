@@ -0,0 +1,147 @@
+// This file is part of Man, a robotic perception, locomotion, and
+// team strategy application created by the Northern Bites RoboCup
+// team of Bowdoin College in Brunswick, Maine, for the Aldebaran
+// Nao robot.
+//
+// Man is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Man is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// and the GNU Lesser Public License along with Man.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/**
+ * Color table constants and the compact color table.
+ *
+ * The flat color table is a YMAX x UMAX x VMAX cube of colors, 2 MB at full
+ * resolution, and a frame's worth of lookups wanders all over it.  Most of
+ * the cube is GREY and neighboring (y, u) rows are very often identical, so
+ * the compact table keeps every distinct row of VMAX colors only once and
+ * maps each (y, u) pair to its row with a 16 bit index.  A real table
+ * collapses to the 32 KB index plus a few hundred KB of rows, and the rows a
+ * frame actually touches are far fewer still.
+ *
+ * A compact table is built from a flat cube or read from a .ctb file, which
+ * is written by vision/offline/tableConvert from an .mtb file.  The .ctb
+ * format is:
+ *    "NBCT"                      4 byte magic
+ *    YMAX, UMAX, VMAX, numRows   4 byte ints, host byte order
+ *    row index                   YMAX * UMAX unsigned shorts
+ *    rows                        numRows * VMAX bytes
+ *
+ * A ColorTableBuffer holds one table as Threshold uses it.  An .mtb file is
+ * just the flat cube, so it is mapped read-only rather than read in: loading
+ * copies nothing, and the pages are shared with the page cache.  Threshold
+ * keeps two buffers, so a new table can be loaded into one while the other
+ * is in use, and swaps them between frames.
+ */
+
+#ifndef ColorTable_h_DEFINED
+#define ColorTable_h_DEFINED
+
+#include <stdio.h>
+#include <stddef.h>
+#include <vector>
+
+//
+// COLOR TABLE CONSTANTS
+// remember to change both values when chaning the color tables
+
+//these must be changed everytime we load a new table
+#ifdef SMALL_TABLES
+#define YSHIFT  3
+#define USHIFT  2
+#define VSHIFT  2
+#define YMAX  32
+#define UMAX  64
+#define VMAX  64
+#define V_BITS  6
+#define UV_BITS 12
+#else
+#define YSHIFT  1
+#define USHIFT  1
+#define VSHIFT  1
+#define YMAX  128
+#define UMAX  128
+#define VMAX  128
+#define V_BITS  7
+#define UV_BITS 14
+#endif
+
+class CompactColorTable
+{
+public:
+    CompactColorTable();
+    virtual ~CompactColorTable() {}
+
+    // build from a flat YMAX * UMAX * VMAX cube, e.g. bigTable
+    void build(const unsigned char *cube);
+    bool read(FILE *fp);
+    bool write(FILE *fp) const;
+
+    // Same lookup as bigTable[y][u][v], indices already shifted
+    inline unsigned char lookup(int y, int u, int v) const {
+        return rows[rowIndex[y][u] * VMAX + v];
+    }
+
+    // Lookup with a flat cube offset, (y << UV_BITS) | (u << V_BITS) | v
+    inline unsigned char at(unsigned int index) const {
+        return rows[(&rowIndex[0][0])[index >> V_BITS] * VMAX +
+                    (index & (VMAX - 1))];
+    }
+
+    // where the row for (y, u) starts among the rows, in bytes
+    int rowOffset(int y, int u) const { return rowIndex[y][u] * VMAX; }
+
+    int getNumRows() const { return numRows; }
+    int getByteSize() const {
+        return static_cast<int>(sizeof(rowIndex)) + numRows * VMAX;
+    }
+
+private:
+    unsigned short rowIndex[YMAX][UMAX];
+    std::vector<unsigned char> rows;
+    int numRows;
+};
+
+// bytes in a flat color cube, and so in an .mtb file
+static const size_t COLOR_CUBE_SIZE = YMAX * UMAX * VMAX;
+
+class ColorTableBuffer
+{
+public:
+    ColorTableBuffer();
+    virtual ~ColorTableBuffer();
+
+    // Map an .mtb file; short files are read in and padded with GREY
+    bool map(const char *filename);
+    // Memory for a flat cube, to be filled in by the caller
+    unsigned char* allocate();
+    // Let go of the cube, which is then all GREY
+    void release();
+
+    // the flat cube, laid out like bigTable
+    const unsigned char* getCube() const { return cube; }
+    bool isMapped() const { return mapping != 0; }
+
+    // the compact version of the table, which callers build or read in
+    CompactColorTable compact;
+
+private:
+    // not copyable, the mapping belongs to us
+    ColorTableBuffer(const ColorTableBuffer&);
+    ColorTableBuffer& operator=(const ColorTableBuffer&);
+
+    const unsigned char *cube;
+    void *mapping;
+    std::vector<unsigned char> memory;
+};
+
+#endif // ColorTable_h_DEFINED
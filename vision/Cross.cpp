@@ -270,8 +270,16 @@ bool Cross::rightBlobColor(Blob tempobj, float minpercent) {
     int spanX = tempobj.width();
     int spanY = tempobj.height();
     if (spanX < 1 || spanY < 1) return false;
-    int ny, nx, starty, startx;
     int good = 0, total = 0;
+#ifdef USE_INTEGRAL_IMAGE
+    const int left = max(x, 0), right = min(x + spanX, IMAGE_WIDTH) - 1;
+    const int top = max(y, 0), bottom = min(y + spanY, IMAGE_HEIGHT) - 1;
+    if (right >= left && bottom >= top) {
+        total = (right - left + 1) * (bottom - top + 1);
+        good = thresh->integrals.count(WHITE, left, top, right, bottom);
+    }
+#else
+    int ny, nx, starty, startx;
     for (int i = 0; i < spanY; i++) {
         starty = y + i;
         startx = x;
@@ -286,6 +294,7 @@ bool Cross::rightBlobColor(Blob tempobj, float minpercent) {
             }
         }
     }
+#endif
     float percent = (float)good / (float) (total);
     if (percent > minpercent) {
         return true;
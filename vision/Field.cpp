@@ -366,7 +366,7 @@ void Field::findConvexHull(int pH) {
 			int x = i * SCANSIZE;
 			if (i == HULLS - 1)
 				x--;
-			pixel = thresh->thresholded[top][x];
+			pixel = thresh->getColumnColor(x, top);
 			if (pixel == GREEN) {
 				good++;
 			} else if (pixel == BLUEGREEN || pixel == GREY) {
@@ -391,7 +391,7 @@ void Field::findConvexHull(int pH) {
 	// now do the Graham scanning algorithm
 	int M = 2;
 	for (int i = 2; i < HULLS; i++) {
-		while (ccw(convex[M-1], convex[M], convex[i]) <= 0 && M >= 1) {
+		while (M >= 1 && ccw(convex[M-1], convex[M], convex[i]) <= 0) {
 			M--;
 		}
 		M++;
@@ -569,9 +569,9 @@ int Field::findGreenHorizon(int pH, float sl) {
                     //cout << "scanY < 0, value is: " << scanY << endl;
                     scanY = 0;
                 }
-                if (scanY > IMAGE_HEIGHT) {
+                if (scanY >= IMAGE_HEIGHT) {
                     //cout << "scanY > IMAGE_HEIGHT, value is: " << scanY << endl;
-                    scanY = IMAGE_HEIGHT;
+                    scanY = IMAGE_HEIGHT - 1;
                 }
 
                 int newPixel = thresh->thresholded[scanY][j];
@@ -658,7 +658,7 @@ void Field::setShot(VisualCrossbar* one, int color)
 
         int strip = 0;
         for (int j = min(ly, ry); j < IMAGE_HEIGHT && shoot[i]; j++) {
-            pix = thresh->thresholded[j][i];
+            pix = thresh->getColumnColor(i, j);
             if (pix == color) {
                 strip++;
                 if (strip > MINIMUM_PIXELS)
@@ -963,7 +963,7 @@ void Field::openDirection(int horizon, NaoPose *pose)
         int maxH = max(0, horizonAt(x));
         //cout << "Got lines " << maxH << endl;
         for (y = IMAGE_HEIGHT - 1; y > maxH; y--) {
-            pix = thresh->thresholded[y][x];
+            pix = thresh->getColumnColor(x, y);
             if ((pix == RED || pix == NAVY)) {
                 bad++;
                 run++;
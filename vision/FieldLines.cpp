@@ -22,9 +22,12 @@
 /* Field Lines class */
 
 #include <algorithm>    // for sort() and merge()
+#include <iterator>     // for back_inserter()
+#include <limits>       // for numeric_limits
 #include <boost/shared_ptr.hpp>
 
 #include "FieldLines.h"
+#include "debug.h"
 using namespace std;
 
 
@@ -81,6 +84,13 @@ using namespace std;
 
 using boost::shared_ptr;
 
+// Orders lines by their length on the screen, see VisualLine::operator<
+static bool shorterLine(const shared_ptr<VisualLine> &a,
+                        const shared_ptr<VisualLine> &b)
+{
+    return *a < *b;
+}
+
 const int FieldLines::FIELD_COLORS[NUM_GREEN_COLORS] =
 { GREEN, BLUEGREEN };
 const int FieldLines::LINE_COLORS[NUM_WHITE_COLORS] =
@@ -88,7 +98,10 @@ const int FieldLines::LINE_COLORS[NUM_WHITE_COLORS] =
 
 const char * FieldLines::linePointInfoFile = "linepoints.xls";
 
-FieldLines::FieldLines(Vision *visPtr, shared_ptr<NaoPose> posePtr) {
+FieldLines::FieldLines(Vision *visPtr, shared_ptr<NaoPose> posePtr)
+    : unusedPointsList(ArenaAllocator<linePoint>(&lineArena)),
+      trackedPoints(ArenaAllocator<linePoint>(&lineArena))
+{
     vision = visPtr;
     pose = posePtr;
 
@@ -113,6 +126,14 @@ FieldLines::FieldLines(Vision *visPtr, shared_ptr<NaoPose> posePtr) {
     debugCornerAndObjectDistances = false;
     debugCcScan = false;
     standardView = true;//false;
+
+    trackingFrames = 0;
+    matchingCorners = 0;
+    for (int i = 0; i < TRACKING_MODES; i++) {
+        trackingTime[i] = 0;
+        trackingCorners[i] = keptCorners[i] = 0;
+        cornerMovement[i] = 0.0f;
+    }
 #endif
 
     // Makes setprecision dictate number of decimal places
@@ -122,33 +143,84 @@ FieldLines::FieldLines(Vision *visPtr, shared_ptr<NaoPose> posePtr) {
 // Main Line Loop. Calls all of the smaller line functions.  Order matters.
 void FieldLines::lineLoop() {
 
-    vector<linePoint> vertLinePoints;
+    // Last frame's corners are put aside to be filled in again, and let go
+    // of their lines so that those can be reused too
+    spareCorners.splice(spareCorners.end(), cornersList);
+    for (list<VisualCorner>::iterator i = spareCorners.begin();
+         i != spareCorners.end(); ++i) {
+        i->releaseLines();
+    }
+    // Nothing is left in the arena from last frame
+    unusedPointsList.clear();
+    lineArena.reset();
+
+    vertLinePoints.clear();
     findVerticalLinePoints(vertLinePoints);
 
-    vector<linePoint> horLinePoints;
+    horLinePoints.clear();
     findHorizontalLinePoints(horLinePoints);
 
     sort(horLinePoints.begin(), horLinePoints.end());
 
-    // Must allocate enough space to fit both hor and vert points into this list
-    list<linePoint> linePoints(vertLinePoints.size() + horLinePoints.size());
     merge(vertLinePoints.begin(), vertLinePoints.end(),
           horLinePoints.begin(), horLinePoints.end(),
-          linePoints.begin());
+          back_inserter(unusedPointsList));
 
-    createLines(linePoints); // Lines is a global member of FieldLines
+    linesList.clear();
 
-	joinLines();
-    //extendLines(linesList);
+    // Points along the lines we saw last frame are grouped on their own
+    // first, then whatever is left is grouped as usual
+    tracker.startFrame(*pose);
+    if (!tracker.isFullFrame()) {
+        groupTrackedPoints(unusedPointsList);
+    }
 
     // Only those linePoints which were not used in any line remain within the
-    // linePoints list
+    // list
     // unusedPoints is used by vision to draw points on the screen
-    unusedPointsList = linePoints;
+    createLines(unusedPointsList); // Lines is a global member of FieldLines
+
+	joinLines();
+    //extendLines(linesList);
+
 	fitUnusedPoints(linesList, unusedPointsList);
 
 	//removeDuplicateLines();
-    cornersList = intersectLines();
+    intersectLines(cornersList);
+
+    if (tracker.isEnabled()) {
+        trackLines();
+    }
+}
+
+/* Take the points lying along each line the tracker predicts, in turn, and
+ * make lines out of them.  The points that do not end up in a line go back
+ * into linePoints, which is kept in order.
+ */
+void FieldLines::groupTrackedPoints(LinePointList &linePoints) {
+    for (int i = 0; i < tracker.getNumPredicted(); i++) {
+        for (linePointNode p = linePoints.begin(); p != linePoints.end(); ) {
+            linePointNode next = p;
+            ++next;
+            if (tracker.isNearPrediction(i, p->x, p->y)) {
+                trackedPoints.splice(trackedPoints.end(), linePoints, p);
+            }
+            p = next;
+        }
+        if (!trackedPoints.empty()) {
+            createLines(trackedPoints);
+            linePoints.merge(trackedPoints);
+        }
+    }
+}
+
+// Hand this frame's lines to the tracker to look for next frame
+void FieldLines::trackLines() {
+    tracker.clearLines();
+    for (vector< shared_ptr<VisualLine> >::const_iterator
+             i = linesList.begin(); i != linesList.end(); ++i) {
+        tracker.addLine(*pose, (*i)->start, (*i)->end);
+    }
 }
 
 // While lineLoop is called before object recognition so that ObjectFragments
@@ -235,7 +307,7 @@ void FieldLines::findVerticalLinePoints(vector <linePoint> &points) {
 
 
             int current_y_value = vision->thresh->getY(x,y);
-            int thresholdedColor = vision->thresh->thresholded[y][x];
+            int thresholdedColor = vision->thresh->getColumnColor(x, y);
 
             bool isAtAnUphillEdge = isUphillEdge(current_y_value, last_y_value,
                                                  VERTICAL);
@@ -979,9 +1051,7 @@ const bool FieldLines::isDownhillEdge(const int new_y_value,
 // Attempts to create lines out of a list of linePoints.  In order for points
 // to be fit onto a line, they must pass a battery of sanity checks
 // Fills in the linesList of the FieldLines object
-void FieldLines::createLines(list <linePoint> &linePoints) {
-    vector < shared_ptr<VisualLine> > lines;
-
+void FieldLines::createLines(LinePointList &linePoints) {
 
     if (debugCreateLines)
         cout << "Grouping lines now with " << linePoints.size()
@@ -1002,12 +1072,12 @@ void FieldLines::createLines(list <linePoint> &linePoints) {
 
         // debug print
         if (debugCreateLines) {
-            cout << "MAIN LOOP: Scanning for potential line #" << lines.size() <<
+            cout << "MAIN LOOP: Scanning for potential line #" << linesList.size() <<
                 " with Point #" << counter << " (" << firstPoint->x
                  << ", " << firstPoint->y << ")" << endl;
         }
 
-        list<linePointNode> legitimateLinePoints;
+        legitimateLinePoints.clear();
         // we begin a line from this point so we consider it legitimate.
         legitimateLinePoints.push_back(firstPoint);
 
@@ -1168,7 +1238,7 @@ void FieldLines::createLines(list <linePoint> &linePoints) {
             if (debugCreateLines) {
                 cout << "\tSecond loop: Point "<< counter
                      << " passed all sanity checks: x2: " << pointX << " y2:"
-                     << pointY << " added to line " << lines.size() << endl;
+                     << pointY << " added to line " << linesList.size() << endl;
             }
 
             legitimateLinePoints.push_back(currentPoint);
@@ -1186,23 +1256,34 @@ void FieldLines::createLines(list <linePoint> &linePoints) {
             VisualLine::NUM_POINTS_TO_BE_VALID_LINE)
             firstPoint++;
         else {
-			shared_ptr<VisualLine> aLine(new VisualLine(legitimateLinePoints));
+			shared_ptr<VisualLine> aLine = takePooledLine();
+            for (vector<linePointNode>::const_iterator
+                     i = legitimateLinePoints.begin();
+                 i != legitimateLinePoints.end(); ++i) {
+                aLine->points.push_back(**i);
+            }
+            aLine->reset();
 			setLineCoordinates(aLine);
             if (debugCreateLines) {
-                cout << "\tSecond loop: adding line " << lines.size()
+                cout << "\tSecond loop: adding line " << linesList.size()
                      << " with " << legitimateLinePoints.size()
                      << " line points.\n";
             }
 
             drawLinePoints(legitimateLinePoints);
-            aLine->setColor(static_cast<int>(lines.size()) + BLUEGREEN);
-            aLine->setColorString(Utility::getColorString(aLine->color));
-            lines.push_back(aLine);
+            // A pooled line often gets back the color it had, in which case
+            // it has the name of the color already
+            const int color = static_cast<int>(linesList.size()) + BLUEGREEN;
+            if (aLine->color != color || aLine->colorStr.empty()) {
+                aLine->setColor(color);
+                aLine->setColorString(Utility::getColorString(color));
+            }
+            linesList.push_back(aLine);
 
             // Now we need to delete the linePoints that went into the newly
             // found line from the list of all linePoints.
             // :TRICKY: Modification of this code will likely lead to segfaults
-            for (list<linePointNode>::reverse_iterator
+            for (vector<linePointNode>::reverse_iterator
                      i = legitimateLinePoints.rbegin();
                  i != legitimateLinePoints.rend(); ++i) {
                 firstPoint = linePoints.erase(*i);
@@ -1219,12 +1300,31 @@ void FieldLines::createLines(list <linePoint> &linePoints) {
 
     if (debugCreateLines) {
         cout << linePoints.size() << " points remain after forming "
-             << lines.size() << " lines" << endl;
+             << linesList.size() << " lines" << endl;
     }
+}
 
-	// Update our current lines for this frame, still copying vector,
-	// maybe should be faster.
-    linesList = lines;
+/**
+ * A line nothing outside of FieldLines holds any more, with its points
+ * cleared, so the caller can fill it in again.  While the pool is growing
+ * (or if too many of its lines are held elsewhere) this is a new line.
+ * Vision::copyResults() counts on lines still held elsewhere never being
+ * handed out.
+ */
+shared_ptr<VisualLine> FieldLines::takePooledLine() {
+    for (vector< shared_ptr<VisualLine> >::iterator i = linePool.begin();
+         i != linePool.end(); ++i) {
+        if (i->unique()) {
+            (*i)->points.clear();
+            return *i;
+        }
+    }
+
+    shared_ptr<VisualLine> aLine(new VisualLine());
+    if (linePool.size() < MAX_POOLED_LINES) {
+        linePool.push_back(aLine);
+    }
+    return aLine;
 }
 
 /**
@@ -1234,7 +1334,7 @@ void FieldLines::createLines(list <linePoint> &linePoints) {
  * these actual endpoints requires a pixEstimate from the Pose,
  * so it can't be done within VisualLine (since it has no Pose info).
  */
-void FieldLines::setLineCoordinates(shared_ptr<VisualLine> aLine) {
+void FieldLines::setLineCoordinates(const shared_ptr<VisualLine> &aLine) {
 
 	point<int> imgStart = aLine->start;
 	const estimate startEst = pose->pixEstimate(imgStart.x, imgStart.y, 0.0f);
@@ -1268,8 +1368,8 @@ void FieldLines::setLineCoordinates(shared_ptr<VisualLine> aLine) {
 	aLine->setBearingWithSD( NBMath::subPIAngle(NBMath::safe_atan2(y_p, x_p)) );
 }
 
-void FieldLines::drawLinePoints(const list<linePointNode> &toDraw) const {
-    for (list<linePointNode>::const_iterator i = toDraw.begin();
+void FieldLines::drawLinePoints(const vector<linePointNode> &toDraw) const {
+    for (vector<linePointNode>::const_iterator i = toDraw.begin();
          i != toDraw.end(); ++i) {
         if ((*i)->foundWithScan == VERTICAL)
             drawLinePoint(**i, BLACK);
@@ -1278,8 +1378,8 @@ void FieldLines::drawLinePoints(const list<linePointNode> &toDraw) const {
     }
 }
 
-void FieldLines::drawLinePoints(const list<linePoint> &toDraw) const {
-    for (list<linePoint>::const_iterator i = toDraw.begin();
+void FieldLines::drawLinePoints(const LinePointList &toDraw) const {
+    for (LinePointList::const_iterator i = toDraw.begin();
          i != toDraw.end(); ++i) {
         if (i->foundWithScan == VERTICAL)
             drawLinePoint(*i, BLACK);
@@ -1300,12 +1400,17 @@ void FieldLines::drawCorners(const list<VisualCorner> &toDraw, int color) {
 // createLines function to the lines that were output from said function
 // CAUTION: Run after joinLines only.
 void FieldLines::fitUnusedPoints(vector< shared_ptr<VisualLine> > &lines,
-                                 list<linePoint> &remainingPoints) {
+                                 LinePointList &remainingPoints) {
 
     // Sort lines by length because we figure that the shortest line can most
     // benefit from adding more points to it and we want the algorithm to be
     // greedy for speed and simplicity's sake
-    sort(lines.begin(), lines.end());
+    // There are only ever a few lines; an insertion sort keeps lines of the
+    // same length in order without the buffer stable_sort() would allocate
+    for (vector< shared_ptr<VisualLine> >::iterator i = lines.begin();
+         i != lines.end(); ++i) {
+        rotate(upper_bound(lines.begin(), i, *i, shorterLine), i, i + 1);
+    }
 
     int numPointsRemainining = remainingPoints.size();
 
@@ -1317,7 +1422,7 @@ void FieldLines::fitUnusedPoints(vector< shared_ptr<VisualLine> > &lines,
     for (vector< shared_ptr<VisualLine> >::iterator i = lines.begin();
 		 i != lines.end(); ++i){
         bool foundAdditionalPoints = false;
-        list <linePoint> additionalPoints;
+        additionalPoints.clear();
         // We will manually increment the j counter so that we can delete points
         // from the list
         for (linePointNode j = remainingPoints.begin();
@@ -1537,8 +1642,8 @@ void FieldLines::joinLines() {
     for (vector < shared_ptr<VisualLine> >::iterator i = linesList.begin(); i != linesList.end();
          ++i) {
         for (vector <shared_ptr<VisualLine> >::iterator j = i + 1; j != linesList.end(); ++j) {
-            string iColor = Utility::getColorString((*i)->color);
-            string jColor = Utility::getColorString((*j)->color);
+            const string &iColor = (*i)->colorStr;
+            const string &jColor = (*j)->colorStr;
 
             if (debugJoinLines) {
                 cout <<"Attempting to join the " << iColor << " line "
@@ -2177,7 +2282,7 @@ const int FieldLines::findEdgeFromMiddleOfLine(int x, int y,
                 return j;
             }
             // We're in the field but we didn't see an edge.  No good.
-            else if (!isLineColor(vision->thresh->thresholded[j][x])) {
+            else if (!isLineColor(vision->thresh->getColumnColor(x, j))) {
                 //      else if (vision->thresh->thresholded[j][x] == GREEN) {
                 return NO_EDGE;
             }
@@ -2303,9 +2408,9 @@ void FieldLines::removeDuplicateLines() {
  * @return a vector of VisualCorners created from the intersection points that
  *         successfully pass all sanity checks.
  */
-list< VisualCorner > FieldLines::intersectLines() {
-    list <VisualCorner> corners;
-	list <point<int> > dupeCorners;
+void FieldLines::intersectLines(list<VisualCorner> &corners) {
+    spareCorners.splice(spareCorners.end(), corners);
+	dupeCorners.clear();
 
     if (debugIntersectLines) {
         cout <<"Beginning intersectLines() with " << linesList.size() << " lines.."
@@ -2332,8 +2437,8 @@ list< VisualCorner > FieldLines::intersectLines() {
         for (vector < shared_ptr<VisualLine> >::iterator j = i+1;
 			 j != linesList.end(); ++j) {
 
-            string iColor = (*i)->colorStr;
-            string jColor = (*j)->colorStr;
+            const string &iColor = (*i)->colorStr;
+            const string &jColor = (*j)->colorStr;
             int numChecksPassed = 0;
 
             // get intersection
@@ -2473,8 +2578,18 @@ list< VisualCorner > FieldLines::intersectLines() {
                                       LEGIT_INTERSECTION_POINT_COLOR);
             // assign x, y, dist, bearing, line i, line j, t value for line i,
             // t value for line 2
-            VisualCorner c(intersectX, intersectY, distance, bearing,
-                           *i, *j, t_I, t_J);
+            // The corner is made at the front of spareCorners, and only
+            // moved into corners if it is kept
+            if (spareCorners.empty()) {
+                spareCorners.push_back(VisualCorner(intersectX, intersectY,
+                                                    distance, bearing,
+                                                    *i, *j, t_I, t_J));
+            } else {
+                spareCorners.front().reset(intersectX, intersectY,
+                                           distance, bearing,
+                                           *i, *j, t_I, t_J);
+            }
+            VisualCorner &c = spareCorners.front();
  			if (isDupe) {
  				if (c.getShape() != T) {
  					isCCIntersection = false;
@@ -2506,7 +2621,7 @@ list< VisualCorner > FieldLines::intersectLines() {
 				continue;
 			}
 
-            corners.push_back(c);
+            corners.splice(corners.end(), spareCorners, spareCorners.begin());
 
             // TODO:  Should I be adding the intersection point to both lines?
 
@@ -2523,13 +2638,10 @@ list< VisualCorner > FieldLines::intersectLines() {
         }
         cout << "." << endl;
     }
-
-    return corners;
-
 }
 
-const bool FieldLines::isAngleTooSmall(shared_ptr<VisualLine> i,
-								 shared_ptr<VisualLine> j,
+const bool FieldLines::isAngleTooSmall(const shared_ptr<VisualLine> &i,
+								 const shared_ptr<VisualLine> &j,
 								 const int& numChecksPassed) const
 {
 	// Angle check: only intersect those lines that have a minimum angle
@@ -2565,8 +2677,8 @@ const bool FieldLines::isIntersectionOnScreen(const point<int>& intersection,
 	return true;
 }
 
-const bool FieldLines::isAngleOnFieldOkay(shared_ptr<VisualLine> i,
-									shared_ptr<VisualLine> j,
+const bool FieldLines::isAngleOnFieldOkay(const shared_ptr<VisualLine> &i,
+									const shared_ptr<VisualLine> &j,
 									const int& intersectX,
 									const int& intersectY,
 									const int& numChecksPassed) const
@@ -2617,8 +2729,8 @@ const bool FieldLines::tooMuchGreenAtCorner(const point<int>& intersection,
 // Too small check: ensure that at least one of the line segments is
 // long enough (if both are small it indicates we might be at the
 // center circle)
-const bool FieldLines::areLinesTooSmall(shared_ptr<VisualLine> i,
-								  shared_ptr<VisualLine> j,
+const bool FieldLines::areLinesTooSmall(const shared_ptr<VisualLine> &i,
+								  const shared_ptr<VisualLine> &j,
 								  const int& numChecksPassed) const
 {
 	int MIN_LENGTH_LINE_TO_INTERSECT = 30; // cm
@@ -2646,8 +2758,8 @@ const bool FieldLines::areLinesTooSmall(shared_ptr<VisualLine> i,
 // We parameterize the line such that x and y are functions of one
 // variable t. Then we figure out what t gives us the corner's
 // x coordinate. When t = 0, x = x1; when t = lineLength, x = x2;
-const bool FieldLines::doLinesCross(shared_ptr<VisualLine> i,
-							  shared_ptr<VisualLine> j,
+const bool FieldLines::doLinesCross(const shared_ptr<VisualLine> &i,
+							  const shared_ptr<VisualLine> &j,
 							  const float& t_I, const float& t_J,
 							  const int& numChecksPassed) const
 {
@@ -2694,8 +2806,8 @@ const bool FieldLines::isCornerTooFar(const float& distance,
 * both boxes contain the intersection, rather than testing whether
 * the lines themselves both contain the intersection
 */
-const bool FieldLines::areLineEndsCloseEnough(shared_ptr<VisualLine> i,
-										shared_ptr<VisualLine> j,
+const bool FieldLines::areLineEndsCloseEnough(const shared_ptr<VisualLine> &i,
+										const shared_ptr<VisualLine> &j,
 										const point<int>& intersection,
 										const int& numChecksPassed) const
 {
@@ -2873,7 +2985,8 @@ void FieldLines::removeRiskyCorners(list<VisualCorner> &corners) {
                      << " pixels from the edge of the "
                      << "screen; likely a T that is cut off." << endl;
             }
-            corners.erase(riskyCorners, corners.end());
+            spareCorners.splice(spareCorners.end(), corners,
+                                riskyCorners, corners.end());
         }
 
         // Do it again for T corners which may be CC intersections
@@ -2895,7 +3008,8 @@ void FieldLines::removeRiskyCorners(list<VisualCorner> &corners) {
                      << " pixels from the edge of the "
                      << "screen; likely a CC that is cut off." << endl;
             }
-            corners.erase(riskyTCorners, corners.end());
+            spareCorners.splice(spareCorners.end(), corners,
+                                riskyTCorners, corners.end());
         }
     }
 
@@ -2978,12 +3092,11 @@ void FieldLines::identifyCorners(list <VisualCorner> &corners) {
                 printPossibilities(possibleClassifications);
             }
 
-            VisualCorner copy = *i;
-            copy.setPossibleCorners(possibleClassifications);
-            // This has the effect of incrementing our iterator and deleting the
-            // corner from our list.
-            i = corners.erase(i);
-            corners.push_front(copy);
+            i->setPossibleCorners(possibleClassifications);
+            // This has the effect of incrementing our iterator and moving the
+            // corner to the front of our list.
+            list <VisualCorner>::iterator unique = i++;
+            corners.splice(corners.begin(), corners, unique);
         }
         // More than 1 possibility for the corner
         else {
@@ -2996,7 +3109,7 @@ void FieldLines::identifyCorners(list <VisualCorner> &corners) {
 						if (debugIdentifyCorners) {
 							cout << "Two Ts found - for now we throw them both out" << endl;
 						}
-						corners.clear();
+						spareCorners.splice(spareCorners.end(), corners);
 						return;
 					}
 				}
@@ -3564,7 +3677,7 @@ void FieldLines::drawBox(BoundingBox box, int color) const {
 }
 
 // Draws a small box around the line in the given color
-void FieldLines::drawSurroundingBox(shared_ptr<VisualLine> line, int color) const {
+void FieldLines::drawSurroundingBox(const shared_ptr<VisualLine> &line, int color) const {
     drawBox(Utility::getBoundingBox(*line,
                                     DEBUG_GROUP_LINES_BOX_WIDTH,
                                     DEBUG_GROUP_LINES_BOX_WIDTH),
@@ -3625,6 +3738,95 @@ void FieldLines::printThresholdedImage() {
     fflush(stream);
     fclose(stream);
 }
+
+// compareLineTracking() modes
+static const int TRACKED = 0;
+static const int UNTRACKED = 1;
+// corners this close on the ground (cm) are taken to be the same corner
+static const float CORNER_MATCH_CM = 15.0f;
+
+// The closest of points to p, and how far away it is
+static float closestCorner(const vector<point<float> > &points,
+                           const point<float> &p)
+{
+    float closest = numeric_limits<float>::max();
+    for (vector<point<float> >::const_iterator i = points.begin();
+         i != points.end(); ++i) {
+        const float dx = i->x - p.x, dy = i->y - p.y;
+        const float d = sqrt(dx * dx + dy * dy);
+        if (d < closest) {
+            closest = d;
+        }
+    }
+    return closest;
+}
+
+/* Runs lineLoop() on the current image twice, first with line tracking as it
+ * stands and then grouping all the points, and keeps count of how long each
+ * took and how steady their corners are from one frame to the next.  The
+ * untracked results are the ones left in place.  Meant to be run over logged
+ * frames, in order, with tracking on; printLineTrackingStats() reports the
+ * totals.
+ */
+void FieldLines::compareLineTracking() {
+    long long start = micro_time();
+    lineLoop();
+    recordTrackingFrame(TRACKED, micro_time() - start);
+
+    // all the points, without disturbing what the tracker remembers
+    const LineTracker tracked = tracker;
+    tracker.setEnabled(false);
+    start = micro_time();
+    lineLoop();
+    recordTrackingFrame(UNTRACKED, micro_time() - start);
+    tracker = tracked;
+
+    for (vector<point<float> >::const_iterator
+             i = lastCorners[TRACKED].begin();
+         i != lastCorners[TRACKED].end(); ++i) {
+        if (closestCorner(lastCorners[UNTRACKED], *i) <= CORNER_MATCH_CM) {
+            matchingCorners++;
+        }
+    }
+    trackingFrames++;
+}
+
+/* Count the corners of this frame that were also there last frame, and how
+ * far they moved, then remember them for next frame.
+ */
+void FieldLines::recordTrackingFrame(int mode, long long time) {
+    vector<point<float> > corners;
+    for (list<VisualCorner>::const_iterator i = cornersList.begin();
+         i != cornersList.end(); ++i) {
+        const point<float> p(i->getDistance() * cos(i->getBearing()),
+                             i->getDistance() * sin(i->getBearing()));
+        const float moved = closestCorner(lastCorners[mode], p);
+        if (moved <= CORNER_MATCH_CM) {
+            keptCorners[mode]++;
+            cornerMovement[mode] += moved;
+        }
+        corners.push_back(p);
+    }
+    trackingTime[mode] += time;
+    trackingCorners[mode] += static_cast<int>(corners.size());
+    lastCorners[mode].swap(corners);
+}
+
+void FieldLines::printLineTrackingStats() {
+    static const char *names[TRACKING_MODES] = { "tracked", "untracked" };
+    if (trackingFrames == 0) {
+        return;
+    }
+    print("line tracking: %d frames, %d tracked corners match untracked ones",
+          trackingFrames, matchingCorners);
+    for (int i = 0; i < TRACKING_MODES; i++) {
+        print("  %-9s %.0f us/frame, %d corners, %d kept from last frame, "
+              "moved %.1f cm on average", names[i],
+              static_cast<float>(trackingTime[i]) / trackingFrames,
+              trackingCorners[i], keptCorners[i],
+              keptCorners[i] > 0 ? cornerMovement[i] / keptCorners[i] : 0.0f);
+    }
+}
 #endif
 
 
@@ -3768,7 +3970,7 @@ float FieldLines::getEstimatedAngle(const VisualCorner &corner) const {
 
 
 // Estimates how long the line is on the field
-float FieldLines::getEstimatedLength(shared_ptr<VisualLine> line) const {
+float FieldLines::getEstimatedLength(const shared_ptr<VisualLine> &line) const {
     return getEstimatedDistance(line->start, line->end);
 }
 
@@ -3877,8 +4079,8 @@ const bool FieldLines::intersectsFieldLines(const point<int>& first,
 
 const bool
 FieldLines::isTActuallyCC(const VisualCorner& c,
-						  shared_ptr<VisualLine> i,
-						  shared_ptr<VisualLine> j,
+						  const shared_ptr<VisualLine> &i,
+						  const shared_ptr<VisualLine> &j,
 						  const point<int>& intersection,
 						  const point<int>& line1Closer,
 						  const point<int>& line2Closer)
@@ -3971,20 +4173,24 @@ void FieldLines::removeDupeCorners(std::list<VisualCorner> &corners,
 	const int x = intersection.x;
 	const int y = intersection.y;
 
+    // Duplicates are kept in spareCorners to be used again
     for (list<VisualCorner>::iterator i = corners.begin();
-         i != corners.end(); ++i) {
+         i != corners.end(); ) {
         if (abs(x - i->getX()) < DUPE_MIN_X_SEPARATION &&
             abs(y - i->getY()) < DUPE_MIN_Y_SEPARATION) {
-			i = corners.erase(i);
+            list<VisualCorner>::iterator dupe = i++;
+            spareCorners.splice(spareCorners.end(), corners, dupe);
+        } else {
+            ++i;
         }
     }
 }
 
-const bool FieldLines::dupeFakeCorner(const list<point<int> > &corners,
+const bool FieldLines::dupeFakeCorner(const vector<point<int> > &corners,
 									  const int x, const int y,
 									  const int testNumber) const {
 	unsigned int counter = 1;
-	for (list<point<int> >::const_iterator i = corners.begin();
+	for (vector<point<int> >::const_iterator i = corners.begin();
 		 i != corners.end(); ++i, counter++) {
         if (abs(x - i->x) < DUPE_MIN_X_SEPARATION &&
             abs(y - i->y) < DUPE_MIN_Y_SEPARATION && counter != corners.size()) {
@@ -4027,6 +4233,11 @@ const float FieldLines::percentSurrounding(const int x, const int y,
     int endY = min(IMAGE_HEIGHT - 1, y + numPixels);
 
     int numFound = 0;
+#ifdef USE_INTEGRAL_IMAGE
+    numFound = vision->thresh->integrals.countColors(colors, numColors,
+                                                     startX, startY,
+                                                     endX, endY);
+#else
     for (int i = startX; i <= endX; ++i) {
         for (int j = startY; j <= endY; ++j) {
             // Search for the color at that pixel within the vector of
@@ -4039,6 +4250,7 @@ const float FieldLines::percentSurrounding(const int x, const int y,
             }
         }
     }
+#endif
     int totalPixels = (endX - startX + 1) * (endY - startY + 1);
     return (static_cast<float> (numFound) /
             static_cast<float> (totalPixels)) * 100.0f;
@@ -4095,15 +4307,31 @@ const float FieldLines::percentColorBetween(const int x1, const int y1,
 
     // Vertical line
     if (x2 == x1) {
+#if defined USE_INTEGRAL_IMAGE
+        // y1 up to but not including y2, counted as a box one pixel wide
+        const int first = (y2 < y1) ? y2 + 1 : y1;
+        const int last = (y2 < y1) ? y1 : y2 - 1;
+        totalPixels = abs(y2 - y1);
+        numFound = vision->thresh->integrals.countColors(colors, numColors,
+                                                         x2, first, x2, last);
+#elif defined USE_RUN_LENGTH_IMAGE
+        // y1 up to but not including y2, counted a run at a time
+        const int first = (y2 < y1) ? y2 + 1 : y1;
+        const int last = (y2 < y1) ? y1 : y2 - 1;
+        totalPixels = abs(y2 - y1);
+        numFound = vision->thresh->runLengths.countColors(x2, first, last,
+                                                          colors, numColors);
+#else
         int sign = 1;
         if (y2 < y1)
             sign = -1;
         for (int j = y1; j != y2; j += sign, ++totalPixels) {
-            if (Utility::isElementInArray(vision->thresh->thresholded[j][x2],
+            if (Utility::isElementInArray(vision->thresh->getColumnColor(x2, j),
                                           colors, numColors)) {
                 ++numFound;
             }
         }
+#endif
     }
     else {
 
@@ -4143,6 +4371,13 @@ const float FieldLines::percentColorBetween(const int x1, const int y1,
         else {
             int startX = min(x1,x2);
             int endX = max(x1,x2);
+#ifdef USE_INTEGRAL_IMAGE
+            totalPixels = endX - startX + 1;
+            numFound = vision->thresh->integrals.countColors(colors,
+                                                             numColors,
+                                                             startX, y2,
+                                                             endX, y2);
+#else
             for (int i = startX; i <= endX; ++i) {
                 ++totalPixels;
                 if (Utility::isElementInArray(vision->thresh->
@@ -4150,6 +4385,7 @@ const float FieldLines::percentColorBetween(const int x1, const int y1,
                                               colors, numColors))
                     ++numFound;
             }
+#endif
         }
     }
 
@@ -4172,17 +4408,35 @@ const float FieldLines::percentColor(const int x, const int y,
         if (dir == TEST_UP) sign = -1;
         // test down, sign goes positive
         else if (dir == TEST_DOWN) sign = 1;
+#if defined USE_INTEGRAL_IMAGE
+        // the same pixels as below, counted as a box one pixel wide
+        const int first = (sign < 0) ? max(0, y - numPixels) : y + 1;
+        const int last = (sign < 0) ? y - 1 :
+            min(IMAGE_HEIGHT - 1, y + numPixels);
+        numTotal = max(0, last - first + 1);
+        numFound = vision->thresh->integrals.countColors(colors, numColors,
+                                                         x, first, x, last);
+#elif defined USE_RUN_LENGTH_IMAGE
+        // the same pixels as below, counted a run at a time
+        const int first = (sign < 0) ? max(0, y - numPixels) : y + 1;
+        const int last = (sign < 0) ? y - 1 :
+            min(IMAGE_HEIGHT - 1, y + numPixels);
+        numTotal = max(0, last - first + 1);
+        numFound = vision->thresh->runLengths.countColors(x, first, last,
+                                                          colors, numColors);
+#else
         // loop through starting at y, keeping x constant, stopping whether
         // we've exhausted num or we've gone off screen
         for (int i = y + sign; numTotal < numPixels &&
                  i < IMAGE_HEIGHT && i >= 0; i += sign, ++numTotal) {
             for (int j = 0; j < numColors; ++j) {
-                if (colors[j] == vision->thresh->thresholded[i][x]) {
+                if (colors[j] == vision->thresh->getColumnColor(x, i)) {
                     ++numFound;
                     break;
                 }
             }
         }
+#endif
     }
     // test left/right directions
     else if (dir == TEST_LEFT || dir == TEST_RIGHT) {
@@ -4190,6 +4444,15 @@ const float FieldLines::percentColor(const int x, const int y,
         if (dir == TEST_LEFT) sign = -1;
         // test down, sign goes positive
         if (dir == TEST_RIGHT) sign = 1;
+#ifdef USE_INTEGRAL_IMAGE
+        // the same pixels as below, counted as a box one pixel high
+        const int first = (sign < 0) ? max(0, x - numPixels) : x + 1;
+        const int last = (sign < 0) ? x - 1 :
+            min(IMAGE_WIDTH - 1, x + numPixels);
+        numTotal = max(0, last - first + 1);
+        numFound = vision->thresh->integrals.countColors(colors, numColors,
+                                                         first, y, last, y);
+#else
         for (int i = x + sign; numTotal < numPixels &&
                  i < IMAGE_WIDTH && i >= 0; i += sign, ++numTotal) {
             for (int j = 0; j < numColors; ++j) {
@@ -4199,6 +4462,7 @@ const float FieldLines::percentColor(const int x, const int y,
                 }
             }
         }
+#endif
     }
     return (static_cast<float>(numFound) /
 			static_cast<float>(numTotal) * 100.0f);
@@ -4220,7 +4484,7 @@ const float FieldLines::percentColor(const int x, const int y,
 // Draws a line through the start and endpoint of the line, which were created
 // from the least squares approximation of the line rather than actual points
 // on the line.
-void FieldLines::drawFieldLine(shared_ptr<VisualLine> toDraw, const int color) const{
+void FieldLines::drawFieldLine(const shared_ptr<VisualLine> &toDraw, const int color) const{
     vision->thresh->drawLine(toDraw->start.x, toDraw->start.y,
                              toDraw->end.x, toDraw->end.y, color);
 }
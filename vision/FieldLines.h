@@ -32,6 +32,8 @@ struct linePoint;
 #include "Utility.h" //
 #include "NaoPose.h" // Used to estimate distances in the image
 #include "Vision.h"
+#include "FrameArena.h"
+#include "LineTracker.h"
 
 static const int NO_EDGE = -3;
 
@@ -53,8 +55,10 @@ static const int JOIN_LINES_BOX_COLOR = PINK;
 
 static const Rectangle SCREEN = {0, IMAGE_WIDTH - 1,
                                  0, IMAGE_HEIGHT - 1};
+// The line points of a frame, kept in the FieldLines frame arena
+typedef std::list<linePoint, ArenaAllocator<linePoint> > LinePointList;
 // More succinct.
-typedef std::list<linePoint>::iterator linePointNode;
+typedef LinePointList::iterator linePointNode;
 
 class FieldLines {
 private:
@@ -119,6 +123,9 @@ private:
 
     static const int MAX_ANGLE_LINE_SEGMENT = 4;
 
+    // Most lines we keep to reuse from frame to frame
+    static const unsigned int MAX_POOLED_LINES = 40;
+
     static const int MAX_GREEN_PERCENT_ALLOWED_IN_LINE = 10;
 
     // max number of pixels offset to connect two points in createLines
@@ -201,6 +208,10 @@ public:
     // master loop
     void lineLoop();
 
+    // group the points along last frame's lines first, see LineTracker.h
+    void setLineTracking(bool on) { tracker.setEnabled(on); }
+    LineTracker& getLineTracker() { return tracker; }
+
     // While lineLoop is called before object recognition so that
     // ObjectFragments can make use of VisualLines and VisualCorners,
     // the methods called from here use FieldObjects and as such must be
@@ -235,14 +246,14 @@ public:
 
     // Attempts to create lines out of a list of linePoints.  In order for
     // points to be fit onto a line, they must pass a battery of sanity checks
-    void createLines(std::list<linePoint> &linePoints);
+    void createLines(LinePointList &linePoints);
 
-    void setLineCoordinates(boost::shared_ptr<VisualLine> aLine);
+    void setLineCoordinates(const boost::shared_ptr<VisualLine> &aLine);
 
     // Attempts to fit the left over points that were not used within the
     // createLines function to the lines that were output from said function
     void fitUnusedPoints(std::vector< boost::shared_ptr<VisualLine> > &lines,
-                         std::list<linePoint> &remainingPoints);
+                         LinePointList &remainingPoints);
 
     // Attempts to join together line segments that are logically part of one
     // longer line but for some reason were not grouped within the groupPoints
@@ -300,24 +311,24 @@ public:
     // is a legitimate corner on the field.
     // @param lines - the vector of visual lines that have been found after
     // createLines, join lines, and fit unused points.
-    // @return a vector of VisualCorners created from the intersection points
-    // that successfully pass all sanity checks.
+    // @param corners - filled with the VisualCorners created from the
+    // intersection points that successfully pass all sanity checks.
     //
-    std::list<VisualCorner> intersectLines();
+    void intersectLines(std::list<VisualCorner> &corners);
 
 
 	/**
 	 * Sanity checks for field lines:
 	 */
-	const bool isAngleTooSmall(boost::shared_ptr<VisualLine> i,
-						 boost::shared_ptr<VisualLine> j,
+	const bool isAngleTooSmall(const boost::shared_ptr<VisualLine> &i,
+						 const boost::shared_ptr<VisualLine> &j,
 						 const int& numChecksPassed) const;
 
 	const bool isIntersectionOnScreen(const point<int>& intersection,
 								const int& numChecksPassed) const;
 
-	const bool isAngleOnFieldOkay(boost::shared_ptr<VisualLine> i,
-							boost::shared_ptr<VisualLine> j,
+	const bool isAngleOnFieldOkay(const boost::shared_ptr<VisualLine> &i,
+							const boost::shared_ptr<VisualLine> &j,
 							const int& intersectX,
 							const int& intersectY,
 							const int& numChecksPassed) const;
@@ -325,20 +336,20 @@ public:
 	const bool tooMuchGreenAtCorner(const point<int>& intersection,
 							  const int& numChecksPassed);
 
-	const bool areLinesTooSmall(boost::shared_ptr<VisualLine> i,
-						  boost::shared_ptr<VisualLine> j,
+	const bool areLinesTooSmall(const boost::shared_ptr<VisualLine> &i,
+						  const boost::shared_ptr<VisualLine> &j,
 						  const int& numChecksPassed) const;
 
-	const bool doLinesCross(boost::shared_ptr<VisualLine> i,
-					  boost::shared_ptr<VisualLine> j,
+	const bool doLinesCross(const boost::shared_ptr<VisualLine> &i,
+					  const boost::shared_ptr<VisualLine> &j,
 					  const float& t_I, const float& t_J,
 					  const int& numChecksPassed)const ;
 
 	const bool isCornerTooFar(const float& distance,
 						const int& numChecksPassed) const;
 
-	const bool areLineEndsCloseEnough(boost::shared_ptr<VisualLine> i,
-								boost::shared_ptr<VisualLine> j,
+	const bool areLineEndsCloseEnough(const boost::shared_ptr<VisualLine> &i,
+								const boost::shared_ptr<VisualLine> &j,
 								const point<int>& intersection,
 								const int& numChecksPassed) const;
 
@@ -348,8 +359,8 @@ public:
 									  const int& numChecksPassed) const;
 
 	const bool isTActuallyCC(const VisualCorner& c,
-							 boost::shared_ptr<VisualLine> i,
-							 boost::shared_ptr<VisualLine> j,
+							 const boost::shared_ptr<VisualLine> &i,
+							 const boost::shared_ptr<VisualLine> &j,
 							 const point<int>& intersection,
 							 const point<int>& line1Closer,
 							 const point<int>& line2Closer);
@@ -407,7 +418,7 @@ public:
                           const VisualFieldObject *obj) const;
 
     // Estimates how long the line is on the field
-    float getEstimatedLength(boost::shared_ptr<VisualLine> line) const;
+    float getEstimatedLength(const boost::shared_ptr<VisualLine> &line) const;
 
     // Given two points on the screen, estimates the straight line distance
     // between them, on the field
@@ -460,7 +471,7 @@ public:
 										const int testNumber) const;
 	void removeDupeCorners(std::list<VisualCorner> &corners,
 						   const point<int>& intersection);
-	const bool dupeFakeCorner(const std::list<point <int> > &corners,
+	const bool dupeFakeCorner(const std::vector<point <int> > &corners,
 							  const int x, const int y, const int testNumber) const;
     const float percentColor(const int x, const int y, const TestDirection dir,
                              const int color, const int numPixels) const;
@@ -487,7 +498,7 @@ public:
 
 
     void drawBox(BoundingBox box, int color) const;
-    void drawSurroundingBox(boost::shared_ptr<VisualLine> aLine, int color) const;
+    void drawSurroundingBox(const boost::shared_ptr<VisualLine> &aLine, int color) const;
 
     const bool isGreenWhiteEdge(int x, int y, ScanDirection direction) const;
     const bool isWhiteGreenEdge(int x, int y, int potentialMidPoint,
@@ -510,11 +521,11 @@ public:
                                  const int numNonWhite, const bool print) const;
 #endif
 
-    void drawFieldLine(boost::shared_ptr<VisualLine> _line, const int color) const;
+    void drawFieldLine(const boost::shared_ptr<VisualLine> &_line, const int color) const;
 
     void drawLinePoint(const linePoint &p, const int color) const;
-    void drawLinePoints(const std::list<linePointNode> &toDraw) const;
-    void drawLinePoints(const std::list<linePoint> &toDraw) const;
+    void drawLinePoints(const std::vector<linePointNode> &toDraw) const;
+    void drawLinePoints(const LinePointList &toDraw) const;
     void drawCorners(const std::list<VisualCorner> &toDraw, int color);
 
     bool isLegitVerticalLinePoint(int x, int y);
@@ -561,8 +572,14 @@ public:
 
     const std::vector < boost::shared_ptr<VisualLine> >* getLines() const { return &linesList; }
     const std::list <VisualCorner>* getCorners() const {return &cornersList; }
+    // the lines and corners of another FieldLines' last frame, see
+    // Vision::copyResults()
+    void copyResults(const FieldLines &other) {
+        linesList = other.linesList;
+        cornersList = other.cornersList;
+    }
     const int getNumCorners() { return cornersList.size(); }
-    const std::list<linePoint>* getUnusedPoints() const {
+    const LinePointList* getUnusedPoints() const {
         return &unusedPointsList;
     }
 
@@ -574,6 +591,8 @@ public:
 
 #ifdef OFFLINE
     void printThresholdedImage();
+    void compareLineTracking();
+    void printLineTrackingStats();
 #endif
 
     /* ----------------  Section for verbose helper methods ----------------
@@ -689,7 +708,42 @@ private:
 
     std::vector <boost::shared_ptr<VisualLine> > linesList;
     std::list <VisualCorner> cornersList;
-    std::list <linePoint> unusedPointsList;
+    // Holds the line points of the frame, so must outlive unusedPointsList
+    FrameArena lineArena;
+    LinePointList unusedPointsList;
+
+    // Everything else the line loop needs from frame to frame is kept too,
+    // so that once it has seen a busy frame it does not use the heap
+    std::vector<linePoint> vertLinePoints, horLinePoints;
+    std::vector<linePointNode> legitimateLinePoints;
+    std::vector<linePoint> additionalPoints;
+    std::vector<point<int> > dupeCorners;
+    // Lines we have made, reused once no one else holds them
+    std::vector <boost::shared_ptr<VisualLine> > linePool;
+    // Corners that are not in cornersList, to be filled in again
+    std::list <VisualCorner> spareCorners;
+
+    boost::shared_ptr<VisualLine> takePooledLine();
+
+    LineTracker tracker;
+    // the points along one predicted line, while they are grouped
+    LinePointList trackedPoints;
+
+    void groupTrackedPoints(LinePointList &linePoints);
+    void trackLines();
+
+#ifdef OFFLINE
+    // totals for compareLineTracking(), tracked and untracked
+    static const int TRACKING_MODES = 2;
+    void recordTrackingFrame(int mode, long long time);
+    int trackingFrames;
+    long long trackingTime[TRACKING_MODES];
+    int trackingCorners[TRACKING_MODES], keptCorners[TRACKING_MODES],
+        matchingCorners;
+    float cornerMovement[TRACKING_MODES];
+    // where each mode's corners were on the ground, last frame
+    std::vector<point<float> > lastCorners[TRACKING_MODES];
+#endif
 
 private:
 
@@ -0,0 +1,63 @@
+// This file is part of Man, a robotic perception, locomotion, and
+// team strategy application created by the Northern Bites RoboCup
+// team of Bowdoin College in Brunswick, Maine, for the Aldebaran
+// Nao robot.
+//
+// Man is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Man is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// and the GNU Lesser Public License along with Man.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#include "FrameArena.h"
+
+// every allocation is aligned for anything we keep in a container
+static const std::size_t ARENA_ALIGNMENT = 2 * sizeof(void*);
+
+FrameArena::FrameArena(std::size_t _blockSize)
+    : blockSize(_blockSize), blocks(), current(0), used(0)
+{
+}
+
+FrameArena::~FrameArena()
+{
+    for (std::size_t i = 0; i < blocks.size(); i++) {
+        delete [] blocks[i].data;
+    }
+}
+
+void* FrameArena::allocate(std::size_t bytes)
+{
+    bytes = (bytes + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+
+    // Move on through the blocks we already have until one has room
+    while (current < blocks.size() && used + bytes > blocks[current].size) {
+        current++;
+        used = 0;
+    }
+    if (current == blocks.size()) {
+        Block block;
+        block.size = bytes > blockSize ? bytes : blockSize;
+        block.data = new char[block.size];
+        blocks.push_back(block);
+        used = 0;
+    }
+
+    void *memory = blocks[current].data + used;
+    used += bytes;
+    return memory;
+}
+
+void FrameArena::reset()
+{
+    current = 0;
+    used = 0;
+}
@@ -0,0 +1,126 @@
+// This file is part of Man, a robotic perception, locomotion, and
+// team strategy application created by the Northern Bites RoboCup
+// team of Bowdoin College in Brunswick, Maine, for the Aldebaran
+// Nao robot.
+//
+// Man is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Man is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// and the GNU Lesser Public License along with Man.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/**
+ * Memory for containers that only live for one frame.
+ *
+ * A FrameArena hands out memory by bumping a pointer through blocks it keeps
+ * from frame to frame, and takes it all back at once with reset().  Freeing
+ * single allocations does nothing.  Blocks are only added while the arena is
+ * still growing to the size a frame needs, so once it has seen a busy frame
+ * it never goes to the heap again.
+ *
+ * ArenaAllocator lets the STL containers use one, e.g.
+ *     std::list<linePoint, ArenaAllocator<linePoint> >
+ *         points(ArenaAllocator<linePoint>(&arena));
+ * Everything the container holds must be gone (cleared or destroyed) before
+ * the arena is reset.
+ */
+
+#ifndef FrameArena_h_DEFINED
+#define FrameArena_h_DEFINED
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+// the size of each block the arena gets from the heap
+static const std::size_t FRAME_ARENA_BLOCK_SIZE = 16 * 1024;
+
+class FrameArena
+{
+public:
+    FrameArena(std::size_t blockSize = FRAME_ARENA_BLOCK_SIZE);
+    virtual ~FrameArena();
+
+    void* allocate(std::size_t bytes);
+    // Everything allocated since the last reset is given back
+    void reset();
+
+private:
+    // not copyable, the blocks belong to us
+    FrameArena(const FrameArena&);
+    FrameArena& operator=(const FrameArena&);
+
+    struct Block {
+        char *data;
+        std::size_t size;
+    };
+
+    std::size_t blockSize;
+    std::vector<Block> blocks;
+    // the block we are allocating from, and how much of it is used
+    std::size_t current;
+    std::size_t used;
+};
+
+template <class T>
+class ArenaAllocator
+{
+public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef std::size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+
+    template <class U> struct rebind { typedef ArenaAllocator<U> other; };
+
+    // With no arena we fall back on the heap
+    ArenaAllocator(FrameArena *_arena = 0) : arena(_arena) {}
+    template <class U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+    pointer address(reference x) const { return &x; }
+    const_pointer address(const_reference x) const { return &x; }
+
+    pointer allocate(size_type n, const void* = 0) {
+        if (arena == 0) {
+            return static_cast<pointer>(::operator new(n * sizeof(T)));
+        }
+        return static_cast<pointer>(arena->allocate(n * sizeof(T)));
+    }
+    void deallocate(pointer p, size_type) {
+        if (arena == 0) {
+            ::operator delete(p);
+        }
+    }
+
+    size_type max_size() const { return static_cast<size_type>(-1) / sizeof(T); }
+    void construct(pointer p, const T& value) { new (p) T(value); }
+    void destroy(pointer p) { p->~T(); }
+
+    FrameArena *arena;
+};
+
+template <class T, class U>
+inline bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b)
+{
+    return a.arena == b.arena;
+}
+
+template <class T, class U>
+inline bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b)
+{
+    return a.arena != b.arena;
+}
+
+#endif // FrameArena_h_DEFINED
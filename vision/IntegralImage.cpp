@@ -0,0 +1,103 @@
+// This file is part of Man, a robotic perception, locomotion, and
+// team strategy application created by the Northern Bites RoboCup
+// team of Bowdoin College in Brunswick, Maine, for the Aldebaran
+// Nao robot.
+//
+// Man is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Man is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// and the GNU Lesser Public License along with Man.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+
+#include "IntegralImage.h"
+
+// a table row, with the extra column of zeros on the left
+static const int TABLE_WIDTH = IMAGE_WIDTH + 1;
+
+IntegralImage::IntegralImage(const unsigned char *_image)
+    : image(_image), frame(0), tablesBuilt(0)
+{
+    for (int c = 0; c < INTEGRAL_COLORS; c++) {
+        tables[c] = 0;
+        builtIn[c] = -1;
+    }
+}
+
+IntegralImage::~IntegralImage()
+{
+    for (int c = 0; c < INTEGRAL_COLORS; c++) {
+        delete [] tables[c];
+    }
+}
+
+/* The table for a color, built now if it has not been this frame.  Each row
+ * adds the running count along the row to the row above.
+ * @param color    the color, 0 <= color < INTEGRAL_COLORS
+ */
+const int* IntegralImage::table(int color)
+{
+    int *sums = tables[color];
+    if (builtIn[color] == frame) {
+        return sums;
+    }
+    if (sums == 0) {
+        sums = tables[color] = new int[(IMAGE_HEIGHT + 1) * TABLE_WIDTH];
+        for (int x = 0; x < TABLE_WIDTH; x++) {
+            sums[x] = 0;
+        }
+    }
+
+    const unsigned char *pixels = image;
+    for (int y = 0; y < IMAGE_HEIGHT; y++) {
+        const int *above = sums + y * TABLE_WIDTH;
+        int *row = sums + (y + 1) * TABLE_WIDTH;
+        int along = 0;
+        row[0] = 0;
+        for (int x = 0; x < IMAGE_WIDTH; x++) {
+            along += pixels[x] == color;
+            row[x + 1] = above[x + 1] + along;
+        }
+        pixels += IMAGE_WIDTH;
+    }
+    builtIn[color] = frame;
+    tablesBuilt++;
+    return sums;
+}
+
+int IntegralImage::count(int color, int left, int top, int right, int bottom)
+{
+    if (right < left || bottom < top || color < 0 ||
+        color >= INTEGRAL_COLORS) {
+        return 0;
+    }
+    const int *sums = table(color);
+    const int *above = sums + top * TABLE_WIDTH;
+    const int *below = sums + (bottom + 1) * TABLE_WIDTH;
+    return below[right + 1] - below[left] - above[right + 1] + above[left];
+}
+
+int IntegralImage::countColors(const int colors[], int numColors,
+                               int left, int top, int right, int bottom)
+{
+    int found = 0;
+    for (int i = 0; i < numColors; i++) {
+        // a pixel only counts once, however often its color is listed
+        bool listed = false;
+        for (int j = 0; j < i && !listed; j++) {
+            listed = colors[j] == colors[i];
+        }
+        if (!listed) {
+            found += count(colors[i], left, top, right, bottom);
+        }
+    }
+    return found;
+}
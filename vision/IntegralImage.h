@@ -0,0 +1,81 @@
+// This file is part of Man, a robotic perception, locomotion, and
+// team strategy application created by the Northern Bites RoboCup
+// team of Bowdoin College in Brunswick, Maine, for the Aldebaran
+// Nao robot.
+//
+// Man is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Man is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// and the GNU Lesser Public License along with Man.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+
+/**
+ * Summed-area tables of the thresholded image, one per color.
+ *
+ * The table for a color holds, for every (x, y), how many pixels above and
+ * to the left of it have that color, so the pixels of the color in any box
+ * come from four lookups however big the box is.  That is what the percent
+ * color checks (FieldLines::percentColor and friends, and the blob color
+ * checks of Ball, Cross and ObjectFragments) want to know.
+ *
+ * A table is only built the first time its color is asked about in a frame,
+ * which costs one pass over the image, so the colors nobody asks about cost
+ * nothing.  Threshold owns one of these when built with USE_INTEGRAL_IMAGE
+ * and calls newFrame() every time it thresholds.
+ */
+
+#ifndef IntegralImage_h_DEFINED
+#define IntegralImage_h_DEFINED
+
+#include "VisionDef.h"
+
+// thresholded pixels are bytes, so this many colors can be asked for
+static const int INTEGRAL_COLORS = 256;
+
+class IntegralImage
+{
+public:
+    // image is the row-major thresholded image the tables are built from
+    IntegralImage(const unsigned char *image);
+    virtual ~IntegralImage();
+
+    // The image has changed, every table is out of date
+    void newFrame() { frame++; }
+
+    // How many pixels of the box from (left, top) to (right, bottom),
+    // inclusive and on the image, have the color
+    int count(int color, int left, int top, int right, int bottom);
+    // The same for pixels that have any of the colors
+    int countColors(const int colors[], int numColors,
+                    int left, int top, int right, int bottom);
+
+    // Tables built since we were made, for measuring what they cost
+    int getTablesBuilt() const { return tablesBuilt; }
+
+private:
+    // not copyable, the tables belong to us
+    IntegralImage(const IntegralImage&);
+    IntegralImage& operator=(const IntegralImage&);
+
+    const int* table(int color);
+
+    const unsigned char *image;
+    // (IMAGE_HEIGHT + 1) x (IMAGE_WIDTH + 1) counts per color, row 0 and
+    // column 0 all zero; allocated the first time a color is asked for
+    int *tables[INTEGRAL_COLORS];
+    // the frame each table was last built in
+    int builtIn[INTEGRAL_COLORS];
+    int frame;
+    int tablesBuilt;
+};
+
+#endif // IntegralImage_h_DEFINED
@@ -0,0 +1,125 @@
+// This file is part of Man, a robotic perception, locomotion, and
+// team strategy application created by the Northern Bites RoboCup
+// team of Bowdoin College in Brunswick, Maine, for the Aldebaran
+// Nao robot.
+//
+// Man is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Man is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// and the GNU Lesser Public License along with Man.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <cmath>
+
+#include "LineTracker.h"
+
+LineTracker::LineTracker()
+    : enabled(false), fullFrame(true),
+      fullFrameInterval(LINE_TRACK_FULL_FRAME_INTERVAL), framesSinceFull(0),
+      numLines(0), numPredicted(0)
+{
+}
+
+// Turning tracking on or off always starts over with a full frame
+void LineTracker::setEnabled(bool on)
+{
+    enabled = on;
+    framesSinceFull = fullFrameInterval;
+    clearLines();
+    numPredicted = 0;
+}
+
+void LineTracker::startFrame(const NaoPose &pose)
+{
+    numPredicted = 0;
+    fullFrame = !enabled || numLines == 0 ||
+        framesSinceFull + 1 >= fullFrameInterval;
+    if (fullFrame) {
+        framesSinceFull = 0;
+        return;
+    }
+    framesSinceFull++;
+
+    for (int i = 0; i < numLines; i++) {
+        point<float> start, end;
+        if (!pose.worldPointToPixel(lines[i].startX, lines[i].startY, 0.0f,
+                                    start) ||
+            !pose.worldPointToPixel(lines[i].endX, lines[i].endY, 0.0f,
+                                    end)) {
+            continue;
+        }
+        float dx = end.x - start.x, dy = end.y - start.y;
+        const float length = sqrtf(dx * dx + dy * dy);
+        if (length < 1.0f) {
+            continue;
+        }
+        const float stretch = LINE_TRACK_EXTEND / length;
+        ImageLine &p = predicted[numPredicted++];
+        p.x = start.x - dx * stretch;
+        p.y = start.y - dy * stretch;
+        dx += 2.0f * dx * stretch;
+        dy += 2.0f * dy * stretch;
+        p.dx = dx;
+        p.dy = dy;
+        p.lengthSquared = dx * dx + dy * dy;
+        // a box around the band, to turn most points away quickly
+        p.left = std::min(p.x, p.x + dx) - LINE_TRACK_BAND;
+        p.right = std::max(p.x, p.x + dx) + LINE_TRACK_BAND;
+        p.top = std::min(p.y, p.y + dy) - LINE_TRACK_BAND;
+        p.bottom = std::max(p.y, p.y + dy) + LINE_TRACK_BAND;
+    }
+}
+
+bool LineTracker::isNearPrediction(int i, int x, int y) const
+{
+    const ImageLine &p = predicted[i];
+    if (x < p.left || x > p.right || y < p.top || y > p.bottom) {
+        return false;
+    }
+    // distance to the closest point of the segment
+    const float px = static_cast<float>(x) - p.x;
+    const float py = static_cast<float>(y) - p.y;
+    float t = (px * p.dx + py * p.dy) / p.lengthSquared;
+    if (t < 0.0f) {
+        t = 0.0f;
+    } else if (t > 1.0f) {
+        t = 1.0f;
+    }
+    const float offX = px - t * p.dx, offY = py - t * p.dy;
+    return offX * offX + offY * offY <= LINE_TRACK_BAND * LINE_TRACK_BAND;
+}
+
+void LineTracker::clearLines()
+{
+    numLines = 0;
+}
+
+/* Remember a line seen this frame by where its ends are on the ground.
+ * Lines whose ends are not on the ground (above the horizon) are dropped.
+ */
+void LineTracker::addLine(NaoPose &pose, const point<int> &start,
+                          const point<int> &end)
+{
+    if (numLines == LINE_TRACK_MAX_LINES) {
+        return;
+    }
+    const estimate startEst = pose.pixEstimate(start.x, start.y, 0.0f);
+    const estimate endEst = pose.pixEstimate(end.x, end.y, 0.0f);
+    if (startEst.dist <= 0.0f || endEst.dist <= 0.0f) {
+        return;
+    }
+    GroundLine &l = lines[numLines++];
+    l.startX = startEst.x;
+    l.startY = startEst.y;
+    l.endX = endEst.x;
+    l.endY = endEst.y;
+}
@@ -0,0 +1,101 @@
+// This file is part of Man, a robotic perception, locomotion, and
+// team strategy application created by the Northern Bites RoboCup
+// team of Bowdoin College in Brunswick, Maine, for the Aldebaran
+// Nao robot.
+//
+// Man is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Man is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// and the GNU Lesser Public License along with Man.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/**
+ * Line tracking for FieldLines.
+ *
+ * When enabled, the lines found in one frame are remembered as points on the
+ * ground and projected into the next frame's image with that frame's pose.
+ * FieldLines groups the line points lying along each predicted line on their
+ * own first, which is cheap since there are few of them and they are nearly
+ * all on the line, and then does the usual grouping over whatever points
+ * were not explained by a prediction.
+ *
+ * Vision has no odometry, so the prediction only follows the pose: head
+ * turns and changes of body tilt are taken into account, walking is not.
+ * The band around each predicted line has to be wide enough to cover the
+ * distance a line moves in the image between frames while we walk.
+ *
+ * Every fullFrameInterval frames all the points are grouped as usual, so
+ * lines we did not predict are not missed for long.  It is off by default.
+ */
+
+#ifndef LineTracker_h_DEFINED
+#define LineTracker_h_DEFINED
+
+#include "VisionDef.h"
+#include "NaoPose.h"
+
+// pixels either side of a predicted line that still count as on it
+static const float LINE_TRACK_BAND = 6.0f;
+// pixels a predicted line is stretched past each of its ends
+static const float LINE_TRACK_EXTEND = 20.0f;
+// group all the points from scratch at least this often
+static const int LINE_TRACK_FULL_FRAME_INTERVAL = 10;
+// the most lines carried over from one frame to the next
+static const int LINE_TRACK_MAX_LINES = 16;
+
+class LineTracker
+{
+public:
+    LineTracker();
+    virtual ~LineTracker() {}
+
+    void setEnabled(bool on);
+    bool isEnabled() const { return enabled; }
+    void setFullFrameInterval(int frames) { fullFrameInterval = frames; }
+    int getFullFrameInterval() const { return fullFrameInterval; }
+
+    // Project last frame's lines into this frame's image
+    void startFrame(const NaoPose &pose);
+
+    bool isFullFrame() const { return fullFrame; }
+    int getNumPredicted() const { return numPredicted; }
+    // whether (x, y) is close enough to predicted line i to be grouped with it
+    bool isNearPrediction(int i, int x, int y) const;
+
+    // The lines seen this frame, to be predicted next frame
+    void clearLines();
+    void addLine(NaoPose &pose, const point<int> &start,
+                 const point<int> &end);
+
+private:
+    bool enabled;
+    bool fullFrame;
+    int fullFrameInterval;
+    int framesSinceFull;
+
+    // ends of the lines we saw, on the ground in the world frame (cm)
+    struct GroundLine {
+        float startX, startY, endX, endY;
+    };
+    GroundLine lines[LINE_TRACK_MAX_LINES];
+    int numLines;
+
+    // predicted lines in the image, already stretched, as a start point and
+    // the vector to the end, with its squared length
+    struct ImageLine {
+        float x, y, dx, dy, lengthSquared;
+        float left, right, top, bottom;
+    };
+    ImageLine predicted[LINE_TRACK_MAX_LINES];
+    int numPredicted;
+};
+
+#endif // LineTracker_h_DEFINED
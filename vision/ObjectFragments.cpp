@@ -1733,6 +1733,18 @@ bool ObjectFragments::rightBlobColor(Blob tempobj, float minpercent) {
 	}
     int ny, nx, starty, startx;
     int good = 0, total = 0;
+#ifdef USE_INTEGRAL_IMAGE
+    // when the horizon is level enough that the projections below never
+    // move a pixel, the blob is just a box
+    if (ROUND2(slope * static_cast<float>(max(spanX, spanY) - 1)) == 0) {
+        const int left = max(x, 0), right = min(x + spanX, IMAGE_WIDTH) - 1;
+        const int top = max(y, 0), bottom = min(y + spanY, IMAGE_HEIGHT) - 1;
+        if (right >= left && bottom >= top) {
+            total = (right - left + 1) * (bottom - top + 1);
+            good = thresh->integrals.count(color, left, top, right, bottom);
+        }
+    } else
+#endif
     for (int i = 0; i < spanY; i++) {
         starty = y + i;
         startx = xProject(x, y, starty);
@@ -0,0 +1,143 @@
+// This file is part of Man, a robotic perception, locomotion, and
+// team strategy application created by the Northern Bites RoboCup
+// team of Bowdoin College in Brunswick, Maine, for the Aldebaran
+// Nao robot.
+//
+// Man is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Man is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// and the GNU Lesser Public License along with Man.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#include <unistd.h>
+
+#include "ParallelRuns.h"
+#include "Threshold.h"
+
+// a generous guess at the runs in a column, so buffers don't grow per frame
+static const int RUNS_PER_COLUMN = 8;
+
+ParallelRuns::ParallelRuns(Threshold *_thresh)
+    : thresh(_thresh), numStripes(1), generation(0), pending(0),
+      running(true)
+{
+    const long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cores > 1) {
+        numStripes = cores < MAX_RUN_STRIPES ?
+            static_cast<int>(cores) : MAX_RUN_STRIPES;
+    }
+
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&startCond, NULL);
+    pthread_cond_init(&doneCond, NULL);
+
+    for (int s = 0; s < numStripes; s++) {
+        buffers[s].reserve(IMAGE_WIDTH / numStripes * RUNS_PER_COLUMN);
+    }
+
+    // stripe 0 belongs to the calling thread
+    for (int s = 1; s < numStripes; s++) {
+        workers[s].owner = this;
+        workers[s].stripe = s;
+        if (pthread_create(&workers[s].thread, NULL, runWorker,
+                           &workers[s]) != 0) {
+            // scan what we could start, the calling thread does the rest
+            numStripes = s;
+            break;
+        }
+    }
+}
+
+ParallelRuns::~ParallelRuns()
+{
+    pthread_mutex_lock(&mutex);
+    running = false;
+    pthread_cond_broadcast(&startCond);
+    pthread_mutex_unlock(&mutex);
+
+    for (int s = 1; s < numStripes; s++) {
+        pthread_join(workers[s].thread, NULL);
+    }
+
+    pthread_cond_destroy(&doneCond);
+    pthread_cond_destroy(&startCond);
+    pthread_mutex_destroy(&mutex);
+}
+
+/* Scan every column and hand the runs to the object structures.  The calling
+ * thread blocks until all of the stripes are scanned, then replays them left
+ * to right.
+ */
+void ParallelRuns::scan()
+{
+    if (numStripes == 1) {
+        thresh->runColumns(0, IMAGE_WIDTH, NULL);
+        return;
+    }
+
+    pthread_mutex_lock(&mutex);
+    generation++;
+    pending = numStripes - 1;
+    pthread_cond_broadcast(&startCond);
+    pthread_mutex_unlock(&mutex);
+
+    scanStripe(0);
+
+    pthread_mutex_lock(&mutex);
+    while (pending > 0) {
+        pthread_cond_wait(&doneCond, &mutex);
+    }
+    pthread_mutex_unlock(&mutex);
+
+    for (int s = 0; s < numStripes; s++) {
+        thresh->replayRuns(buffers[s]);
+    }
+}
+
+void ParallelRuns::scanStripe(int stripe)
+{
+    buffers[stripe].clear();
+    thresh->runColumns(IMAGE_WIDTH * stripe / numStripes,
+                       IMAGE_WIDTH * (stripe + 1) / numStripes,
+                       &buffers[stripe]);
+}
+
+void* ParallelRuns::runWorker(void *arg)
+{
+    Worker *worker = reinterpret_cast<Worker*>(arg);
+    worker->owner->workerLoop(worker->stripe);
+    return NULL;
+}
+
+void ParallelRuns::workerLoop(int stripe)
+{
+    int lastGeneration = 0;
+    for (;;) {
+        pthread_mutex_lock(&mutex);
+        while (running && generation == lastGeneration) {
+            pthread_cond_wait(&startCond, &mutex);
+        }
+        if (!running) {
+            pthread_mutex_unlock(&mutex);
+            return;
+        }
+        lastGeneration = generation;
+        pthread_mutex_unlock(&mutex);
+
+        scanStripe(stripe);
+
+        pthread_mutex_lock(&mutex);
+        if (--pending == 0) {
+            pthread_cond_signal(&doneCond);
+        }
+        pthread_mutex_unlock(&mutex);
+    }
+}
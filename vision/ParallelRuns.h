@@ -0,0 +1,99 @@
+// This file is part of Man, a robotic perception, locomotion, and
+// team strategy application created by the Northern Bites RoboCup
+// team of Bowdoin College in Brunswick, Maine, for the Aldebaran
+// Nao robot.
+//
+// Man is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Man is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// and the GNU Lesser Public License along with Man.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/**
+ * Column-parallel version of Threshold::runs().
+ *
+ * The image is cut into vertical stripes of columns.  The calling thread
+ * scans the first stripe and a worker thread scans each of the others.  The
+ * scanners do not call newRun() on the object structures themselves, since
+ * newRun() merges with the previous run and so depends on the order the runs
+ * arrive in.  Instead each stripe records its runs in its own buffer, and once
+ * all stripes are done the buffers are replayed in column order.  The object
+ * structures therefore see exactly the runs the serial loop would give them.
+ *
+ * The number of stripes follows the number of online cores (up to
+ * MAX_RUN_STRIPES); with a single core no threads are started at all and
+ * scan() is the serial loop.
+ */
+
+#ifndef ParallelRuns_h_DEFINED
+#define ParallelRuns_h_DEFINED
+
+#include <pthread.h>
+#include <vector>
+
+class Threshold;
+
+// Which object structure a buffered run is for
+enum RunTarget {
+    RUN_ORANGE = 0,
+    RUN_CROSS,
+    RUN_BLUE,
+    RUN_YELLOW,
+    RUN_RED,
+    RUN_NAVY
+};
+
+struct BufferedRun {
+    unsigned char target;
+    short x, y, h;
+};
+
+typedef std::vector<BufferedRun> RunBuffer;
+
+static const int MAX_RUN_STRIPES = 4;
+
+class ParallelRuns
+{
+public:
+    ParallelRuns(Threshold *thresh);
+    virtual ~ParallelRuns();
+
+    // Same result as the serial Threshold::runs() loop
+    void scan();
+
+    int getNumStripes() const { return numStripes; }
+
+private:
+    struct Worker {
+        ParallelRuns *owner;
+        int stripe;
+        pthread_t thread;
+    };
+
+    static void* runWorker(void *arg);
+    void workerLoop(int stripe);
+    void scanStripe(int stripe);
+
+    Threshold *thresh;
+    int numStripes;
+    RunBuffer buffers[MAX_RUN_STRIPES];
+    Worker workers[MAX_RUN_STRIPES];
+
+    // frame hand-off between the calling thread and the workers
+    pthread_mutex_t mutex;
+    pthread_cond_t startCond;
+    pthread_cond_t doneCond;
+    int generation;
+    int pending;
+    bool running;
+};
+
+#endif // ParallelRuns_h_DEFINED
@@ -5,8 +5,53 @@
 
 #include "Profiler.h"
 
+#ifdef USE_ALLOCATION_PROFILING
+#include <new>
+
+// Every operator new goes through here so that the profiler can tell how many
+// heap allocations a component makes.  The count is per thread, so the motion
+// and comm threads do not show up in the vision components.
+static __thread long long threadAllocations = 0;
+
+long long
+Profiler::allocationCount ()
+{
+  return threadAllocations;
+}
+
+static void* countedAllocation (size_t size)
+{
+  threadAllocations++;
+  void *p = malloc(size > 0 ? size : 1);
+  if (p == NULL)
+    throw std::bad_alloc();
+  return p;
+}
+
+void* operator new (size_t size) throw(std::bad_alloc)
+{
+  return countedAllocation(size);
+}
+
+void* operator new[] (size_t size) throw(std::bad_alloc)
+{
+  return countedAllocation(size);
+}
+
+void operator delete (void *p) throw()
+{
+  free(p);
+}
+
+void operator delete[] (void *p) throw()
+{
+  free(p);
+}
+#endif
+
 static const char *PCOMPONENT_NAMES[] = {
   "GetImage",
+  "ImageAge",
   "Vision",
   "Transform",
   "ThreshRuns",
@@ -38,6 +83,7 @@ static const char *PCOMPONENT_NAMES[] = {
 // summary percentages.  Mapping to self means no parent.
 static const ProfiledComponent PCOMPONENT_SUB_ORDER[] = {
 	/*P_GETIMAGE    --> */ P_GETIMAGE,
+	/*P_IMAGEAGE    --> */ P_IMAGEAGE,
 	/*P_VISION      --> */ P_FINAL,
 	/*P_TRANSFORM   --> */ P_VISION,
 	/*P_THRESHRUNS  --> */ P_VISION,
@@ -114,6 +160,12 @@ Profiler::~Profiler ()
 {
 }
 
+const char*
+Profiler::getComponentName (ProfiledComponent c)
+{
+  return PCOMPONENT_NAMES[c];
+}
+
 void
 Profiler::profileFrames (int num_frames)
 {
@@ -133,6 +185,11 @@ Profiler::reset ()
     enterTime[i] = 0;
     lastTime[i] = 0;
     sumTime[i] = 0;
+#ifdef USE_ALLOCATION_PROFILING
+    enterAllocations[i] = 0;
+    lastAllocations[i] = 0;
+    sumAllocations[i] = 0;
+#endif
   }
 }
 
@@ -159,6 +216,10 @@ Profiler::nextFrame() {
       for (int i = 0; i < NUM_PCOMPONENTS; i++) {
         sumTime[i] += lastTime[i];
         lastTime[i] = 0;
+#ifdef USE_ALLOCATION_PROFILING
+        sumAllocations[i] += lastAllocations[i];
+        lastAllocations[i] = 0;
+#endif
       }
       // continue to the next frame
       current_frame++;
@@ -209,17 +270,22 @@ Profiler::printSummary ()
     // depth-based indentation
     printf("%*s", depths[i]*2, "");
     if (sumTime[i] == 0)
-      printf("  %-*s:      0%% (0000000000us total, 000000us avg.)\n",
+      printf("  %-*s:      0%% (0000000000us total, 000000us avg.)",
           (max_length-depths[i]*2), PCOMPONENT_NAMES[i]);
     else if (parent_sum == 0)
-      printf("  %-*s: 100.00%% (%.10llu total, %.6llu avg.)\n",
+      printf("  %-*s: 100.00%% (%.10llu total, %.6llu avg.)",
           (max_length-depths[i]*2), PCOMPONENT_NAMES[i], sumTime[i],
           (sumTime[i] / (current_frame+1)));
     else
-      printf("  %-*s: %6.2f%% (%.10llu total, %.6llu avg.)\n",
+      printf("  %-*s: %6.2f%% (%.10llu total, %.6llu avg.)",
           (max_length-depths[i]*2), PCOMPONENT_NAMES[i],
           ((float)sumTime[i] / parent_sum * 100), sumTime[i],
           (sumTime[i] / (current_frame+1)));
+#ifdef USE_ALLOCATION_PROFILING
+    printf(" %8.1f allocs avg.",
+        (float)sumAllocations[i] / (current_frame+1));
+#endif
+    printf("\n");
   }
 }
 
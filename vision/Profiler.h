@@ -9,14 +9,17 @@
 #  define PROF_NFRAME(p)  ((p)->nextFrame())
 #  define PROF_ENTER(p,c) ((p)->profiling && (p)->enterComponent(c))
 #  define PROF_EXIT(p,c)  ((p)->profiling && (p)->exitComponent(c))
+#  define PROF_RECORD(p,c,t) ((p)->profiling && (p)->recordComponent(c,t))
 #else
 #  define PROF_NFRAME(p)
 #  define PROF_ENTER(p,c)
 #  define PROF_EXIT(p,c)
+#  define PROF_RECORD(p,c,t)
 #endif
 
 enum ProfiledComponent {
   P_GETIMAGE = 0,
+  P_IMAGEAGE,
   P_VISION,
   P_TRANSFORM,
   P_THRESHRUNS,
@@ -59,15 +62,35 @@ class Profiler {
 
     bool nextFrame();
 
+    // Time spent in c this frame, so far; nextFrame() starts it over
+    long long getLastTime(ProfiledComponent c) const { return lastTime[c]; }
+    static const char* getComponentName(ProfiledComponent c);
+
     inline bool enterComponent(ProfiledComponent c) {
+#ifdef USE_ALLOCATION_PROFILING
+      enterAllocations[c] = allocationCount();
+#endif
       enterTime[c] = timeFunction();
       return profiling;
     }
     inline bool exitComponent(ProfiledComponent c) {
       lastTime[c] = timeFunction() - enterTime[c];
+#ifdef USE_ALLOCATION_PROFILING
+      lastAllocations[c] = allocationCount() - enterAllocations[c];
+#endif
+      return profiling;
+    }
+    // A time measured elsewhere, e.g. how old the image was (P_IMAGEAGE)
+    inline bool recordComponent(ProfiledComponent c, long long time) {
+      lastTime[c] = time;
       return profiling;
     }
 
+#ifdef USE_ALLOCATION_PROFILING
+    // Heap allocations (operator new) made so far by the calling thread
+    static long long allocationCount();
+#endif
+
   public:
     bool profiling;
 
@@ -80,6 +103,11 @@ class Profiler {
     long long enterTime[NUM_PCOMPONENTS];
     long long lastTime[NUM_PCOMPONENTS];
     long long sumTime[NUM_PCOMPONENTS];
+#ifdef USE_ALLOCATION_PROFILING
+    long long enterAllocations[NUM_PCOMPONENTS];
+    long long lastAllocations[NUM_PCOMPONENTS];
+    long long sumAllocations[NUM_PCOMPONENTS];
+#endif
 };
 
 #endif
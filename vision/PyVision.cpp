@@ -15,6 +15,34 @@ using boost::shared_ptr;
 
 static map<const ConcreteCorner*, PyObject*> py_concrete_corners;
 
+// Replace a wrapped attribute only if the backend value differs from the one
+// it already holds.  Most values are unchanged from one frame to the next
+// (objects not seen stay zeroed), so the common case is a comparison instead
+// of a fresh Python object and a free of the old one.
+static inline void
+updateIntAttr (PyObject **attr, long value)
+{
+    if (*attr != NULL && PyInt_CheckExact(*attr) &&
+        PyInt_AS_LONG(*attr) == value)
+        return;
+
+    PyObject *old = *attr;
+    *attr = PyInt_FromLong(value);
+    Py_XDECREF(old);
+}
+
+static inline void
+updateFloatAttr (PyObject **attr, double value)
+{
+    if (*attr != NULL && PyFloat_CheckExact(*attr) &&
+        PyFloat_AS_DOUBLE(*attr) == value)
+        return;
+
+    PyObject *old = *attr;
+    *attr = PyFloat_FromDouble(value);
+    Py_XDECREF(old);
+}
+
 #if 0
 //
 // PyRobotAccess definitions
@@ -175,22 +203,12 @@ PyPose_new (NaoPose *p)
 extern void
 PyPose_update (PyPose *self)
 {
-    Py_XDECREF(self->leftHorizonY);
-    self->leftHorizonY = PyInt_FromLong(self->pose->getLeftHorizonY());
-
-    Py_XDECREF(self->rightHorizonY);
-    self->rightHorizonY = PyInt_FromLong(self->pose->getRightHorizonY());
-
-    Py_XDECREF(self->horizonSlope);
-    self->horizonSlope = PyFloat_FromDouble(self->pose->getHorizonSlope());
-
-	Py_XDECREF(self->cameraInWorldFrameZ);
-	self->cameraInWorldFrameZ =
-		PyFloat_FromDouble(self->pose->getFocalPointInWorldFrameZ());
-
-    Py_XDECREF(self->bodyCenterHeight);
-    self->bodyCenterHeight = PyFloat_FromDouble(
-        self->pose->getBodyCenterHeight());
+    updateIntAttr(&self->leftHorizonY, self->pose->getLeftHorizonY());
+    updateIntAttr(&self->rightHorizonY, self->pose->getRightHorizonY());
+    updateFloatAttr(&self->horizonSlope, self->pose->getHorizonSlope());
+    updateFloatAttr(&self->cameraInWorldFrameZ,
+                    self->pose->getFocalPointInWorldFrameZ());
+    updateFloatAttr(&self->bodyCenterHeight, self->pose->getBodyCenterHeight());
 
     //Py_XDECREF(self->panAngle);
     //self->panAngle = PyFloat_FromDouble(self->pose->getPan());
@@ -291,11 +309,8 @@ PyVisualCorner_new (PyFieldLines *fl, int i, const VisualCorner &corner)
 extern void
 PyVisualCorner_update (PyVisualCorner *self, const VisualCorner &corner)
 {
-    Py_XDECREF(self->dist);
-    self->dist = PyFloat_FromDouble(corner.getDistance());
-
-    Py_XDECREF(self->bearing);
-    self->bearing = PyFloat_FromDouble(corner.getBearingDeg());
+    updateFloatAttr(&self->dist, corner.getDistance());
+    updateFloatAttr(&self->bearing, corner.getBearingDeg());
 
     list<const ConcreteCorner*> possibilities = corner.getPossibleCorners();
     if (self->possibilities == NULL)
@@ -311,7 +326,7 @@ PyVisualCorner_update (PyVisualCorner *self, const VisualCorner &corner)
             else
                 PyList_Append(self->possibilities, py_concrete_corners[*c]);
         }
-        if (c_i >= PyList_Size(self->possibilities))
+        if (c_i < PyList_Size(self->possibilities))
             PySequence_DelSlice(self->possibilities, c_i,
                                 PyList_Size(self->possibilities));
     }
@@ -454,23 +469,12 @@ PyVisualLine_update (PyVisualLine *self)
 extern void
 PyVisualLine_update (PyVisualLine *self, shared_ptr<VisualLine> line)
 {
-    Py_XDECREF(self->x1);
-    self->x1 = PyInt_FromLong(line->start.x);
-
-    Py_XDECREF(self->y1);
-    self->y1 = PyInt_FromLong(line->start.y);
-
-    Py_XDECREF(self->x2);
-    self->x2 = PyInt_FromLong(line->end.x);
-
-    Py_XDECREF(self->y2);
-    self->y2 = PyInt_FromLong(line->end.y);
-
-    Py_XDECREF(self->slope);
-    self->slope = PyFloat_FromDouble(line->getSlope());
-
-    Py_XDECREF(self->length);
-    self->length = PyFloat_FromDouble(line->length);
+    updateIntAttr(&self->x1, line->start.x);
+    updateIntAttr(&self->y1, line->start.y);
+    updateIntAttr(&self->x2, line->end.x);
+    updateIntAttr(&self->y2, line->end.y);
+    updateFloatAttr(&self->slope, line->getSlope());
+    updateFloatAttr(&self->length, line->length);
 }
 
 // backend methods
@@ -587,10 +591,8 @@ PyFieldLines_update (PyFieldLines *self)
     const list<VisualCorner> *corners = self->fl->getCorners();
     const vector< shared_ptr<VisualLine> > *lines = self->fl->getLines();
 
-    Py_XDECREF(self->numCorners);
-    self->numCorners = PyInt_FromLong(corners->size());
-    Py_XDECREF(self->numLines);
-    self->numLines = PyInt_FromLong(lines->size());
+    updateIntAttr(&self->numCorners, corners->size());
+    updateIntAttr(&self->numLines, lines->size());
 
     // Update all the corners, adding new ones if necessary
     unsigned int i = 0;
@@ -655,6 +657,88 @@ PyFieldLines_update (PyObject *self, PyObject *args)
     return Py_None;
 }
 
+// Build a tuple of numColumns empty tuples, each with room for n entries
+static PyObject *
+newColumns (int numColumns, int n)
+{
+    PyObject *columns = PyTuple_New(numColumns);
+    if (columns == NULL)
+        return NULL;
+
+    for (int k = 0; k < numColumns; k++) {
+        PyObject *column = PyTuple_New(n);
+        if (column == NULL) {
+            Py_DECREF(columns);
+            return NULL;
+        }
+        PyTuple_SET_ITEM(columns, k, column);
+    }
+    return columns;
+}
+
+// Store a new reference in row i of column k, returning false on failure
+static inline bool
+setColumnItem (PyObject *columns, int k, int i, PyObject *item)
+{
+    if (item == NULL)
+        return false;
+    PyTuple_SET_ITEM(PyTuple_GET_ITEM(columns, k), i, item);
+    return true;
+}
+
+extern PyObject *
+PyFieldLines_lineArrays (PyObject *self, PyObject *args)
+{
+    const vector< shared_ptr<VisualLine> > *lines =
+        ((PyFieldLines *)self)->fl->getLines();
+
+    PyObject *columns = newColumns(6, lines->size());
+    if (columns == NULL)
+        return NULL;
+
+    for (unsigned int i = 0; i < lines->size(); i++) {
+        const shared_ptr<VisualLine> &line = lines->at(i);
+        if (!setColumnItem(columns, 0, i, PyInt_FromLong(line->start.x)) ||
+            !setColumnItem(columns, 1, i, PyInt_FromLong(line->start.y)) ||
+            !setColumnItem(columns, 2, i, PyInt_FromLong(line->end.x)) ||
+            !setColumnItem(columns, 3, i, PyInt_FromLong(line->end.y)) ||
+            !setColumnItem(columns, 4, i,
+                           PyFloat_FromDouble(line->getSlope())) ||
+            !setColumnItem(columns, 5, i, PyFloat_FromDouble(line->length))) {
+            Py_DECREF(columns);
+            return NULL;
+        }
+    }
+    return columns;
+}
+
+extern PyObject *
+PyFieldLines_cornerArrays (PyObject *self, PyObject *args)
+{
+    const list<VisualCorner> *corners =
+        ((PyFieldLines *)self)->fl->getCorners();
+
+    PyObject *columns = newColumns(5, corners->size());
+    if (columns == NULL)
+        return NULL;
+
+    int i = 0;
+    for (list<VisualCorner>::const_iterator c = corners->begin();
+         c != corners->end(); i++, c++) {
+        if (!setColumnItem(columns, 0, i, PyInt_FromLong(c->getX())) ||
+            !setColumnItem(columns, 1, i, PyInt_FromLong(c->getY())) ||
+            !setColumnItem(columns, 2, i,
+                           PyFloat_FromDouble(c->getDistance())) ||
+            !setColumnItem(columns, 3, i,
+                           PyFloat_FromDouble(c->getBearingDeg())) ||
+            !setColumnItem(columns, 4, i, PyInt_FromLong(c->getShape()))) {
+            Py_DECREF(columns);
+            return NULL;
+        }
+    }
+    return columns;
+}
+
 
 
 //
@@ -702,11 +786,8 @@ PyThreshold_new (Threshold *t)
 extern void
 PyThreshold_update (PyThreshold *self)
 {
-    Py_XDECREF(self->width);
-    self->width = PyInt_FromLong(IMAGE_WIDTH);
-
-    Py_XDECREF(self->height);
-    self->height = PyInt_FromLong(IMAGE_HEIGHT);
+    updateIntAttr(&self->width, IMAGE_WIDTH);
+    updateIntAttr(&self->height, IMAGE_HEIGHT);
 }
 
 // backend methods
@@ -813,32 +894,15 @@ PyBall_new (VisualBall *b)
 extern void
 PyBall_update (PyBall *self)
 {
-    Py_XDECREF(self->centerX);
-    self->centerX = PyInt_FromLong(self->ball->getCenterX());
-
-    Py_XDECREF(self->centerY);
-    self->centerY = PyInt_FromLong(self->ball->getCenterY());
-
-    Py_XDECREF(self->width);
-    self->width = PyFloat_FromDouble(self->ball->getWidth());
-
-    Py_XDECREF(self->height);
-    self->height = PyFloat_FromDouble(self->ball->getHeight());
-
-    Py_XDECREF(self->focDist);
-    self->focDist = PyFloat_FromDouble(self->ball->getFocDist());
-
-    Py_XDECREF(self->dist);
-    self->dist = PyFloat_FromDouble(self->ball->getDistance());
-
-    Py_XDECREF(self->bearing);
-    self->bearing = PyFloat_FromDouble(self->ball->getBearingDeg());
-
-    Py_XDECREF(self->elevation);
-    self->elevation = PyFloat_FromDouble(self->ball->getElevationDeg());
-
-    Py_XDECREF(self->confidence);
-    self->confidence = PyInt_FromLong(self->ball->getConfidence());
+    updateIntAttr(&self->centerX, self->ball->getCenterX());
+    updateIntAttr(&self->centerY, self->ball->getCenterY());
+    updateFloatAttr(&self->width, self->ball->getWidth());
+    updateFloatAttr(&self->height, self->ball->getHeight());
+    updateFloatAttr(&self->focDist, self->ball->getFocDist());
+    updateFloatAttr(&self->dist, self->ball->getDistance());
+    updateFloatAttr(&self->bearing, self->ball->getBearingDeg());
+    updateFloatAttr(&self->elevation, self->ball->getElevationDeg());
+    updateIntAttr(&self->confidence, self->ball->getConfidence());
 }
 
 // backend methods
@@ -922,32 +986,15 @@ PyFieldObject_new (VisualFieldObject *o)
 extern void
 PyFieldObject_update (PyFieldObject *self)
 {
-    Py_XDECREF(self->centerX);
-    self->centerX = PyInt_FromLong(self->object->getCenterX());
-
-    Py_XDECREF(self->centerY);
-    self->centerY = PyInt_FromLong(self->object->getCenterY());
-
-    Py_XDECREF(self->width);
-    self->width = PyFloat_FromDouble(self->object->getWidth());
-
-    Py_XDECREF(self->height);
-    self->height = PyFloat_FromDouble(self->object->getHeight());
-
-    Py_XDECREF(self->focDist);
-    self->focDist = PyFloat_FromDouble(self->object->getFocDist());
-
-    Py_XDECREF(self->dist);
-    self->dist = PyFloat_FromDouble(self->object->getDistance());
-
-    Py_XDECREF(self->bearing);
-    self->bearing = PyFloat_FromDouble(self->object->getBearingDeg());
-
-    Py_XDECREF(self->certainty);
-    self->certainty = PyInt_FromLong(self->object->getIDCertainty());
-
-    Py_XDECREF(self->distCertainty);
-    self->distCertainty = PyInt_FromLong(self->object->getDistanceCertainty());
+    updateIntAttr(&self->centerX, self->object->getCenterX());
+    updateIntAttr(&self->centerY, self->object->getCenterY());
+    updateFloatAttr(&self->width, self->object->getWidth());
+    updateFloatAttr(&self->height, self->object->getHeight());
+    updateFloatAttr(&self->focDist, self->object->getFocDist());
+    updateFloatAttr(&self->dist, self->object->getDistance());
+    updateFloatAttr(&self->bearing, self->object->getBearingDeg());
+    updateIntAttr(&self->certainty, self->object->getIDCertainty());
+    updateIntAttr(&self->distCertainty, self->object->getDistanceCertainty());
 }
 
 // backend methods
@@ -1416,50 +1463,21 @@ extern PyObject * PyCrossbar_new (VisualCrossbar *b)
 
 extern void PyCrossbar_update (PyCrossbar *self)
 {
-    Py_XDECREF(self->x);
-    self->x = PyInt_FromLong(self->crossbar->getX());
-
-    Py_XDECREF(self->y);
-    self->y = PyInt_FromLong(self->crossbar->getY());
-
-    Py_XDECREF(self->centerX);
-    self->centerX = PyInt_FromLong(self->crossbar->getCenterX());
-
-    Py_XDECREF(self->centerY);
-    self->centerY = PyInt_FromLong(self->crossbar->getCenterY());
-
-    Py_XDECREF(self->angleX);
-    self->angleX = PyFloat_FromDouble(self->crossbar->getAngleXDeg());
-
-    Py_XDECREF(self->angleX);
-    self->angleY = PyFloat_FromDouble(self->crossbar->getAngleYDeg());
-
-    Py_XDECREF(self->width);
-    self->width = PyFloat_FromDouble(self->crossbar->getWidth());
-
-    Py_XDECREF(self->height);
-    self->height = PyFloat_FromDouble(self->crossbar->getHeight());
-
-    Py_XDECREF(self->focDist);
-    self->focDist = PyFloat_FromDouble(self->crossbar->getFocDist());
-
-    Py_XDECREF(self->dist);
-    self->dist = PyFloat_FromDouble(self->crossbar->getDistance());
-
-    Py_XDECREF(self->bearing);
-    self->bearing = PyFloat_FromDouble(self->crossbar->getBearingDeg());
-
-    Py_XDECREF(self->elevation);
-    self->elevation = PyFloat_FromDouble(self->crossbar->getElevationDeg());
-
-    Py_XDECREF(self->leftOpening);
-    self->leftOpening = PyInt_FromLong(self->crossbar->getLeftOpening());
-
-    Py_XDECREF(self->rightOpening);
-    self->rightOpening = PyInt_FromLong(self->crossbar->getRightOpening());
-
-    Py_XDECREF(self->shoot);
-    self->shoot = PyInt_FromLong(self->crossbar->shotAvailable());
+    updateIntAttr(&self->x, self->crossbar->getX());
+    updateIntAttr(&self->y, self->crossbar->getY());
+    updateIntAttr(&self->centerX, self->crossbar->getCenterX());
+    updateIntAttr(&self->centerY, self->crossbar->getCenterY());
+    updateFloatAttr(&self->angleX, self->crossbar->getAngleXDeg());
+    updateFloatAttr(&self->angleY, self->crossbar->getAngleYDeg());
+    updateFloatAttr(&self->width, self->crossbar->getWidth());
+    updateFloatAttr(&self->height, self->crossbar->getHeight());
+    updateFloatAttr(&self->focDist, self->crossbar->getFocDist());
+    updateFloatAttr(&self->dist, self->crossbar->getDistance());
+    updateFloatAttr(&self->bearing, self->crossbar->getBearingDeg());
+    updateFloatAttr(&self->elevation, self->crossbar->getElevationDeg());
+    updateIntAttr(&self->leftOpening, self->crossbar->getLeftOpening());
+    updateIntAttr(&self->rightOpening, self->crossbar->getRightOpening());
+    updateIntAttr(&self->shoot, self->crossbar->shotAvailable());
 
 }
 
@@ -1532,41 +1550,18 @@ extern PyObject * PyVisualRobot_new (VisualRobot *b)
 
 extern void PyVisualRobot_update (PyVisualRobot *self)
 {
-    Py_XDECREF(self->x);
-    self->x = PyInt_FromLong(self->robot->getX());
-
-    Py_XDECREF(self->y);
-    self->y = PyInt_FromLong(self->robot->getY());
-
-    Py_XDECREF(self->centerX);
-    self->centerX = PyInt_FromLong(self->robot->getCenterX());
-
-    Py_XDECREF(self->centerY);
-    self->centerY = PyInt_FromLong(self->robot->getCenterY());
-
-    Py_XDECREF(self->angleX);
-    self->angleX = PyFloat_FromDouble(self->robot->getAngleXDeg());
-
-    Py_XDECREF(self->angleX);
-    self->angleY = PyFloat_FromDouble(self->robot->getAngleYDeg());
-
-    Py_XDECREF(self->width);
-    self->width = PyFloat_FromDouble(self->robot->getWidth());
-
-    Py_XDECREF(self->height);
-    self->height = PyFloat_FromDouble(self->robot->getHeight());
-
-    Py_XDECREF(self->focDist);
-    self->focDist = PyFloat_FromDouble(self->robot->getFocDist());
-
-    Py_XDECREF(self->dist);
-    self->dist = PyFloat_FromDouble(self->robot->getDistance());
-
-    Py_XDECREF(self->bearing);
-    self->bearing = PyFloat_FromDouble(self->robot->getBearingDeg());
-
-    Py_XDECREF(self->elevation);
-    self->elevation = PyFloat_FromDouble(self->robot->getElevationDeg());
+    updateIntAttr(&self->x, self->robot->getX());
+    updateIntAttr(&self->y, self->robot->getY());
+    updateIntAttr(&self->centerX, self->robot->getCenterX());
+    updateIntAttr(&self->centerY, self->robot->getCenterY());
+    updateFloatAttr(&self->angleX, self->robot->getAngleXDeg());
+    updateFloatAttr(&self->angleY, self->robot->getAngleYDeg());
+    updateFloatAttr(&self->width, self->robot->getWidth());
+    updateFloatAttr(&self->height, self->robot->getHeight());
+    updateFloatAttr(&self->focDist, self->robot->getFocDist());
+    updateFloatAttr(&self->dist, self->robot->getDistance());
+    updateFloatAttr(&self->bearing, self->robot->getBearingDeg());
+    updateFloatAttr(&self->elevation, self->robot->getElevationDeg());
 }
 
 // backend methods
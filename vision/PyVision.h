@@ -182,6 +182,8 @@ extern PyObject *PyFieldLines_new    (PyTypeObject *type, PyObject *args,
 extern void      PyFieldLines_dealloc(PyFieldLines *self);
 // Python - accessible interface
 extern PyObject *PyFieldLines_update (PyObject *self, PyObject *args);
+extern PyObject *PyFieldLines_lineArrays   (PyObject *self, PyObject *args);
+extern PyObject *PyFieldLines_cornerArrays (PyObject *self, PyObject *args);
 
 // Method list
 static PyMethodDef PyFieldLines_methods[] = {
@@ -191,6 +193,15 @@ static PyMethodDef PyFieldLines_methods[] = {
      "backend C++ objects.  Recurses down the variable references to update "
      "any attributes that are also wrapped C++ vision objects."},
 
+    {"lineArrays", (PyCFunction)PyFieldLines_lineArrays, METH_NOARGS,
+     "Return the lines currently seen as a tuple of columns\n"
+     "(x1, y1, x2, y2, slope, length), each a tuple with one entry per line.\n"
+     "Built straight from the C++ lines in one call, without going through\n"
+     "the Line objects."},
+    {"cornerArrays", (PyCFunction)PyFieldLines_cornerArrays, METH_NOARGS,
+     "Return the corners currently seen as a tuple of columns\n"
+     "(x, y, dist, bearing, shape), each a tuple with one entry per corner."},
+
     /* Sentinel */
     { NULL }
 };
@@ -0,0 +1,93 @@
+// This file is part of Man, a robotic perception, locomotion, and
+// team strategy application created by the Northern Bites RoboCup
+// team of Bowdoin College in Brunswick, Maine, for the Aldebaran
+// Nao robot.
+//
+// Man is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Man is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// and the GNU Lesser Public License along with Man.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#include "RegionOfInterest.h"
+
+RegionOfInterest::RegionOfInterest()
+    : enabled(false), fullFrame(true),
+      fullFrameInterval(ROI_FULL_FRAME_INTERVAL), framesSinceFull(0),
+      topRow(0)
+{
+    clearWindows();
+    for (int x = 0; x < IMAGE_WIDTH; x++) {
+        coarse[x] = false;
+    }
+}
+
+// Turning the region on or off always starts over with a full frame
+void RegionOfInterest::setEnabled(bool on)
+{
+    enabled = on;
+    framesSinceFull = fullFrameInterval;
+    clearWindows();
+}
+
+/* Work out which rows and columns to process this frame.
+ * @param horizonTop   the highest row the pose horizon crosses the image at
+ */
+void RegionOfInterest::startFrame(int horizonTop)
+{
+    fullFrame = !enabled || framesSinceFull + 1 >= fullFrameInterval;
+    if (fullFrame) {
+        framesSinceFull = 0;
+        topRow = 0;
+        for (int x = 0; x < IMAGE_WIDTH; x++) {
+            coarse[x] = false;
+        }
+        return;
+    }
+
+    framesSinceFull++;
+    topRow = (horizonTop < windowTop ? horizonTop : windowTop) -
+        ROI_SKY_MARGIN;
+    if (topRow < 0) {
+        topRow = 0;
+    } else if (topRow > IMAGE_HEIGHT - 1) {
+        topRow = IMAGE_HEIGHT - 1;
+    }
+    for (int x = 0; x < IMAGE_WIDTH; x++) {
+        coarse[x] = !windowColumns[x];
+    }
+}
+
+void RegionOfInterest::clearWindows()
+{
+    windowTop = IMAGE_HEIGHT;
+    for (int x = 0; x < IMAGE_WIDTH; x++) {
+        windowColumns[x] = false;
+    }
+}
+
+/* Remember an object seen this frame; next frame its columns are scanned at
+ * full resolution and its rows are classified.
+ * @param left     left edge of the object in the image
+ * @param right    right edge of the object
+ * @param top      top edge of the object
+ */
+void RegionOfInterest::addWindow(int left, int right, int top)
+{
+    left -= ROI_WINDOW_MARGIN;
+    right += ROI_WINDOW_MARGIN;
+    for (int x = (left > 0 ? left : 0); x <= right && x < IMAGE_WIDTH; x++) {
+        windowColumns[x] = true;
+    }
+    if (top < windowTop) {
+        windowTop = top;
+    }
+}
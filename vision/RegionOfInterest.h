@@ -0,0 +1,85 @@
+// This file is part of Man, a robotic perception, locomotion, and
+// team strategy application created by the Northern Bites RoboCup
+// team of Bowdoin College in Brunswick, Maine, for the Aldebaran
+// Nao robot.
+//
+// Man is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Man is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// and the GNU Lesser Public License along with Man.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/**
+ * Region of interest for the vision loop.
+ *
+ * When enabled, most frames are only partly processed:
+ *  - rows well above the pose horizon (and above any goal post we are
+ *    tracking) are not classified, they are left GREY
+ *  - columns near where the ball or a post was last frame are scanned for
+ *    runs at full resolution; elsewhere columns go in pairs, only the first
+ *    is scanned and its runs are counted for the second as well, so blobs
+ *    keep their size
+ * Every fullFrameInterval frames the whole image is processed as usual, so
+ * that new objects are not missed for long.
+ *
+ * Threshold owns one of these, calls startFrame() before thresholding and
+ * hands it the objects it found afterwards.  It is off by default.
+ */
+
+#ifndef RegionOfInterest_h_DEFINED
+#define RegionOfInterest_h_DEFINED
+
+#include "VisionDef.h"
+
+// rows above the pose horizon that we still classify
+static const int ROI_SKY_MARGIN = 30;
+// columns either side of a tracked object scanned at full resolution
+static const int ROI_WINDOW_MARGIN = 20;
+// process the whole image at least this often
+static const int ROI_FULL_FRAME_INTERVAL = 10;
+
+class RegionOfInterest
+{
+public:
+    RegionOfInterest();
+    virtual ~RegionOfInterest() {}
+
+    void setEnabled(bool on);
+    bool isEnabled() const { return enabled; }
+    void setFullFrameInterval(int frames) { fullFrameInterval = frames; }
+    int getFullFrameInterval() const { return fullFrameInterval; }
+
+    // Decide what to process this frame
+    void startFrame(int horizonTop);
+
+    // The objects seen this frame, which become next frame's windows
+    void clearWindows();
+    void addWindow(int left, int right, int top);
+
+    bool isFullFrame() const { return fullFrame; }
+    // first row to classify
+    int getTopRow() const { return topRow; }
+    // whether column x is only scanned at half resolution
+    bool isCoarse(int x) const { return coarse[x]; }
+
+private:
+    bool enabled;
+    bool fullFrame;
+    int fullFrameInterval;
+    int framesSinceFull;
+    int topRow;
+
+    int windowTop;
+    bool windowColumns[IMAGE_WIDTH];
+    bool coarse[IMAGE_WIDTH];
+};
+
+#endif // RegionOfInterest_h_DEFINED
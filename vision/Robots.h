@@ -38,29 +38,22 @@ public:
     virtual ~Robots() {}
 
 	void init();
-	void preprocess();
 	void robot(int bg);
-	void expandRobotBlob(int which);
-	bool noWhite(Blob b);
-	void expandHorizontally(int which, int dir);
-	int expandVertically(int which, int dir);
-	bool goodScan(int c, int w, int o, int g, int gr, int t);
+	void newRun(int x, int y, int h);
+	void newWhiteRun(int x, int y, int h);
 	void updateRobots(int w, int i);
-	void mergeBigBlobs();
 	bool closeEnough(Blob a, Blob b);
 	bool bigEnough(Blob a, Blob b);
-	bool noGreen(Blob a, Blob b);
-	bool checkHorizontal(int l, int r, int t, int b);
-	bool checkVertical(int l, int r, int t, int b);
-	bool viableRobot(Blob a);
-	void createObject();
-	void newRun(int x, int y, int h);
 	void setColor(int c);
 	void allocateColorRuns();
 	int distance(int x, int x1, int x2, int x3);
 	void printBlob(Blob a);
 
 private:
+	void addWhite(int which);
+	void mergeBigBlobs();
+	bool viableRobot(int which);
+
     // class pointers
     Vision* vision;
     Threshold* thresh;
@@ -71,5 +64,9 @@ private:
 	int color;
 	Blob* topBlob;
 	run* runs;
+	// WHITE runs from the same scan, and how much of it each blob took in
+	int numberOfWhiteRuns;
+	run* whiteRuns;
+	int* whitePixels;
 };
 #endif
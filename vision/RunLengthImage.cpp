@@ -0,0 +1,136 @@
+// This file is part of Man, a robotic perception, locomotion, and
+// team strategy application created by the Northern Bites RoboCup
+// team of Bowdoin College in Brunswick, Maine, for the Aldebaran
+// Nao robot.
+//
+// Man is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Man is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// and the GNU Lesser Public License along with Man.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#include <string.h>
+
+#include "RunLengthImage.h"
+
+// how many pixels we compare at once when looking for changes
+static const int WORD_PIXELS = sizeof(unsigned int);
+
+RunLengthImage::RunLengthImage()
+{
+    for (int x = 0; x < IMAGE_WIDTH; x++) {
+        counts[x] = 0;
+        runs[x][0].top = IMAGE_HEIGHT;
+        runs[x][0].color = 0;
+    }
+}
+
+/* Add classified rows to the encoding.
+ * @param rows       row-major colors, IMAGE_WIDTH per row, starting at
+ *                   firstRow and preceded in memory by the row above it
+ * @param firstRow   row of the image the first of rows is
+ * @param numRows    how many rows to add
+ */
+void RunLengthImage::addRows(const unsigned char *rows, int firstRow,
+                             int numRows)
+{
+    int y = firstRow;
+    const unsigned char *row = rows;
+
+    if (y == 0) {
+        // every column starts with a run
+        for (int x = 0; x < IMAGE_WIDTH; x++) {
+            runs[x][0].top = 0;
+            runs[x][0].color = row[x];
+            counts[x] = 1;
+        }
+        y++;
+        row += IMAGE_WIDTH;
+    }
+
+    for (const int end = firstRow + numRows; y < end; y++) {
+        const unsigned char *above = row - IMAGE_WIDTH;
+        for (int x = 0; x < IMAGE_WIDTH; x += WORD_PIXELS) {
+            unsigned int now, before;
+            memcpy(&now, row + x, WORD_PIXELS);
+            memcpy(&before, above + x, WORD_PIXELS);
+            if (now == before) {
+                continue;
+            }
+            for (int i = x; i < x + WORD_PIXELS; i++) {
+                if (row[i] != above[i]) {
+                    ColorRun &run = runs[i][counts[i]++];
+                    run.top = static_cast<short>(y);
+                    run.color = row[i];
+                }
+            }
+        }
+        row += IMAGE_WIDTH;
+    }
+}
+
+// Close off every column with its sentinel
+void RunLengthImage::finish()
+{
+    for (int x = 0; x < IMAGE_WIDTH; x++) {
+        runs[x][counts[x]].top = IMAGE_HEIGHT;
+        runs[x][counts[x]].color = 0;
+    }
+}
+
+/* Binary search a column for the run covering a row.
+ * @param x    the column
+ * @param y    the row, 0 <= y < IMAGE_HEIGHT
+ */
+int RunLengthImage::runAt(int x, int y) const
+{
+    const ColorRun *col = runs[x];
+    int low = 0, high = counts[x] - 1;
+    while (low < high) {
+        const int mid = (low + high + 1) / 2;
+        if (col[mid].top <= y) {
+            low = mid;
+        } else {
+            high = mid - 1;
+        }
+    }
+    return low;
+}
+
+int RunLengthImage::countColors(int x, int first, int last,
+                                const int colors[], int numColors) const
+{
+    if (first > last) {
+        return 0;
+    }
+    const ColorRun *col = runs[x];
+    int found = 0;
+    for (int r = runAt(x, first); col[r].top <= last; r++) {
+        for (int c = 0; c < numColors; c++) {
+            if (colors[c] == col[r].color) {
+                const int top = col[r].top > first ? col[r].top : first;
+                const int end = bottom(col + r) < last ? bottom(col + r) : last;
+                found += end - top + 1;
+                break;
+            }
+        }
+    }
+    return found;
+}
+
+int RunLengthImage::getTotalRuns() const
+{
+    int total = 0;
+    for (int x = 0; x < IMAGE_WIDTH; x++) {
+        total += counts[x];
+    }
+    return total;
+}
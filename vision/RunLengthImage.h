@@ -0,0 +1,79 @@
+// This file is part of Man, a robotic perception, locomotion, and
+// team strategy application created by the Northern Bites RoboCup
+// team of Bowdoin College in Brunswick, Maine, for the Aldebaran
+// Nao robot.
+//
+// Man is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Man is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// and the GNU Lesser Public License along with Man.  If not, see
+// <http://www.gnu.org/licenses/>.
+
+/**
+ * Column-major run-length encoding of the thresholded image.
+ *
+ * Each column is kept as a list of runs of a single color, top to bottom.  A
+ * run only stores where it starts and its color; it lasts until the next run
+ * starts, and every column ends with a sentinel run starting at IMAGE_HEIGHT.
+ * The vertical scanners can then step over a long stretch of GREEN or GREY in
+ * one go instead of reading every byte of it, IMAGE_WIDTH bytes apart.
+ *
+ * The encoding is built while thresholding: Threshold::threshold() classifies
+ * the image a few rows at a time and hands each band to addRows() while it is
+ * still in the cache.  A run starts wherever a pixel differs from the one
+ * above it, so addRows() compares each row with the previous one a word at a
+ * time and only looks at single pixels where something changed.
+ */
+
+#ifndef RunLengthImage_h_DEFINED
+#define RunLengthImage_h_DEFINED
+
+#include "VisionDef.h"
+
+struct ColorRun {
+    short top;
+    unsigned char color;
+};
+
+class RunLengthImage
+{
+public:
+    RunLengthImage();
+    virtual ~RunLengthImage() {}
+
+    // Feed classified rows in order, starting from row 0, then call finish()
+    void addRows(const unsigned char *rows, int firstRow, int numRows);
+    void finish();
+
+    // Runs of column x, top to bottom, followed by the sentinel
+    const ColorRun* column(int x) const { return runs[x]; }
+    int numRuns(int x) const { return counts[x]; }
+
+    // Index in column(x) of the run that covers row y
+    int runAt(int x, int y) const;
+
+    static int bottom(const ColorRun *run) { return run[1].top - 1; }
+    static int height(const ColorRun *run) { return run[1].top - run[0].top; }
+
+    // How many pixels of column x from row first to row last (inclusive)
+    // have one of the given colors
+    int countColors(int x, int first, int last,
+                    const int colors[], int numColors) const;
+
+    // Total number of runs in the frame, for measuring how much we skip
+    int getTotalRuns() const;
+
+private:
+    ColorRun runs[IMAGE_WIDTH][IMAGE_HEIGHT + 1];
+    int counts[IMAGE_WIDTH];
+};
+
+#endif // RunLengthImage_h_DEFINED
@@ -51,6 +51,9 @@
 
 #include <math.h>
 #include <assert.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <algorithm>
 #if ROBOT(NAO_SIM)
 #  include <aldefinitions.h>
 #endif
@@ -59,19 +62,60 @@
 #include "Threshold.h"
 #include "debug.h"
 
+#ifdef THRESHOLD_VECTOR_KERNEL
+#  if defined(__SSE2__)
+#    include <emmintrin.h>
+#  else
+#    include <arm_neon.h>
+#  endif
+#endif
+
 using namespace std;
 using boost::shared_ptr;
 #define PRINT_VISION_INFO
 
+// Color table lookups for the thresholding loops, either with the pixel's
+// y, u, v values or with an already shifted flat cube offset
+#ifdef USE_COMPACT_TABLE
+#  define TABLE_LOOKUP(y, u, v) \
+    compactTable->lookup((y) >> YSHIFT, (u) >> USHIFT, (v) >> VSHIFT)
+#  define TABLE_AT(i) compactTable->at(i)
+#else
+#  define TABLE_LOOKUP(y, u, v) \
+    bigTable[(y) >> YSHIFT][(u) >> USHIFT][(v) >> VSHIFT]
+#  define TABLE_AT(i) (&bigTable[0][0][0])[i]
+#endif
+
 // Constructor for Threshold class. passed an instance of Vision and Pose
 Threshold::Threshold(Vision* vis, shared_ptr<NaoPose> posPtr)
-    : inverted(false), vision(vis), pose(posPtr)
+    :
+#ifdef USE_INTEGRAL_IMAGE
+      integrals(&thresholded[0][0]),
+#endif
+      inverted(false), vision(vis), pose(posPtr),
+      activeTable(&tableBuffers[0]), pendingTable(NULL), pendingSince(0),
+      tableInode(0), tableTime(0), tableWatchInterval(0),
+      framesSinceTableCheck(0)
+#ifdef USE_PARALLEL_RUNS
+    , parallelRuns(this)
+#endif
 {
+    pthread_mutex_init(&tableMutex, NULL);
+    bigTable = reinterpret_cast<const unsigned char (*)[UMAX][VMAX]>(
+        activeTable->getCube());
+#ifdef USE_COMPACT_TABLE
+    compactTable = &activeTable->compact;
+#endif
 
     // storing locally
 #ifdef OFFLINE
     visualHorizonDebug = false;
 	debugSelf = true;
+    roiFrames = 0;
+    roiTime = fullTime = 0;
+    for (int i = 0; i < ROI_COMPARED; i++) {
+        fullRuns[i] = roiRecalled[i] = roiExtra[i] = 0;
+    }
 #endif
 
     // loads the color table on the MS into memory
@@ -125,6 +169,10 @@ void Threshold::visionLoop() {
     objectRecognition();
     PROF_EXIT(vision->profiler, P_OBJECT);
 
+    if (roi.isEnabled()) {
+        trackRegionOfInterest();
+    }
+
     vision->fieldLines->afterObjectFragments();
 	// For now we don't set shooting information
     if (vision->bgCrossbar->getWidth() > 0) {
@@ -157,6 +205,18 @@ void Threshold::visionLoop() {
 void Threshold::thresholdAndRuns() {
     PROF_ENTER(vision->profiler, P_THRESHRUNS); // profiling
 
+    // A table loaded since last frame is used from now on
+    if (tableWatchInterval > 0 &&
+        ++framesSinceTableCheck >= tableWatchInterval) {
+        framesSinceTableCheck = 0;
+        reloadTableIfChanged();
+    }
+    useNewTable();
+
+    // Decide how much of the image this frame needs
+    roi.startFrame(min(pose->getHorizonY(0),
+                       pose->getHorizonY(IMAGE_WIDTH - 1)));
+
     // Perform image thresholding
     PROF_ENTER(vision->profiler, P_THRESHOLD);
     threshold();
@@ -184,23 +244,92 @@ void Threshold::thresholdAndRuns() {
  * the runs loops, I (Jeremy) have split out the thresholding into it's own
  * method here.  This also allows for my incredibly complex unrolled loops for
  * each robot to be separated from other, clearer, code.
+ * When built with USE_SIMD_THRESHOLD on a machine with SSE2 or NEON the
+ * vectorized kernel is used, otherwise the scalar loop.
  */
 void Threshold::threshold() {
+#if defined(USE_RUN_LENGTH_IMAGE) || defined(USE_COLUMN_MAJOR_IMAGE)
+    // classify a band of rows at a time and build the other layouts of it
+    // while it's still hot
+    for (int row = 0; row < IMAGE_HEIGHT; row += THRESHOLD_BAND_ROWS) {
+        const int rows = min(THRESHOLD_BAND_ROWS, IMAGE_HEIGHT - row);
+        thresholdRows(row, rows);
+#  ifdef USE_RUN_LENGTH_IMAGE
+        runLengths.addRows(&thresholded[row][0], row, rows);
+#  endif
+#  ifdef USE_COLUMN_MAJOR_IMAGE
+        transposeRows(row, rows);
+#  endif
+    }
+#  ifdef USE_RUN_LENGTH_IMAGE
+    runLengths.finish();
+#  endif
+#else
+    thresholdRows(0, IMAGE_HEIGHT);
+#endif
+#ifdef USE_INTEGRAL_IMAGE
+    integrals.newFrame();
+#endif
+}
+
+/* Classify rows of the image into thresholded.  Rows above the region of
+ * interest are just set to GREY.
+ */
+void Threshold::thresholdRows(int firstRow, int numRows) {
+    const int sky = min(numRows, max(0, roi.getTopRow() - firstRow));
+    if (sky > 0) {
+        memset(&thresholded[firstRow][0], GREY, sky * IMAGE_WIDTH);
+        firstRow += sky;
+        numRows -= sky;
+        if (numRows == 0) {
+            return;
+        }
+    }
+#ifdef THRESHOLD_VECTOR_KERNEL
+    thresholdVector(&thresholded[0][0], firstRow, numRows);
+#else
+    thresholdScalar(&thresholded[0][0], firstRow, numRows);
+#endif
+}
+
+#ifdef USE_COLUMN_MAJOR_IMAGE
+/* Copy a band of freshly thresholded rows into columnMajor.  A band of
+ * THRESHOLD_BAND_ROWS rows gives every column a short contiguous stretch, so
+ * the writes stay within a cache line per column.
+ */
+void Threshold::transposeRows(int firstRow, int numRows) {
+    for (int x = 0; x < IMAGE_WIDTH; x++) {
+        unsigned char *column = &columnMajor[x][firstRow];
+        for (int r = 0; r < numRows; r++) {
+            column[r] = thresholded[firstRow + r][x];
+        }
+    }
+}
+#endif
+
+/* The reference thresholding loop.  Classifies the pixels of the image
+ * through the color table and writes the results, row by row, into tPtr.
+ * @param tPtr      IMAGE_WIDTH * IMAGE_HEIGHT bytes to write colors into
+ * @param firstRow  first row to classify
+ * @param numRows   how many rows to classify
+ */
+void Threshold::thresholdScalar(unsigned char *tPtr, int firstRow,
+                                int numRows) {
     // My loop variables
     int m;
-    unsigned char *tPtr, *tEnd, *tOff; // pointers into thresholded array
+    unsigned char *tEnd, *tOff; // pointers into thresholded array
     const unsigned char *yPtr, *uPtr, *vPtr; // pointers into image array
 
     // My loop variable initializations
-    yPtr = &yplane[0];
-    uPtr = &uplane[0];
-    vPtr = &vplane[0];
+    yPtr = &yplane[firstRow * IMAGE_ROW_OFFSET];
+    uPtr = &uplane[firstRow * IMAGE_ROW_OFFSET];
+    vPtr = &vplane[firstRow * IMAGE_ROW_OFFSET];
 
-    tPtr = &thresholded[0][0];
-    tEnd = &thresholded[IMAGE_HEIGHT-1][IMAGE_WIDTH-1] + 1;
+    tPtr += firstRow * IMAGE_WIDTH;
+    tEnd = tPtr + IMAGE_WIDTH * numRows;
 
 #if ROBOT(NAO_SIM)
-    m = (IMAGE_WIDTH * IMAGE_HEIGHT) % 8;
+    m = (IMAGE_WIDTH * numRows) % 8;
 
     // number of non-unrolled offset from beginning of row
     tOff = tPtr + m;
@@ -223,7 +352,7 @@ void Threshold::threshold() {
     }
 
 #elif ROBOT(NAO_RL)
-    m = (IMAGE_WIDTH * IMAGE_HEIGHT) % 8;
+    m = (IMAGE_WIDTH * numRows) % 8;
 
     // number of non-unrolled offset from beginning of row
     tOff = tPtr + m;
@@ -236,36 +365,354 @@ void Threshold::threshold() {
     // here is non-unrolled loop (unrolled by 2, actually)
     while (tPtr < tOff) {
         // we increment Y by 2 every time, and U and V by 4 every two times
-        *tPtr++ = bigTable[*yPtr>>YSHIFT][*uPtr>>USHIFT][*vPtr>>VSHIFT];
+        *tPtr++ = TABLE_LOOKUP(*yPtr, *uPtr, *vPtr);
         yPtr+=2;
-        *tPtr++ = bigTable[*yPtr>>YSHIFT][*uPtr>>USHIFT][*vPtr>>VSHIFT];
+        *tPtr++ = TABLE_LOOKUP(*yPtr, *uPtr, *vPtr);
         yPtr+=2; uPtr+=4; vPtr+=4;
     }
 
     // here is the unrolled loop
     while (tPtr < tEnd) {
         // Eight unrolled table lookups
-        *tPtr++ = bigTable[*yPtr>>YSHIFT][*uPtr>>USHIFT][*vPtr>>VSHIFT];
+        *tPtr++ = TABLE_LOOKUP(*yPtr, *uPtr, *vPtr);
         yPtr+=2;
-        *tPtr++ = bigTable[*yPtr>>YSHIFT][*uPtr>>USHIFT][*vPtr>>VSHIFT];
+        *tPtr++ = TABLE_LOOKUP(*yPtr, *uPtr, *vPtr);
         yPtr+=2; uPtr+=4; vPtr+=4;
-        *tPtr++ = bigTable[*yPtr>>YSHIFT][*uPtr>>USHIFT][*vPtr>>VSHIFT];
+        *tPtr++ = TABLE_LOOKUP(*yPtr, *uPtr, *vPtr);
         yPtr+=2;
-        *tPtr++ = bigTable[*yPtr>>YSHIFT][*uPtr>>USHIFT][*vPtr>>VSHIFT];
+        *tPtr++ = TABLE_LOOKUP(*yPtr, *uPtr, *vPtr);
         yPtr+=2; uPtr+=4; vPtr+=4;
-        *tPtr++ = bigTable[*yPtr>>YSHIFT][*uPtr>>USHIFT][*vPtr>>VSHIFT];
+        *tPtr++ = TABLE_LOOKUP(*yPtr, *uPtr, *vPtr);
         yPtr+=2;
-        *tPtr++ = bigTable[*yPtr>>YSHIFT][*uPtr>>USHIFT][*vPtr>>VSHIFT];
+        *tPtr++ = TABLE_LOOKUP(*yPtr, *uPtr, *vPtr);
         yPtr+=2; uPtr+=4; vPtr+=4;
-        *tPtr++ = bigTable[*yPtr>>YSHIFT][*uPtr>>USHIFT][*vPtr>>VSHIFT];
+        *tPtr++ = TABLE_LOOKUP(*yPtr, *uPtr, *vPtr);
         yPtr+=2;
-        *tPtr++ = bigTable[*yPtr>>YSHIFT][*uPtr>>USHIFT][*vPtr>>VSHIFT];
+        *tPtr++ = TABLE_LOOKUP(*yPtr, *uPtr, *vPtr);
         yPtr+=2; uPtr+=4; vPtr+=4;
     }
 
 #endif // ROBOT(...)
 }
 
+#ifdef THRESHOLD_VECTOR_KERNEL
+/* Vectorized thresholding.  Produces exactly the same output as
+ * thresholdScalar().  Each YUV422 macropixel (Y0 U Y1 V, with U and V in
+ * whichever order setYUV() decided) is split into its components in vector
+ * registers and the flat color table offsets
+ *     (y >> YSHIFT) << UV_BITS | (u >> USHIFT) << V_BITS | v >> VSHIFT
+ * are computed for many pixels at once.  Neither SSE2 nor NEON can gather
+ * from memory, so the table reads themselves are still scalar, but they
+ * no longer wait on the index arithmetic.
+ * @param tPtr      IMAGE_WIDTH * IMAGE_HEIGHT bytes to write colors into
+ * @param firstRow  first row to classify
+ * @param numRows   how many rows to classify
+ */
+void Threshold::thresholdVector(unsigned char *tPtr, int firstRow,
+                                int numRows) {
+    const unsigned char *yPtr = &yplane[firstRow * IMAGE_ROW_OFFSET];
+    tPtr += firstRow * IMAGE_WIDTH;
+    unsigned char *tEnd = tPtr + IMAGE_WIDTH * numRows;
+
+    // with the (reversed) color tables U is normally the last byte of a
+    // macropixel, but swapUV() can put it in the second
+    const bool uLast = (uplane - yplane) == 3;
+
+#if defined(__SSE2__)
+    // 16 bytes = 4 macropixels = 8 pixels per pass
+    unsigned int evens[4], odds[4];
+    const __m128i byteMask = _mm_set1_epi32(0xff);
+
+    while (tPtr < tEnd) {
+        const __m128i px =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(yPtr));
+
+        // one macropixel per 32 bit lane: split out the four bytes
+        const __m128i y0 = _mm_and_si128(px, byteMask);
+        const __m128i c1 = _mm_and_si128(_mm_srli_epi32(px, 8), byteMask);
+        const __m128i y1 = _mm_and_si128(_mm_srli_epi32(px, 16), byteMask);
+        const __m128i c3 = _mm_srli_epi32(px, 24);
+        const __m128i u = uLast ? c3 : c1;
+        const __m128i v = uLast ? c1 : c3;
+
+        const __m128i uv =
+            _mm_or_si128(_mm_slli_epi32(_mm_srli_epi32(u, USHIFT), V_BITS),
+                         _mm_srli_epi32(v, VSHIFT));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(evens),
+                         _mm_or_si128(_mm_slli_epi32(
+                                          _mm_srli_epi32(y0, YSHIFT),
+                                          UV_BITS), uv));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(odds),
+                         _mm_or_si128(_mm_slli_epi32(
+                                          _mm_srli_epi32(y1, YSHIFT),
+                                          UV_BITS), uv));
+
+        tPtr[0] = TABLE_AT(evens[0]);
+        tPtr[1] = TABLE_AT(odds[0]);
+        tPtr[2] = TABLE_AT(evens[1]);
+        tPtr[3] = TABLE_AT(odds[1]);
+        tPtr[4] = TABLE_AT(evens[2]);
+        tPtr[5] = TABLE_AT(odds[2]);
+        tPtr[6] = TABLE_AT(evens[3]);
+        tPtr[7] = TABLE_AT(odds[3]);
+        tPtr += 8;
+        yPtr += 16;
+    }
+
+#else // NEON
+    // 64 bytes = 16 macropixels = 32 pixels per pass
+    uint32_t evens[16], odds[16];
+
+    while (tPtr < tEnd) {
+        // vld4 does the de-interleaving for us: Y0s, second bytes, Y1s and
+        // last bytes each land in their own register
+        const uint8x16x4_t px = vld4q_u8(yPtr);
+        const uint8x16_t u = vshrq_n_u8(uLast ? px.val[3] : px.val[1], USHIFT);
+        const uint8x16_t v = vshrq_n_u8(uLast ? px.val[1] : px.val[3], VSHIFT);
+        const uint8x16_t y0 = vshrq_n_u8(px.val[0], YSHIFT);
+        const uint8x16_t y1 = vshrq_n_u8(px.val[2], YSHIFT);
+
+        // u/v part of the index fits in 16 bits, the y part does not
+        const uint16x8_t uvLow = vorrq_u16(vshll_n_u8(vget_low_u8(u), V_BITS),
+                                           vmovl_u8(vget_low_u8(v)));
+        const uint16x8_t uvHigh = vorrq_u16(vshll_n_u8(vget_high_u8(u), V_BITS),
+                                            vmovl_u8(vget_high_u8(v)));
+        const uint16x8_t y0Low = vmovl_u8(vget_low_u8(y0));
+        const uint16x8_t y0High = vmovl_u8(vget_high_u8(y0));
+        const uint16x8_t y1Low = vmovl_u8(vget_low_u8(y1));
+        const uint16x8_t y1High = vmovl_u8(vget_high_u8(y1));
+
+        vst1q_u32(evens, vaddw_u16(vshll_n_u16(vget_low_u16(y0Low), UV_BITS),
+                                   vget_low_u16(uvLow)));
+        vst1q_u32(evens + 4, vaddw_u16(vshll_n_u16(vget_high_u16(y0Low),
+                                                   UV_BITS),
+                                       vget_high_u16(uvLow)));
+        vst1q_u32(evens + 8, vaddw_u16(vshll_n_u16(vget_low_u16(y0High),
+                                                   UV_BITS),
+                                       vget_low_u16(uvHigh)));
+        vst1q_u32(evens + 12, vaddw_u16(vshll_n_u16(vget_high_u16(y0High),
+                                                    UV_BITS),
+                                        vget_high_u16(uvHigh)));
+        vst1q_u32(odds, vaddw_u16(vshll_n_u16(vget_low_u16(y1Low), UV_BITS),
+                                  vget_low_u16(uvLow)));
+        vst1q_u32(odds + 4, vaddw_u16(vshll_n_u16(vget_high_u16(y1Low),
+                                                  UV_BITS),
+                                      vget_high_u16(uvLow)));
+        vst1q_u32(odds + 8, vaddw_u16(vshll_n_u16(vget_low_u16(y1High),
+                                                  UV_BITS),
+                                      vget_low_u16(uvHigh)));
+        vst1q_u32(odds + 12, vaddw_u16(vshll_n_u16(vget_high_u16(y1High),
+                                                   UV_BITS),
+                                       vget_high_u16(uvHigh)));
+
+        for (int i = 0; i < 16; i++) {
+            *tPtr++ = TABLE_AT(evens[i]);
+            *tPtr++ = TABLE_AT(odds[i]);
+        }
+        yPtr += 64;
+    }
+#endif
+}
+#endif // THRESHOLD_VECTOR_KERNEL
+
+#ifdef OFFLINE
+/* Checks the thresholding kernel this build uses against the scalar
+ * reference on the whole of the current image and prints how long each one
+ * takes per pixel.  Only the kernels are run, into buffers of their own, so
+ * neither the region of interest nor the other image layouts that
+ * threshold() builds come into it.  Meant to be run from the TOOL over
+ * saved frames.
+ * @param iterations    how many times to run each kernel for the timing
+ * @return              true if both kernels classified every pixel the same
+ */
+bool Threshold::compareThresholdKernels(int iterations) {
+    static unsigned char reference[IMAGE_HEIGHT][IMAGE_WIDTH];
+    static unsigned char inUse[IMAGE_HEIGHT][IMAGE_WIDTH];
+    const float pixels = static_cast<float>(IMAGE_WIDTH * IMAGE_HEIGHT) *
+        static_cast<float>(iterations);
+
+    long long start = micro_time();
+    for (int i = 0; i < iterations; i++) {
+        thresholdScalar(&reference[0][0], 0, IMAGE_HEIGHT);
+    }
+    const long long scalarTime = micro_time() - start;
+
+    start = micro_time();
+    for (int i = 0; i < iterations; i++) {
+#ifdef THRESHOLD_VECTOR_KERNEL
+        thresholdVector(&inUse[0][0], 0, IMAGE_HEIGHT);
+#else
+        thresholdScalar(&inUse[0][0], 0, IMAGE_HEIGHT);
+#endif
+    }
+    const long long kernelTime = micro_time() - start;
+
+    const bool same = memcmp(reference, inUse, sizeof(reference)) == 0;
+    print("threshold: scalar %.3f ns/pixel, in use %.3f ns/pixel, %s",
+          static_cast<float>(scalarTime) * 1000.0f / pixels,
+          static_cast<float>(kernelTime) * 1000.0f / pixels,
+          same ? "identical" : "MISMATCH");
+    return same;
+}
+
+#ifdef USE_INTEGRAL_IMAGE
+/* Checks the integral image counts against counting the pixels one by one,
+ * for every color in the current image and boxes of all shapes, and prints
+ * how long each way takes.  Meant to be run from the TOOL over saved frames.
+ * @param boxes    how many random boxes to check per color
+ * @return         true if every count agreed
+ */
+bool Threshold::compareIntegralImage(int boxes) {
+    bool present[INTEGRAL_COLORS];
+    for (int c = 0; c < INTEGRAL_COLORS; c++) {
+        present[c] = false;
+    }
+    for (int y = 0; y < IMAGE_HEIGHT; y++) {
+        for (int x = 0; x < IMAGE_WIDTH; x++) {
+            present[thresholded[y][x]] = true;
+        }
+    }
+
+    unsigned int seed = 1;
+    int colors = 0, mismatches = 0;
+    long long integralTime = 0, pixelTime = 0;
+    for (int c = 0; c < INTEGRAL_COLORS; c++) {
+        if (!present[c]) {
+            continue;
+        }
+        colors++;
+        for (int b = 0; b < boxes; b++) {
+            // every few boxes is a single row or column, like the lines use
+            int coords[4];
+            for (int i = 0; i < 4; i++) {
+                seed = seed * 1103515245u + 12345u;
+                coords[i] = static_cast<int>((seed >> 16) % 1000);
+            }
+            int left = coords[0] % IMAGE_WIDTH, top = coords[1] % IMAGE_HEIGHT;
+            int right = left + coords[2] % (IMAGE_WIDTH - left);
+            int bottom = top + coords[3] % (IMAGE_HEIGHT - top);
+            if (b % 4 == 1) {
+                right = left;
+            } else if (b % 4 == 2) {
+                bottom = top;
+            }
+
+            long long start = micro_time();
+            const int counted = integrals.count(c, left, top, right, bottom);
+            integralTime += micro_time() - start;
+
+            start = micro_time();
+            int found = 0;
+            for (int y = top; y <= bottom; y++) {
+                for (int x = left; x <= right; x++) {
+                    if (thresholded[y][x] == c) {
+                        found++;
+                    }
+                }
+            }
+            pixelTime += micro_time() - start;
+            if (found != counted) {
+                mismatches++;
+            }
+        }
+    }
+    print("integral image: %d colors, %d boxes each, integral %lld us "
+          "(including building), pixel by pixel %lld us, %d mismatches",
+          colors, boxes, integralTime, pixelTime, mismatches);
+    return mismatches == 0;
+}
+#endif
+
+// Orders buffered runs so two scans of a frame can be merged
+static bool runBefore(const BufferedRun &a, const BufferedRun &b) {
+    if (a.target != b.target) {
+        return a.target < b.target;
+    }
+    if (a.x != b.x) {
+        return a.x < b.x;
+    }
+    if (a.y != b.y) {
+        return a.y < b.y;
+    }
+    return a.h < b.h;
+}
+
+/* Thresholds the current image and scans it for runs twice, first with the
+ * region of interest as it stands and then over the full frame, and keeps
+ * count of how long each took and how many of the full frame runs the
+ * region of interest also found.  The runs are recorded rather than handed
+ * to the object structures, which is all the region of interest changes;
+ * the frame is then put through visionLoop() once as usual, so the lines,
+ * the ball and the region of interest itself only see it once.  Meant to be
+ * run from the TOOL over logged frames with the region of interest on;
+ * printRegionOfInterestStats() reports the totals.
+ */
+void Threshold::compareRegionOfInterest() {
+    useNewTable();
+    const RegionOfInterest tracked = roi;
+    RunBuffer found[2];
+    for (int pass = 0; pass < 2; pass++) {
+        // the full frame, without disturbing what the region of interest
+        // tracks
+        if (pass == 1) {
+            roi.setEnabled(false);
+        }
+        const long long start = micro_time();
+        roi.startFrame(min(pose->getHorizonY(0),
+                           pose->getHorizonY(IMAGE_WIDTH - 1)));
+        threshold();
+        initColors();
+        horizon = field->findGreenHorizon(pose->getHorizonY(0),
+                                          pose->getHorizonSlope());
+        runColumns(0, IMAGE_WIDTH, &found[pass]);
+        if (pass == 0) {
+            roiTime += micro_time() - start;
+        } else {
+            fullTime += micro_time() - start;
+        }
+        sort(found[pass].begin(), found[pass].end(), runBefore);
+    }
+    roi = tracked;
+
+    // merge the two sorted scans
+    const RunBuffer &inRoi = found[0], &inFull = found[1];
+    size_t r = 0, f = 0;
+    while (r < inRoi.size() || f < inFull.size()) {
+        if (f == inFull.size() ||
+            (r < inRoi.size() && runBefore(inRoi[r], inFull[f]))) {
+            roiExtra[inRoi[r++].target]++;
+        } else if (r == inRoi.size() || runBefore(inFull[f], inRoi[r])) {
+            fullRuns[inFull[f++].target]++;
+        } else {
+            fullRuns[inFull[f].target]++;
+            roiRecalled[inFull[f].target]++;
+            r++;
+            f++;
+        }
+    }
+    roiFrames++;
+
+    visionLoop();
+}
+
+void Threshold::printRegionOfInterestStats() {
+    static const char *names[ROI_COMPARED] = {
+        "orange", "cross", "blue", "yellow", "red", "navy"
+    };
+    if (roiFrames == 0) {
+        return;
+    }
+    print("region of interest: %d frames, threshold and runs full %.0f "
+          "us/frame, roi %.0f us/frame",
+          roiFrames, static_cast<float>(fullTime) / roiFrames,
+          static_cast<float>(roiTime) / roiFrames);
+    for (int i = 0; i < ROI_COMPARED; i++) {
+        print("  %-6s runs recalled %d of %d, %d not in full frame",
+              names[i], roiRecalled[i], fullRuns[i], roiExtra[i]);
+    }
+}
+#endif
+
 /* Image runs.  As explained in the comments for the threshold() method, I
  * (Jeremy) have split the thresholdAndRuns() method into parts.  This also
  * helped with working out the slow sections of code.
@@ -274,16 +721,141 @@ void Threshold::threshold() {
  * We get a convex hull for the top, and look out for our own body parts for the
  * bottom.  The we scan a bit more intelligently for field objects (e.g.
  * balls will only be in the confines of the field).
+ * With USE_PARALLEL_RUNS the columns are split into stripes that are scanned
+ * on several threads (see ParallelRuns.h) with the same end result.
  */
 void Threshold::runs() {
   //detectSelf();
+#ifdef USE_PARALLEL_RUNS
+    parallelRuns.scan();
+#else
+    runColumns(0, IMAGE_WIDTH, NULL);
+#endif
+}
+
+/* Scan the columns from first up to (not including) last.
+ * @param buffer     where to record the runs, or NULL to hand them straight
+ *                   to the object structures
+ */
+void Threshold::runColumns(int first, int last, RunBuffer *buffer) {
+    // outside the region of interest columns are done in pairs, counted
+    // from the first column of each coarse stretch, so every column is
+    // scanned once whichever stripe it falls in
+    int stretchStart = first;
+    while (stretchStart > 0 && roi.isCoarse(stretchStart - 1)) {
+        stretchStart--;
+    }
+
     // split up the loops
-    for (int i = 0; i < IMAGE_WIDTH; i += 1) {
+    for (int i = first; i < last; i += 1) {
+        if (!roi.isCoarse(i)) {
+            stretchStart = i + 1;
+        } else if ((i - stretchStart) % 2 == 1) {
+            // taken care of with the column before it
+            continue;
+        }
 		int topEdge = max(0, field->horizonAt(i));
-		findBallsCrosses(i, topEdge);
-		findGoals(i, topEdge);
+        if (i + 1 < IMAGE_WIDTH && roi.isCoarse(i) && roi.isCoarse(i + 1)) {
+            runCoarseColumn(i, topEdge, buffer);
+            continue;
+        }
+		findBallsCrosses(i, topEdge, buffer);
+		findGoals(i, topEdge, buffer);
+    }
+}
+
+/* Scan one column and count its runs for the next column too.
+ * @param buffer     as in runColumns
+ */
+void Threshold::runCoarseColumn(int column, int topEdge, RunBuffer *buffer) {
+    RunBuffer *found = buffer;
+    if (found == NULL) {
+        found = &coarseRuns;
+        found->clear();
+    }
+    const size_t first = found->size();
+    findBallsCrosses(column, topEdge, found);
+    findGoals(column, topEdge, found);
+    const size_t last = found->size();
+    for (size_t i = first; i < last; i++) {
+        BufferedRun copy = (*found)[i];
+        copy.x++;
+        found->push_back(copy);
+    }
+    if (buffer == NULL) {
+        replayRuns(coarseRuns);
+    }
+}
+
+/* Tell the region of interest where the ball and the posts were this frame,
+ * which is where we will look carefully next frame.
+ */
+void Threshold::trackRegionOfInterest() {
+    roi.clearWindows();
+    const VisualBall *ball = vision->ball;
+    if (ball->getWidth() > 0) {
+        roi.addWindow(ball->getX(),
+                      ball->getX() + static_cast<int>(ball->getWidth()),
+                      ball->getY());
+    }
+    VisualFieldObject *posts[] = { vision->bglp, vision->bgrp,
+                                   vision->yglp, vision->ygrp };
+    for (int i = 0; i < 4; i++) {
+        if (posts[i]->getWidth() > 0) {
+            roi.addWindow(min(posts[i]->getLeftTopX(),
+                              posts[i]->getLeftBottomX()),
+                          max(posts[i]->getRightTopX(),
+                              posts[i]->getRightBottomX()),
+                          min(posts[i]->getLeftTopY(),
+                              posts[i]->getRightTopY()));
+        }
     }
+}
 
+/* Pass a stripe's recorded runs on to the object structures, in the order
+ * they were found.
+ */
+void Threshold::replayRuns(const RunBuffer &buffer) {
+    for (RunBuffer::const_iterator i = buffer.begin(); i != buffer.end(); ++i) {
+        addRun(static_cast<RunTarget>(i->target), i->x, i->y, i->h, NULL);
+    }
+}
+
+void Threshold::addRun(RunTarget target, int x, int y, int h,
+                       RunBuffer *buffer) {
+    if (buffer != NULL) {
+        BufferedRun run;
+        run.target = static_cast<unsigned char>(target);
+        run.x = static_cast<short>(x);
+        run.y = static_cast<short>(y);
+        run.h = static_cast<short>(h);
+        buffer->push_back(run);
+        return;
+    }
+    switch (target) {
+    case RUN_ORANGE:
+        orange->newRun(x, y, h);
+        break;
+    case RUN_CROSS:
+        cross->newRun(x, y, h);
+#ifdef USE_ROBOT_DETECTION
+        red->newWhiteRun(x, y, h);
+        navyblue->newWhiteRun(x, y, h);
+#endif
+        break;
+    case RUN_BLUE:
+        blue->newRun(x, y, h);
+        break;
+    case RUN_YELLOW:
+        yellow->newRun(x, y, h);
+        break;
+    case RUN_RED:
+        red->newRun(x, y, h);
+        break;
+    case RUN_NAVY:
+        navyblue->newRun(x, y, h);
+        break;
+    }
 }
 
 /** Ideally goals will be either right at the field edge, or will have part above
@@ -292,17 +864,70 @@ void Threshold::runs() {
  * To Do:  Figure out the right amount of noise to tolerate.
  * @param column     the current vertical scanline
  * @param topEdge    the top of the field in that scanline
+ * @param buffer     where to record the runs (see runColumns)
  */
 
-void Threshold::findGoals(int column, int topEdge) {
+void Threshold::findGoals(int column, int topEdge, RunBuffer *buffer) {
 	const int BADSIZE = 5;
 	// scan up for goals
 	int bad = 0, blues = 0, yellows = 0, blueGreen = 0;
 	int firstBlue = topEdge, firstYellow = topEdge, lastBlue = topEdge, lastYellow = topEdge;
 	topEdge = min(topEdge, lowerBound[column]);
+#ifdef USE_RUN_LENGTH_IMAGE
+	// the same two scans a run at a time; a run of bad pixels only matters
+	// in that it stops the scan, so its whole length can be counted at once
+	const ColorRun *col = runLengths.column(column);
+	int r = runLengths.runAt(column, topEdge);
+	for (int j = topEdge; bad < BADSIZE && j >= 0; r--) {
+		const int top = col[r].top;
+		const int pixels = j - top + 1;
+		switch (col[r].color) {
+		case BLUE:
+			lastBlue = top;
+			blues += pixels;
+			break;
+		case YELLOW:
+			lastYellow = top;
+			yellows += pixels;
+			break;
+		case BLUEGREEN:
+			blueGreen += pixels;
+			break;
+		default:
+			bad += pixels;
+		}
+		j = top - 1;
+	}
+	bad = 0;
+	r = runLengths.runAt(column, min(topEdge + 1, IMAGE_HEIGHT - 1));
+	for (int j = topEdge + 1; bad < BADSIZE && j < lowerBound[column]; r++) {
+		const int last = min(RunLengthImage::bottom(col + r),
+							 lowerBound[column] - 1);
+		const int pixels = last - j + 1;
+		switch (col[r].color) {
+		case BLUE:
+			firstBlue = last;
+			blues += pixels;
+			break;
+		case YELLOW:
+			firstYellow = last;
+			yellows += pixels;
+			break;
+		case BLUEGREEN:
+			blueGreen += pixels;
+			break;
+		case GREEN:
+			bad += 2 * pixels;
+			break;
+		default:
+			bad += pixels;
+		}
+		j = last + 1;
+	}
+#else
 	for (int j = topEdge; bad < BADSIZE && j >= 0; j--) {
 		// get the next pixel
-		unsigned char pixel = thresholded[j][column];
+		unsigned char pixel = getColumnColor(column, j);
 		// otherwise, do stuff according to color
 		switch (pixel) {
 		case BLUE:
@@ -324,7 +949,7 @@ void Threshold::findGoals(int column, int topEdge) {
 	bad = 0;
 	for (int j = topEdge + 1; bad < BADSIZE && j < lowerBound[column]; j++) {
 		// get the next pixel
-		unsigned char pixel = thresholded[j][column];
+		unsigned char pixel = getColumnColor(column, j);
 		// otherwise, do stuff according to color
 		switch (pixel) {
 		case BLUE:
@@ -345,10 +970,12 @@ void Threshold::findGoals(int column, int topEdge) {
 			bad++;
 		}
 	}
+#endif
 	if (blues > 10) {
-		blue->newRun(column, lastBlue, firstBlue - lastBlue);
+		addRun(RUN_BLUE, column, lastBlue, firstBlue - lastBlue, buffer);
 	} else if (yellows > 10) {
-		yellow->newRun(column, lastYellow, firstYellow - lastYellow);
+		addRun(RUN_YELLOW, column, lastYellow, firstYellow - lastYellow,
+			   buffer);
 	}
 }
 
@@ -356,27 +983,57 @@ void Threshold::findGoals(int column, int topEdge) {
  * down from the top edge to the bottom of the image (or where we would
  * see ourselves).  During the scan we collect up connected runs of
  * ORANGE or WHITE.  We pass them to the relevant Object structures to
- * be processed there.
- * To Do:  Put robot detection back in.
+ * be processed there.  With USE_ROBOT_DETECTION the runs of RED and NAVY
+ * go to the robots, which also get the WHITE ones.
  * @param column     the current vertical scanline
  * @param topEdge    the top of the field in that scanline
+ * @param buffer     where to record the runs (see runColumns)
  */
 
-void Threshold::findBallsCrosses(int column, int topEdge) {
+void Threshold::findBallsCrosses(int column, int topEdge, RunBuffer *buffer) {
 	// scan down finding balls and crosses
 	unsigned char lastPixel = GREEN;
 	int currentRun = 0;
 	int bound = lowerBound[column];
 	// if a ball is in the middle of the boundary, then look a little lower
 	if (bound < IMAGE_HEIGHT - 1) {
-		while (bound < IMAGE_HEIGHT && thresholded[bound][column] == ORANGE) {
+		while (bound < IMAGE_HEIGHT && getColumnColor(column, bound) == ORANGE) {
 			bound++;
 		}
 	}
+#ifdef USE_RUN_LENGTH_IMAGE
+	// Walk the runs from the bottom up, treating ORANGERED as ORANGE as
+	// below.  Like the pixel loop we report a stretch of color at the row
+	// where the next one starts, or at topEdge for the last one.
+	bound = min(bound, IMAGE_HEIGHT - 1);
+	if (bound < topEdge) {
+		return;
+	}
+	const ColorRun *col = runLengths.column(column);
+	int r = runLengths.runAt(column, bound);
+	lastPixel = col[r].color == ORANGERED ? ORANGE : col[r].color;
+	for (int j = bound; ; ) {
+		const int top = max(static_cast<int>(col[r].top), topEdge);
+		currentRun += j - top + 1;
+		j = top - 1;
+		if (j < topEdge) {
+			break;
+		}
+		r--;
+		const unsigned char pixel =
+			col[r].color == ORANGERED ? ORANGE : col[r].color;
+		if (pixel != lastPixel) {
+			addBallCrossRun(lastPixel, column, j, currentRun, buffer);
+			lastPixel = pixel;
+			currentRun = 0;
+		}
+	}
+	addBallCrossRun(lastPixel, column, topEdge, currentRun, buffer);
+#else
 	// scan down the column looking for ORANGE and WHITE
 	for (int j = bound; j >= topEdge; j--) {
 		// get the next pixel
-		unsigned char pixel = thresholded[j][column];
+		unsigned char pixel = getColumnColor(column, j);
 		// for simplicity treat ORANGERED as ORANGE - we'll look
 		// more carefully when we check whether or not it is a ball
 		if (pixel == ORANGERED) {
@@ -395,22 +1052,58 @@ void Threshold::findBallsCrosses(int column, int topEdge) {
 			case ORANGE:
 				// add to Ball data structure
 				if (currentRun > 2) {
-					orange->newRun(column, j, currentRun);
+					addRun(RUN_ORANGE, column, j, currentRun, buffer);
 				}
 				break;
 			case WHITE:
 				// add to the cross data structure
 				if (currentRun > 2) {
-					cross->newRun(column, j, currentRun);
+					addRun(RUN_CROSS, column, j, currentRun, buffer);
+				}
+				break;
+#ifdef USE_ROBOT_DETECTION
+			case RED:
+				if (currentRun > 2) {
+					addRun(RUN_RED, column, j, currentRun, buffer);
+				}
+				break;
+			case NAVY:
+				if (currentRun > 2) {
+					addRun(RUN_NAVY, column, j, currentRun, buffer);
 				}
 				break;
+#endif
 			}
 			// since this loop runs when a run ends, restart # pixels in run counter
 			currentRun = 1;
 		}
 		lastPixel = pixel;
 	}
+#endif
+}
+
+#ifdef USE_RUN_LENGTH_IMAGE
+/* Hand a finished stretch of color from findBallsCrosses() on to the ball,
+ * the cross or the robots, if it is long enough.
+ */
+void Threshold::addBallCrossRun(unsigned char color, int column, int y, int h,
+								RunBuffer *buffer) {
+	if (h <= 2) {
+		return;
+	}
+	if (color == ORANGE) {
+		addRun(RUN_ORANGE, column, y, h, buffer);
+	} else if (color == WHITE) {
+		addRun(RUN_CROSS, column, y, h, buffer);
+#ifdef USE_ROBOT_DETECTION
+	} else if (color == RED) {
+		addRun(RUN_RED, column, y, h, buffer);
+	} else if (color == NAVY) {
+		addRun(RUN_NAVY, column, y, h, buffer);
+#endif
+	}
 }
+#endif
 
 /** Given two lines defined by "detectSelf" set the lower bounds.  We have
  * detected a part of ourself, so we don't want to process it or we might
@@ -524,20 +1217,6 @@ int Threshold::greenEdgePoint(int x) {
 	return greenEdge[x];
 }
 
-int Threshold::getRobotTop(int x, int c) {
-	if (c == RED) {
-		return redTops[x];
-	}
-	return navyTops[x];
-}
-
-int Threshold::getRobotBottom(int x, int c) {
-	if (c == RED) {
-		return redBottoms[x];
-	}
-	return navyBottoms[x];
-}
-
 
 /*  Makes the calls to the vision system to recognize objects.  Then performs some extra
  * sanity checks to make sure we don't have weird cases like 2 beacons.
@@ -553,9 +1232,10 @@ void Threshold::objectRecognition() {
     yellow->createObject();
     blue->createObject();
 	cross->createObject();
-	/* Shut off for now
+#ifdef USE_ROBOT_DETECTION
     red->robot(horizon);
-    navyblue->robot(horizon); */
+    navyblue->robot(horizon);
+#endif
 
     bool ylp = vision->yglp->getWidth() > 0;
     bool yrp = vision->ygrp->getWidth() > 0;
@@ -1014,12 +1694,15 @@ void Threshold::initColors() {
  * @param filename      the file to load
  */
 void Threshold::initTable(std::string filename) {
+#ifndef OFFLINE
+    const long long start = micro_time();
+#endif
 
-    FILE* fp;
-    //cout << filename << endl;
-    fp = fopen(filename.c_str(), "r");   //open table for reading
-    if (fp == NULL) {
+    struct stat info;
+    ColorTableBuffer *table = startLoadingTable();
+    if (stat(filename.c_str(), &info) != 0 || !table->map(filename.c_str())) {
         print("initTable() FAILED to open filename: %s", filename.c_str());
+        installTable(NULL);
 #ifdef OFFLINE
         exit(0);
 #else
@@ -1027,32 +1710,98 @@ void Threshold::initTable(std::string filename) {
 #endif
     }
 
-    //actually read the table into memory
-    for(int i=0; i< YMAX; i++)
-        for(int j=0; j<UMAX; j++){
-            fread(bigTable[i][j], sizeof(unsigned char), VMAX, fp);
-        }
+#ifdef USE_COMPACT_TABLE
+    table->compact.build(table->getCube());
+#endif
+    installTable(table);
+    tableFile = filename;
+    tableInode = info.st_ino;
+    tableTime = info.st_mtime;
 
 #ifndef OFFLINE
-    print("Loaded colortable %s",filename.c_str());
+    print("Loaded colortable %s in %lld us (%s)", filename.c_str(),
+          micro_time() - start, table->isMapped() ? "mapped" : "read");
 #endif
+}
 
-    fclose(fp);
+/* Checks whether the table file last given to initTable() has been replaced
+ * or changed, and loads it again if it has.  Tables should be replaced by
+ * renaming a new file over the old one, see ColorTableBuffer::map().
+ * @return    whether a new table was loaded
+ */
+bool Threshold::reloadTableIfChanged() {
+    struct stat info;
+    if (tableFile.empty() || stat(tableFile.c_str(), &info) != 0 ||
+        (info.st_ino == tableInode && info.st_mtime == tableTime)) {
+        return false;
+    }
+    initTable(tableFile);
+    return true;
+}
+
+/* The buffer to load a new table into: whichever one is not in use.  A
+ * table still waiting to be used is dropped in favour of the new one.  Only
+ * one thread should be loading tables at a time.  Call installTable() with
+ * the buffer when it is ready, or with NULL if loading fails.
+ */
+ColorTableBuffer* Threshold::startLoadingTable() {
+    pthread_mutex_lock(&tableMutex);
+    ColorTableBuffer *table = activeTable == &tableBuffers[0] ?
+        &tableBuffers[1] : &tableBuffers[0];
+    pendingTable = NULL;
+    pthread_mutex_unlock(&tableMutex);
+    return table;
+}
+
+// Hand a loaded table over to be used from the start of the next frame
+void Threshold::installTable(ColorTableBuffer *table) {
+    pthread_mutex_lock(&tableMutex);
+    pendingTable = table;
+    pendingSince = micro_time();
+    pthread_mutex_unlock(&tableMutex);
+}
+
+/* Switch to a newly loaded table, if there is one.  Called by the vision
+ * thread between frames.  If a table is being installed right now we don't
+ * wait for it, it will be picked up next frame.
+ */
+void Threshold::useNewTable() {
+    if (pthread_mutex_trylock(&tableMutex) != 0) {
+        return;
+    }
+    if (pendingTable != NULL) {
+        activeTable = pendingTable;
+        pendingTable = NULL;
+        bigTable = reinterpret_cast<const unsigned char (*)[UMAX][VMAX]>(
+            activeTable->getCube());
+#ifdef USE_COMPACT_TABLE
+        compactTable = &activeTable->compact;
+#endif
+#ifndef OFFLINE
+        print("Switched color tables %lld us after loading",
+              micro_time() - pendingSince);
+#endif
+    }
+    pthread_mutex_unlock(&tableMutex);
 }
 
 
 void Threshold::initTableFromBuffer(byte * tbfr)
 {
-
+    ColorTableBuffer *table = startLoadingTable();
     byte* source = tbfr;
+    byte* dest = table->allocate();
     for(int i=0; i< YMAX; i++)
         for(int j=0; j<UMAX; j++){
-            //pointer to beginning of row:
-            byte* dest = bigTable[i][j];
             //copy over a whole row into big table from the buffer
             memcpy(dest,source,YMAX);
             source+=YMAX;//advance the source bugger
+            dest+=VMAX;
         }
+#ifdef USE_COMPACT_TABLE
+    table->compact.build(table->getCube());
+#endif
+    installTable(table);
 }
 
 /* This function loads a table file with the given file name
@@ -1098,18 +1847,13 @@ void Threshold::initCompressedTable(std::string filename){
 
     unsigned char *fileTraverse = fileData;
 
+    ColorTableBuffer *table = startLoadingTable();
+    memcpy(table->allocate(), fileTraverse, COLOR_CUBE_SIZE);
 
-    for(int i=0; i< YMAX; i++) {
-        //printf("vtoro");
-        for(int j=0; j<UMAX; j++){
-            //64 bytes per chunk
-            //fread(bigTable[i][j], sizeof(unsigned char), vMax, fp);
-            for(int k=0; k<VMAX; k++) {
-                bigTable[i][j][k] = *fileTraverse;
-                fileTraverse++;
-            }
-        }
-    }
+#ifdef USE_COMPACT_TABLE
+    table->compact.build(table->getCube());
+#endif
+    installTable(table);
 
     print("Loaded colortable %s",filename.c_str());
     free(fileData);
@@ -1118,6 +1862,45 @@ void Threshold::initCompressedTable(std::string filename){
 #endif /* NO_ZLIB */
 }
 
+/* This function loads a compact (.ctb) table, as written by
+ * vision/offline/tableConvert, straight into the compact color table.  The
+ * flat bigTable is left alone, so only builds with USE_COMPACT_TABLE can use
+ * it.
+ * @param filename      the file to load
+ */
+void Threshold::initCompactTable(std::string filename) {
+#ifdef USE_COMPACT_TABLE
+    FILE* fp = fopen(filename.c_str(), "rb");
+    if (fp == NULL) {
+        print("initCompactTable() FAILED to open filename: %s",
+              filename.c_str());
+#ifdef OFFLINE
+        exit(0);
+#else
+        return;
+#endif
+    }
+
+    ColorTableBuffer *table = startLoadingTable();
+    if (table->compact.read(fp)) {
+        // there is no flat table to go with it
+        table->release();
+        installTable(table);
+        print("Loaded compact colortable %s (%d rows, %d bytes)",
+              filename.c_str(), table->compact.getNumRows(),
+              table->compact.getByteSize());
+    } else {
+        installTable(NULL);
+        print("initCompactTable() %s is not a valid compact table",
+              filename.c_str());
+    }
+    fclose(fp);
+#else
+    print("initCompactTable() needs USE_COMPACT_TABLE, not loading %s",
+          filename.c_str());
+#endif
+}
+
 const uchar* Threshold::getYUV() {
     return yuv;
 }
@@ -1,6 +1,9 @@
 #ifndef Threshold_h_DEFINED
 #define Threshold_h_DEFINED
 
+#include <pthread.h>
+#include <sys/types.h>
+#include <time.h>
 #include <boost/shared_ptr.hpp>
 
 typedef unsigned char uchar;
@@ -19,31 +22,33 @@ class Threshold;  // forward reference
 #endif
 #include "Profiler.h"
 #include "NaoPose.h"
-//
-// COLOR TABLE CONSTANTS
-// remember to change both values when chaning the color tables
-
-//these must be changed everytime we load a new table
-#ifdef SMALL_TABLES
-#define YSHIFT  3
-#define USHIFT  2
-#define VSHIFT  2
-#define YMAX  32
-#define UMAX  64
-#define VMAX  64
-#else
-#define YSHIFT  1
-#define USHIFT  1
-#define VSHIFT  1
-#define YMAX  128
-#define UMAX  128
-#define VMAX  128
+#include "ColorTable.h"
+#include "ParallelRuns.h"
+#include "RegionOfInterest.h"
+#ifdef USE_RUN_LENGTH_IMAGE
+#include "RunLengthImage.h"
+#endif
+#ifdef USE_INTEGRAL_IMAGE
+#include "IntegralImage.h"
+#endif
+
+// The vectorized classifier needs SSE2 (x86) or NEON (ARM); on anything else,
+// e.g. the Geode, fall back to the scalar loop.
+#ifdef USE_SIMD_THRESHOLD
+#  if defined(__SSE2__) || defined(__ARM_NEON__) || defined(__ARM_NEON)
+#    define THRESHOLD_VECTOR_KERNEL
+#  else
+#    warning "USE_SIMD_THRESHOLD needs SSE2 or NEON, using scalar thresholding"
+#  endif
 #endif
 
 //
 // THRESHOLDING CONSTANTS
 // Constants pertaining to object detection and horizon detection
 static const int MIN_RUN_SIZE = 5;
+// rows classified at a time when building the run-length or column-major
+// image
+static const int THRESHOLD_BAND_ROWS = 8;
 
 /* The following two constants are used in the traversal of the image
    inside thresholdAndRuns. We start at the bottom left of the image which
@@ -73,15 +78,25 @@ class Threshold
     friend class Vision;
 public:
     Threshold(Vision* vis, boost::shared_ptr<NaoPose> posPtr);
-    virtual ~Threshold() {}
+    virtual ~Threshold() { pthread_mutex_destroy(&tableMutex); }
 
     // main methods
     void visionLoop();
     inline void threshold();
+    void thresholdRows(int firstRow, int numRows);
+#ifdef USE_COLUMN_MAJOR_IMAGE
+    void transposeRows(int firstRow, int numRows);
+#endif
+    void thresholdScalar(unsigned char *tPtr, int firstRow, int numRows);
+#ifdef THRESHOLD_VECTOR_KERNEL
+    void thresholdVector(unsigned char *tPtr, int firstRow, int numRows);
+#endif
     inline void runs();
     void thresholdAndRuns();
-	void findGoals(int column, int top);
-	void findBallsCrosses(int column, int top);
+    void runColumns(int first, int last, RunBuffer *buffer);
+    void replayRuns(const RunBuffer &buffer);
+	void findGoals(int column, int top, RunBuffer *buffer);
+	void findBallsCrosses(int column, int top, RunBuffer *buffer);
 	void detectSelf();
 	void setBoundaryPoints(int x1, int y1, int x2, int y2, int x3, int y3);
     void objectRecognition();
@@ -91,6 +106,14 @@ public:
     void initTable(std::string filename);
     void initTableFromBuffer(byte* tbfr);
     void initCompressedTable(std::string filename);
+    void initCompactTable(std::string filename);
+    // Load the table file again if it has changed since it was loaded.  Safe
+    // to call from another thread, the new table is used from the next frame
+    bool reloadTableIfChanged();
+    // check for a changed table file every this many frames, 0 for never.
+    // The reload then happens on the vision thread, which is cheap for a
+    // mapped table but not when a compact table has to be built from it.
+    void setTableWatchInterval(int frames) { tableWatchInterval = frames; }
 
     void storeFieldObjects();
     void setFieldObjectInfo(VisualFieldObject *objPtr);
@@ -106,14 +129,16 @@ public:
     void findGreenHorizon();
     point <int> findIntersection(int col, int dir, int c);
 	int greenEdgePoint(int x);
-	int getRobotTop(int x, int c);
-	int getRobotBottom(int x, int c);
     int postCheck(bool which, int left, int right);
     point <int> backStopCheck(bool which, int left, int right);
     void setYUV(const uchar* newyuv);
     const uchar* getYUV();
     static const char * getShortColor(int _id);
 
+    // process only part of most frames, see RegionOfInterest.h
+    void setRegionOfInterest(bool on) { roi.setEnabled(on); }
+    RegionOfInterest& getRegionOfInterest() { return roi; }
+
     void swapUV() { inverted = !inverted; setYUV(yuv); }
     void swapUV(bool _inverted) { inverted = _inverted; setYUV(yuv); }
 
@@ -123,6 +148,12 @@ public:
 
 #ifdef OFFLINE
     void setConstant(int c);
+    bool compareThresholdKernels(int iterations);
+#ifdef USE_INTEGRAL_IMAGE
+    bool compareIntegralImage(int boxes);
+#endif
+    void compareRegionOfInterest();
+    void printRegionOfInterestStats();
     void setHorizonDebug(bool _bool) { visualHorizonDebug = _bool; }
     bool getHorizonDebug() { return visualHorizonDebug; }
 #endif
@@ -155,6 +186,17 @@ public:
 #  error Undefined robot type
 #endif
 
+    // thresholded[y][x], for scanners that walk up or down a column.  With
+    // USE_COLUMN_MAJOR_IMAGE this reads the transposed copy, so consecutive
+    // rows are consecutive bytes.
+    inline uchar getColumnColor(int x, int y) const {
+#ifdef USE_COLUMN_MAJOR_IMAGE
+        return columnMajor[x][y];
+#else
+        return thresholded[y][x];
+#endif
+    }
+
     int getVisionHorizon() { return horizon; }
 
     inline static int ROUND(float x) {
@@ -170,6 +212,18 @@ public:
 	Cross* cross;
     // main array
     unsigned char thresholded[IMAGE_HEIGHT][IMAGE_WIDTH];
+#ifdef USE_RUN_LENGTH_IMAGE
+    // the same image, column by column as runs of color
+    RunLengthImage runLengths;
+#endif
+#ifdef USE_COLUMN_MAJOR_IMAGE
+    // the same image transposed, see getColumnColor()
+    unsigned char columnMajor[IMAGE_WIDTH][IMAGE_HEIGHT];
+#endif
+#ifdef USE_INTEGRAL_IMAGE
+    // per color pixel counts of the same image, for the percent color checks
+    IntegralImage integrals;
+#endif
 
 #ifdef OFFLINE
     //write lines, points, boxes to this array to avoid changing the real image
@@ -188,7 +242,38 @@ private:
     const uchar* yuv;
     const uchar* yplane, *uplane, *vplane;
 
-    unsigned char bigTable[YMAX][UMAX][VMAX];
+    // The table being used and the one being loaded, see ColorTable.h.
+    // pendingTable, if set, replaces activeTable at the start of the next
+    // frame; tableMutex guards both pointers.
+    ColorTableBuffer tableBuffers[2];
+    ColorTableBuffer *activeTable, *pendingTable;
+    long long pendingSince;
+    pthread_mutex_t tableMutex;
+    // the file the table came from, and its inode and time when loaded
+    std::string tableFile;
+    ino_t tableInode;
+    time_t tableTime;
+    int tableWatchInterval, framesSinceTableCheck;
+
+    // activeTable's flat cube
+    const unsigned char (*bigTable)[UMAX][VMAX];
+#ifdef USE_COMPACT_TABLE
+    // what the thresholding loops actually read, built from bigTable
+    const CompactColorTable *compactTable;
+#endif
+
+    ColorTableBuffer* startLoadingTable();
+    void installTable(ColorTableBuffer *table);
+    void useNewTable();
+
+    inline void addRun(RunTarget target, int x, int y, int h,
+                       RunBuffer *buffer);
+    void runCoarseColumn(int column, int topEdge, RunBuffer *buffer);
+    void trackRegionOfInterest();
+#ifdef USE_RUN_LENGTH_IMAGE
+    void addBallCrossRun(unsigned char color, int column, int y, int h,
+                         RunBuffer *buffer);
+#endif
 
     // open field variables
     int openField[IMAGE_WIDTH];
@@ -201,14 +286,14 @@ private:
     bool greenYellow[IMAGE_WIDTH];
     int yellowWhite[IMAGE_WIDTH];
     int blueWhite[IMAGE_WIDTH];
-    int navyTops[IMAGE_WIDTH];
-    int redTops[IMAGE_WIDTH];
-    int navyBottoms[IMAGE_WIDTH];
-    int redBottoms[IMAGE_WIDTH];
 	int greenEdge[IMAGE_WIDTH];
 
 	int lowerBound[IMAGE_WIDTH];
 
+    RegionOfInterest roi;
+    // runs of a coarse column when there is no stripe buffer to use
+    RunBuffer coarseRuns;
+
     // thresholding variables
     int horizon;
     int lastPixel;
@@ -220,6 +305,18 @@ private:
     // Visual horizon debugging
     bool visualHorizonDebug;
 	bool debugSelf;
+
+    // totals for compareRegionOfInterest(), per RunTarget
+    static const int ROI_COMPARED = RUN_NAVY + 1;
+    int roiFrames;
+    long long roiTime, fullTime;
+    int fullRuns[ROI_COMPARED], roiRecalled[ROI_COMPARED],
+        roiExtra[ROI_COMPARED];
+#endif
+
+#ifdef USE_PARALLEL_RUNS
+    // worker threads for runs(), constructed last so all else is ready
+    ParallelRuns parallelRuns;
 #endif
 };
 
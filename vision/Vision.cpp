@@ -133,6 +133,64 @@ void Vision::setImage(const byte *image) {
     thresh->setYUV(image);
 }
 
+/* Copy the results of the other Vision's last frame into ours.  The objects
+ * and the pose are copied by value; the lines are shared with the other
+ * Vision.  Its FieldLines reuses lines from a pool, and sharing them is only
+ * safe because FieldLines::takePooledLine() passes over any line that is not
+ * unique(), i.e. still held here.  A pool that reuses lines some other way
+ * has to keep that up, or these lines change under whoever reads them.
+ */
+void Vision::copyResults(const Vision &other) {
+    frameNumber = other.frameNumber;
+
+    *bgrp = *other.bgrp;
+    *bglp = *other.bglp;
+    *ygrp = *other.ygrp;
+    *yglp = *other.yglp;
+    *ygCrossbar = *other.ygCrossbar;
+    *bgCrossbar = *other.bgCrossbar;
+    *red1 = *other.red1;
+    *red2 = *other.red2;
+    *navy1 = *other.navy1;
+    *navy2 = *other.navy2;
+    *cross = *other.cross;
+    *ball = *other.ball;
+    for (int i = 0; i < NUM_OPEN_FIELD_SEGMENTS; i++) {
+        fieldOpenings[i] = other.fieldOpenings[i];
+    }
+
+    *pose = *other.pose;
+    fieldLines->copyResults(*other.fieldLines);
+}
+
+#ifdef OFFLINE
+void Vision::compareRegionOfInterest(const byte *image) {
+    thresh->setYUV(image);
+    frameNumber++;
+    if (frameNumber > 1000000) frameNumber = 0;
+
+    PROF_ENTER(profiler, P_TRANSFORM);
+    pose->transform();
+    PROF_EXIT(profiler, P_TRANSFORM);
+
+    thresh->compareRegionOfInterest();
+}
+
+void Vision::compareLineTracking(const byte *image) {
+    thresh->setYUV(image);
+    frameNumber++;
+    if (frameNumber > 1000000) frameNumber = 0;
+
+    PROF_ENTER(profiler, P_TRANSFORM);
+    pose->transform();
+    PROF_EXIT(profiler, P_TRANSFORM);
+
+    // objects are not looked for, the lines do not need them
+    thresh->thresholdAndRuns();
+    fieldLines->compareLineTracking();
+}
+#endif
+
 std::string Vision::getThreshColor(int _id) {
     switch (_id) {
     case WHITE: return "WHITE";
@@ -557,8 +615,8 @@ void Vision::drawFieldLines() {
         }
     }
 
-    const list <linePoint>* unusedPoints = fieldLines->getUnusedPoints();
-    for (list <linePoint>::const_iterator i = unusedPoints->begin();
+    const LinePointList* unusedPoints = fieldLines->getUnusedPoints();
+    for (LinePointList::const_iterator i = unusedPoints->begin();
          i != unusedPoints->end(); i++) {
         // Unused vertical = PINK
         if (i->foundWithScan == VERTICAL) {
@@ -78,6 +78,18 @@ public:
     virtual void notifyImage();
     // set the current image pointer to the given pointer
     virtual void setImage(const byte* image);
+    // take the objects, lines, corners and pose found by another Vision for
+    // its last frame, so that they can be read while it works on the next
+    void copyResults(const Vision &other);
+#ifdef OFFLINE
+    // as notifyImage(image), but first scans the image for runs with the
+    // region of interest and over the full frame and compares the two (see
+    // Threshold::compareRegionOfInterest)
+    void compareRegionOfInterest(const byte *image);
+    // as notifyImage(image) up to the line loop, which is run both with and
+    // without line tracking (see FieldLines::compareLineTracking)
+    void compareLineTracking(const byte *image);
+#endif
 
     // visualization methods
     virtual void drawBoxes(void);
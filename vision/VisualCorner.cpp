@@ -36,6 +36,54 @@ VisualCorner::VisualCorner(const int _x, const int _y,
 
 VisualCorner::~VisualCorner() {}
 
+/**
+ * Make this corner over as the constructor would, keeping the memory it
+ * already has.  FieldLines reuses its corners from frame to frame.
+ */
+void VisualCorner::reset(const int _x, const int _y,
+                         const float _distance, const float _bearing,
+                         const shared_ptr<VisualLine> &l1,
+                         const shared_ptr<VisualLine> &l2,
+                         const float _t1, const float _t2)
+{
+    setX(_x);
+    setY(_y);
+    setDistance(_distance);
+    setBearing(_bearing);
+    setID(CORNER_NO_IDEA_ID);
+    setIDCertainty(NOT_SURE);
+    setDistanceCertainty(BOTH_UNSURE);
+    setConcreteLandmark(0);
+
+    possibleCorners.splice(possibleCorners.end(), spareCorners);
+    possibleCorners.assign(ConcreteCorner::concreteCorners().begin(),
+                           ConcreteCorner::concreteCorners().end());
+    cornerType = UNKNOWN;
+    line1 = l1;
+    line2 = l2;
+    lines.clear();
+    lines.push_back(line1);
+    lines.push_back(line2);
+    t1 = _t1;
+    t2 = _t2;
+    tBar = line1;
+    tStem = line2;
+    angleBetweenLines = 0;
+    determineCornerShape();
+
+    setDistanceSD(cornerDistanceToSD(_distance));
+    setBearingSD(cornerBearingToSD(_bearing));
+}
+
+void VisualCorner::releaseLines()
+{
+    line1.reset();
+    line2.reset();
+    lines.clear();
+    tBar.reset();
+    tStem.reset();
+}
+
 VisualCorner::VisualCorner(const VisualCorner& other)
     : VisualDetection(other), VisualLandmark<cornerID>(other),
       possibleCorners(other.possibleCorners),
@@ -375,29 +423,29 @@ const bool VisualCorner::hasPositiveID()
 void VisualCorner::setPossibleCorners(
 	std::list <const ConcreteCorner *> _possibleCorners)
 {
-	list<const ConcreteCorner*> updated(0);
-
-	for (list<const ConcreteCorner*>::const_iterator
+	// Corners that are narrowed out go to spareCorners for reset() to reuse
+	for (list<const ConcreteCorner*>::iterator
 			 currCorner = possibleCorners.begin();
-		 currCorner != possibleCorners.end(); currCorner++) {
-
-		for ( list<const ConcreteCorner*>::iterator
-				  newCorner = _possibleCorners.begin();
-			  newCorner != _possibleCorners.end() ; ) {
-
-			// If the line is in both sets, then it's still a
-			// possible corner
-			if (**newCorner == **currCorner) {
-				updated.push_back(*newCorner);
-				newCorner = _possibleCorners.erase(newCorner);
-			} else {
-				// Increment the iterator if we don't erase a corner
-				newCorner++;
-			}
+		 currCorner != possibleCorners.end(); ) {
+
+		list<const ConcreteCorner*>::iterator newCorner =
+			_possibleCorners.begin();
+		while (newCorner != _possibleCorners.end() &&
+			   !(**newCorner == **currCorner)) {
+			newCorner++;
 		}
-	}
 
-	possibleCorners = updated;
+		// If the corner is in both sets, then it's still a
+		// possible corner
+		if (newCorner != _possibleCorners.end()) {
+			*currCorner = *newCorner;
+			_possibleCorners.erase(newCorner);
+			currCorner++;
+		} else {
+			list<const ConcreteCorner*>::iterator gone = currCorner++;
+			spareCorners.splice(spareCorners.end(), possibleCorners, gone);
+		}
+	}
 }
 
 /**
@@ -408,24 +456,25 @@ void VisualCorner::setPossibleCorners(
 void VisualCorner::
 setPossibleCorners( vector <const ConcreteCorner*> _possibleCorners)
 {
-
-	list<const ConcreteCorner*> updated(0);
-
-	for (list<const ConcreteCorner*>::const_iterator
+	for (list<const ConcreteCorner*>::iterator
 			 currCorner = possibleCorners.begin();
-		 currCorner != possibleCorners.end(); currCorner++) {
-
-		for ( vector<const ConcreteCorner*>::iterator
-				  newCorner = _possibleCorners.begin();
-			  newCorner != _possibleCorners.end() ; newCorner++) {
+		 currCorner != possibleCorners.end(); ) {
+
+		// If the corner is in both sets, then it's still a
+		// possible corner
+		vector<const ConcreteCorner*>::const_iterator newCorner =
+			_possibleCorners.begin();
+		while (newCorner != _possibleCorners.end() &&
+			   !(**newCorner == **currCorner)) {
+			newCorner++;
+		}
 
-			// If the line is in both sets, then it's still a
-			// possible corner
-			if (**newCorner == **currCorner) {
-				updated.push_back(*newCorner);
-			}
+		if (newCorner != _possibleCorners.end()) {
+			*currCorner = *newCorner;
+			currCorner++;
+		} else {
+			list<const ConcreteCorner*>::iterator gone = currCorner++;
+			spareCorners.splice(spareCorners.end(), possibleCorners, gone);
 		}
 	}
-
-	possibleCorners = updated;
 }
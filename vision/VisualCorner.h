@@ -34,6 +34,12 @@ public:
     virtual ~VisualCorner();
     // copy constructor
     VisualCorner(const VisualCorner&);
+    // Take new values as if newly constructed
+    void reset(const int _x, const int _y, const float _distance,
+               const float _bearing,
+               const boost::shared_ptr<VisualLine> &l1,
+               const boost::shared_ptr<VisualLine> &l2, const float _t1,
+               const float _t2);
 
     friend std::ostream& operator<< (std::ostream &o, const VisualCorner &c)
         {
@@ -86,6 +92,8 @@ public:
     void setDistanceWithSD(float _distance);
     void setBearingWithSD(float _bearing);
     void setID(cornerID _id) { id = _id; }
+    // Drop the references to our lines, for a corner that is put aside
+    void releaseLines();
 
 
 private: // private methods
@@ -109,6 +117,8 @@ private:
     // This list will hold all the possibilities for this corner's specific ID
     // It will get set from within FieldLines.cc.
     std::list <const ConcreteCorner *> possibleCorners;
+    // Nodes narrowed out of possibleCorners, kept for reset()
+    std::list <const ConcreteCorner *> spareCorners;
     shape cornerType;
 
 	boost::shared_ptr<VisualLine> line1;
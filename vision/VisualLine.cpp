@@ -106,6 +106,23 @@ void VisualLine::addPoints(const vector <linePoint> &additionalPoints)
     init();
 }
 
+/**
+ * Make the line over from its points, as a new line made from them would
+ * be.  FieldLines keeps its lines from frame to frame and refills them.
+ */
+void VisualLine::reset()
+{
+    setID(UNKNOWN_LINE);
+    setIDCertainty(NOT_SURE);
+    setDistanceCertainty(BOTH_UNSURE);
+    setConcreteLandmark(0);
+    ccLine = false;
+
+    possibleLines.splice(possibleLines.end(), spareLines);
+    possibleLines.assign(ConcreteLine::concreteLines().begin(),
+                         ConcreteLine::concreteLines().end());
+    init();
+}
 
 void VisualLine::init()
 {
@@ -370,27 +387,7 @@ void VisualLine::setBearingWithSD(float _bearing)
 void VisualLine::
 setPossibleLines( list <const ConcreteLine*> _possibleLines)
 {
-	list<const ConcreteLine*> updated(0);
-
-	for (list<const ConcreteLine*>::iterator
-			 currLine = possibleLines.begin();
-		 currLine != possibleLines.end(); currLine++) {
-
-		for ( list<const ConcreteLine*>::iterator
-				  newLine = _possibleLines.begin();
-			  newLine != _possibleLines.end(); ) {
-
-			// If the line is in both sets
-			if (**newLine == **currLine) {
-				updated.push_back(*newLine);
-				newLine = _possibleLines.erase(newLine);
-			} else {
-				// Increment the iterator if we don't erase a line
-				newLine++;
-			}
-		}
-	}
-	possibleLines = updated;
+	narrowPossibleLines(_possibleLines);
 }
 
 /**
@@ -401,27 +398,52 @@ setPossibleLines( list <const ConcreteLine*> _possibleLines)
 void VisualLine::
 setPossibleLines( vector <const ConcreteLine*> _possibleLines)
 {
-	list<const ConcreteLine*> updated(0);
+	narrowPossibleLines(_possibleLines);
+}
 
+/**
+ * The line is known to be _possible.  As in narrowPossibleLines(), the
+ * other nodes are kept in spareLines.
+ */
+void VisualLine::setPossibleLines(const ConcreteLine* _possible)
+{
+	spareLines.splice(spareLines.end(), possibleLines);
+	if (spareLines.empty()) {
+		possibleLines.push_back(_possible);
+	} else {
+		possibleLines.splice(possibleLines.end(), spareLines,
+							 spareLines.begin());
+		possibleLines.front() = _possible;
+	}
+}
+
+/**
+ * Keep only those possible lines which are also in possibles.  Lines that
+ * go are moved to spareLines rather than freed, so that reset() can put
+ * them back without going to the heap.
+ */
+template <class Possibles>
+void VisualLine::narrowPossibleLines(Possibles &possibles)
+{
 	for (list<const ConcreteLine*>::iterator
 			 currLine = possibleLines.begin();
-		 currLine != possibleLines.end(); currLine++) {
-
-		for ( vector<const ConcreteLine*>::iterator
-				  newLine = _possibleLines.begin();
-			  newLine != _possibleLines.end(); ) {
-
-			// If the line is in both sets
-			if (**newLine == **currLine) {
-				updated.push_back(*newLine);
-				newLine = _possibleLines.erase(newLine);
-			} else {
-				// Increment the iterator if we don't erase a line
-				newLine++;
-			}
+		 currLine != possibleLines.end(); ) {
+
+		typename Possibles::iterator newLine = possibles.begin();
+		while (newLine != possibles.end() && !(**newLine == **currLine)) {
+			newLine++;
+		}
+
+		// If the line is in both sets
+		if (newLine != possibles.end()) {
+			*currLine = *newLine;
+			possibles.erase(newLine);
+			currLine++;
+		} else {
+			list<const ConcreteLine*>::iterator gone = currLine++;
+			spareLines.splice(spareLines.end(), possibleLines, gone);
 		}
 	}
-	possibleLines = updated;
 }
 
 const bool VisualLine::hasPositiveID()
@@ -96,6 +96,8 @@ public:
     void setColorString(const std::string s) { colorStr = s; }
     void addPoints(const std::list <linePoint> &additionalPoints);
     void addPoints(const std::vector <linePoint> &additionalPoints);
+    // Start over from whatever is in points now
+    void reset();
 
     static const linePoint DUMMY_LINEPOINT;
     const float getSlope() const;
@@ -136,6 +138,7 @@ public:
 private: // Member functions
     void init();
     void calculateWidths();
+    template <class Possibles> void narrowPossibleLines(Possibles &possibles);
 
 	inline const float getLength();
 	inline const float getAngle();
@@ -184,6 +187,8 @@ private: // Private member variables
     float bearingSD;
     bool ccLine;
     std::list <const ConcreteLine*> possibleLines;
+    // Nodes narrowed out of possibleLines, kept for when the line is reset
+    std::list <const ConcreteLine*> spareLines;
 
 public:
     // Getters
@@ -208,9 +213,6 @@ public:
     void setCCLine(bool _ccLine) { ccLine = _ccLine; }
     void setPossibleLines(std::list <const ConcreteLine*> _possibles);
     void setPossibleLines(std::vector <const ConcreteLine*> _possibles);
-    void setPossibleLines(const ConcreteLine* _possible) {
-		possibleLines.clear();
-		possibleLines.push_back(_possible);
-	}
+    void setPossibleLines(const ConcreteLine* _possible);
 };
 #endif
@@ -37,6 +37,18 @@ OPTION(
   "Turn on/off automatic profiling summary printing"
   ON
   )
+OPTION(
+  USE_ALLOCATION_PROFILING
+  "Turn on/off counting heap allocations in profiled components"
+  OFF
+  )
+
+# Build offline/frameReplay, which times vision on saved frames
+OPTION(
+  BUILD_FRAME_REPLAY
+  "Build the frameReplay benchmark for saved frames"
+  OFF
+  )
 
 # Options pertaining to running the vision code OFFLINE
 OPTION( OFFLINE
@@ -50,3 +62,43 @@ OPTION( SMALL_TABLES
     OFF
     )
 
+# Threshold through the compact (row deduplicated) color table
+OPTION( USE_COMPACT_TABLE
+  "Turn on/off the compact color table representation"
+    OFF
+    )
+
+# Use the SSE2/NEON color table classifier in Threshold::threshold()
+OPTION( USE_SIMD_THRESHOLD
+  "Turn on/off the vectorized thresholding kernel"
+    OFF
+    )
+
+# Scan the image columns for runs on several threads
+OPTION( USE_PARALLEL_RUNS
+  "Turn on/off the multithreaded scan in Threshold::runs()"
+    OFF
+    )
+
+# Keep a column-major run-length copy of the thresholded image
+OPTION( USE_RUN_LENGTH_IMAGE
+  "Turn on/off the run-length image used by the vertical scanners"
+    OFF
+    )
+
+# Keep per color summed-area tables of the thresholded image
+OPTION( USE_INTEGRAL_IMAGE
+  "Turn on/off the integral images used by the percent color checks"
+    OFF
+    )
+
+# Keep a transposed (column-major) copy of the thresholded image
+OPTION( USE_COLUMN_MAJOR_IMAGE
+  "Turn on/off the column-major thresholded image for vertical scans"
+    OFF
+    )
+# Find robots from the RED, NAVY and WHITE runs of the main scan
+OPTION( USE_ROBOT_DETECTION
+  "Turn on/off robot recognition in Threshold::objectRecognition()"
+    OFF
+    )
@@ -0,0 +1,278 @@
+/**
+ * blobBench: stress test for Blobs::blobIt() on noisy, fragmented images.
+ * Runs the same runs through Blobs and through the old version of blobIt()
+ * that checked every blob, compares the blobs they make and times both.  See
+ * the README in this directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Common.h"
+#include "VisionDef.h"
+#include "Blobs.h"
+
+using namespace std;
+
+static const int TIMING_ITERATIONS = 20;
+// as many blobs as Ball keeps
+static const int BENCH_BLOBS = 400;
+// as Threshold::findBallsCrosses(), only runs longer than this count
+static const int MIN_RUN = 3;
+
+struct Run {
+    int x, y, h;
+};
+
+static unsigned char image[IMAGE_HEIGHT][IMAGE_WIDTH];
+static Run runs[IMAGE_WIDTH * IMAGE_HEIGHT / MIN_RUN];
+static int numRuns;
+
+static unsigned int seed = 1;
+static int nextRandom(int n)
+{
+    seed = seed * 1103515245u + 12345u;
+    return (seed >> 16) % n;
+}
+
+#if defined(__i386__) || defined(__x86_64__)
+static const char *TIME_UNIT = "cycles";
+static inline unsigned long long readTime()
+{
+    unsigned int low, high;
+    __asm__ __volatile__("rdtsc" : "=a" (low), "=d" (high));
+    return (static_cast<unsigned long long>(high) << 32) | low;
+}
+#else
+static const char *TIME_UNIT = "us";
+static inline unsigned long long readTime()
+{
+    return static_cast<unsigned long long>(micro_time());
+}
+#endif
+
+/* A green field with a scattering of orange discs, then noise: each pixel is
+ * flipped between green and orange with probability noise/100, and small
+ * clumps of orange are sprinkled about so the runs are badly fragmented.
+ * With dots set, short runs are added every few columns and rows as well,
+ * far enough apart that each is its own blob: far more blobs than fit.
+ */
+static void makeImage(int noise, int clumps, bool dots)
+{
+    for (int y = 0; y < IMAGE_HEIGHT; y++) {
+        for (int x = 0; x < IMAGE_WIDTH; x++) {
+            image[y][x] = GREEN;
+        }
+    }
+    for (int d = nextRandom(6); d > 0; d--) {
+        const int cx = nextRandom(IMAGE_WIDTH), cy = nextRandom(IMAGE_HEIGHT);
+        const int r = 3 + nextRandom(30);
+        for (int y = cy - r; y <= cy + r; y++) {
+            for (int x = cx - r; x <= cx + r; x++) {
+                if (x >= 0 && y >= 0 && x < IMAGE_WIDTH && y < IMAGE_HEIGHT &&
+                    (x - cx) * (x - cx) + (y - cy) * (y - cy) <= r * r) {
+                    image[y][x] = ORANGE;
+                }
+            }
+        }
+    }
+    for (int y = 0; y < IMAGE_HEIGHT; y++) {
+        for (int x = 0; x < IMAGE_WIDTH; x++) {
+            if (nextRandom(100) < noise) {
+                image[y][x] = image[y][x] == ORANGE ? GREEN : ORANGE;
+            }
+        }
+    }
+    for (int c = clumps; c > 0; c--) {
+        const int x = nextRandom(IMAGE_WIDTH - 3);
+        const int y = nextRandom(IMAGE_HEIGHT - 8);
+        const int h = MIN_RUN + 1 + nextRandom(5);
+        for (int i = 0; i < h; i++) {
+            image[y + i][x] = image[y + i][x + 2] = ORANGE;
+        }
+    }
+    if (dots) {
+        for (int x = 0; x < IMAGE_WIDTH; x += 5) {
+            for (int y = 0; y + MIN_RUN + 1 < IMAGE_HEIGHT; y += 9) {
+                for (int i = 0; i <= MIN_RUN; i++) {
+                    image[y + i][x] = ORANGE;
+                }
+            }
+        }
+    }
+}
+
+// Orange runs of each column, top down, in column order
+static void findRuns()
+{
+    numRuns = 0;
+    for (int x = 0; x < IMAGE_WIDTH; x++) {
+        for (int y = 0; y < IMAGE_HEIGHT; ) {
+            int h = 0;
+            while (y + h < IMAGE_HEIGHT && image[y + h][x] == ORANGE) {
+                h++;
+            }
+            if (h > MIN_RUN) {
+                runs[numRuns].x = x;
+                runs[numRuns].y = y;
+                runs[numRuns].h = h;
+                numRuns++;
+            }
+            y += h > 0 ? h : 1;
+        }
+    }
+}
+
+/* The blobIt() we had before, which checked every blob for every run and
+ * started over with no blobs at all when it ran out of room.  Kept out of
+ * line so that it is called the same way as Blobs::blobIt().
+ */
+class LinearBlobs
+{
+public:
+    void init()
+    {
+        for (int i = 0; i < BENCH_BLOBS; i++) {
+            blobs[i].init();
+        }
+        numBlobs = 0;
+    }
+    int number() const { return numBlobs; }
+    Blob& get(int i) { return blobs[i]; }
+
+    __attribute__((noinline)) void blobIt(int x, int y, int h)
+    {
+        const int contig = 4;
+        if (numBlobs >= BENCH_BLOBS) {
+            numBlobs = 0;
+            overflows++;
+            return;
+        }
+        for (int i = 0; i < numBlobs; i++) {
+            Blob &b = blobs[i];
+            if ((x > b.getLeftTopX() && x < b.getRightTopX() + contig) &&
+                ((y >= b.getLeftTopY() - contig &&
+                  y < b.getLeftBottomY() + contig) ||
+                 (y < b.getLeftTopY() && y + h + contig > b.getLeftTopY()))) {
+                if (x > b.getRightTopX()) {
+                    b.setRightTopX(x);
+                    b.setRightBottomX(x);
+                }
+                if (b.getLeftTopY() > y) {
+                    b.setLeftTopY(y);
+                    b.setRightTopY(y);
+                }
+                if (y + h > b.getLeftBottomY()) {
+                    b.setLeftBottomY(y + h);
+                    b.setRightBottomY(y + h);
+                }
+                b.setArea((b.getRightTopX() - b.getLeftTopX() + 1) *
+                          (b.getLeftBottomY() - b.getLeftTopY() + 1));
+                b.setPixels(b.getPixels() + h);
+                return;
+            }
+        }
+        Blob &b = blobs[numBlobs++];
+        b.setLeftTopX(x);
+        b.setLeftTopY(y);
+        b.setRightTopX(x);
+        b.setRightTopY(y);
+        b.setLeftBottomX(x);
+        b.setLeftBottomY(y + h);
+        b.setRightBottomX(x);
+        b.setRightBottomY(y + h);
+        b.setPixels(h);
+        b.setArea(h);
+    }
+
+    int overflows;
+
+private:
+    Blob blobs[BENCH_BLOBS];
+    int numBlobs;
+};
+
+static LinearBlobs linear;
+static Blobs swept(BENCH_BLOBS);
+
+static bool sameBlobs()
+{
+    if (linear.number() != swept.number()) {
+        return false;
+    }
+    for (int i = 0; i < swept.number(); i++) {
+        Blob a = linear.get(i), b = swept.get(i);
+        if (a.getLeft() != b.getLeft() || a.getRight() != b.getRight() ||
+            a.getTop() != b.getTop() || a.getBottom() != b.getBottom() ||
+            a.getPixels() != b.getPixels()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    const int frames = argc > 1 ? atoi(argv[1]) : 100;
+    // percent of pixels flipped, clumps added, and whether to add dots
+    static const int levels[][3] = {
+        { 0, 0, 0 }, { 2, 100, 0 }, { 5, 300, 0 }, { 10, 600, 0 },
+        { 20, 1200, 0 }, { 35, 2000, 0 }, { 0, 0, 1 }, { 2, 100, 1 }
+    };
+    static const int NUM_LEVELS = sizeof(levels) / sizeof(levels[0]);
+
+    int mismatches = 0;
+    printf("%d frames per noise level, %s per frame\n", frames, TIME_UNIT);
+    printf("%6s %7s %5s %7s %7s %8s %10s %10s %9s %9s\n", "flip", "clumps",
+           "dots", "runs", "blobs", "dropped", "linear", "sweep", "lin-full",
+           "mismatch");
+    for (int n = 0; n < NUM_LEVELS; n++) {
+        unsigned long long linearTime = 0, sweptTime = 0;
+        long totalRuns = 0, totalBlobs = 0, dropped = 0;
+        int overflowFrames = 0, levelMismatches = 0;
+        for (int f = 0; f < frames; f++) {
+            makeImage(levels[n][0], levels[n][1], levels[n][2] != 0);
+            findRuns();
+            totalRuns += numRuns;
+
+            unsigned long long start = readTime();
+            for (int t = 0; t < TIMING_ITERATIONS; t++) {
+                linear.init();
+                linear.overflows = 0;
+                for (int r = 0; r < numRuns; r++) {
+                    linear.blobIt(runs[r].x, runs[r].y, runs[r].h);
+                }
+            }
+            linearTime += readTime() - start;
+
+            start = readTime();
+            for (int t = 0; t < TIMING_ITERATIONS; t++) {
+                swept.init();
+                for (int r = 0; r < numRuns; r++) {
+                    swept.blobIt(runs[r].x, runs[r].y, runs[r].h);
+                }
+            }
+            sweptTime += readTime() - start;
+
+            totalBlobs += swept.number();
+            dropped += swept.dropped();
+            // the old code threw everything away when it ran out of room,
+            // so there is nothing to compare against on those frames
+            if (linear.overflows > 0) {
+                overflowFrames++;
+            } else if (!sameBlobs()) {
+                levelMismatches++;
+            }
+        }
+        const unsigned long long runsTimed =
+            static_cast<unsigned long long>(frames) * TIMING_ITERATIONS;
+        printf("%5d%% %7d %5s %7ld %7ld %8ld %10llu %10llu %9d %9d\n",
+               levels[n][0], levels[n][1], levels[n][2] ? "yes" : "no",
+               totalRuns / frames,
+               totalBlobs / frames,
+               dropped / frames, linearTime / runsTimed, sweptTime / runsTimed,
+               overflowFrames, levelMismatches);
+        mismatches += levelMismatches;
+    }
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,514 @@
+/**
+ * frameReplay: runs the whole vision pipeline over saved frames, the way Man
+ * runs it on the robot, and reports how long each part of it took.  See the
+ * README in this directory.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE     // for sched_setaffinity()
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sched.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include "visionconfig.h"
+#include "Common.h"
+#include "VisionDef.h"
+#include "SensorDef.h"
+#include "NaoDef.h"
+#include "Sensors.h"
+#include "NaoPose.h"
+#include "Profiler.h"
+#include "Vision.h"
+
+using namespace std;
+using boost::shared_ptr;
+
+// the parts of the pipeline reported, whole frames first
+static const ProfiledComponent STAGES[] = {
+    P_VISION, P_TRANSFORM, P_THRESHRUNS, P_THRESHOLD, P_FGHORIZON, P_RUNS,
+    P_OBJECT, P_LINES
+};
+static const int NUM_STAGES = sizeof(STAGES) / sizeof(STAGES[0]);
+
+// the frame format Sensors::saveFrame() writes
+static const int FRAME_VERSION = 0;
+
+// the checks that can be run on each frame, and what failing them means
+enum Check { CHECK_ESTIMATES, CHECK_KERNELS, CHECK_INTEGRALS, NUM_CHECKS };
+static const char *CHECK_FAILURES[NUM_CHECKS] = {
+    "had pixel estimates off the exact transform",
+    "were thresholded differently by the scalar kernel",
+    "had integral image counts off the pixel by pixel ones"
+};
+// how many times the kernels are timed, and how many boxes of each color
+// are counted, per frame
+static const int KERNEL_ITERATIONS = 10;
+static const int INTEGRAL_BOXES = 100;
+
+struct Frame {
+    string name;
+    vector<unsigned char> image;
+    vector<float> joints;
+    vector<float> sensors;
+};
+
+struct StageStats {
+    double mean;
+    long long p50, p99, max;
+};
+
+static long long timeNow()
+{
+    return micro_time();
+}
+
+/* Read a frame as saved by Sensors::saveFrame(): the raw image, then the
+ * format version, the joint angles and the sensor values as text.  Frames
+ * saved without the angles are still read, with the head level.
+ */
+static bool readFrame(const string &filename, Frame &frame)
+{
+    FILE *fp = fopen(filename.c_str(), "rb");
+    if (fp == NULL) {
+        return false;
+    }
+    frame.name = filename;
+    frame.image.resize(IMAGE_BYTE_SIZE);
+    if (fread(&frame.image[0], 1, IMAGE_BYTE_SIZE, fp) != IMAGE_BYTE_SIZE) {
+        fclose(fp);
+        return false;
+    }
+
+    frame.joints.assign(NUM_ACTUATORS, 0.0f);
+    frame.sensors.clear();
+    int version;
+    if (fscanf(fp, "%d", &version) == 1) {
+        if (version != FRAME_VERSION) {
+            printf("%s: frame version %d, expected %d\n", filename.c_str(),
+                   version, FRAME_VERSION);
+        }
+        for (int i = 0; i < NUM_ACTUATORS; i++) {
+            if (fscanf(fp, "%f", &frame.joints[i]) != 1) {
+                break;
+            }
+        }
+        float value;
+        while (static_cast<int>(frame.sensors.size()) < NUM_SENSORS &&
+               fscanf(fp, "%f", &value) == 1) {
+            frame.sensors.push_back(value);
+        }
+    }
+    fclose(fp);
+    return true;
+}
+
+/* Frames are given as files, or as directories of frames numbered from 0 as
+ * Sensors::saveFrame() names them.
+ */
+static bool readFrames(const char *path, vector<Frame> &frames)
+{
+    struct stat info;
+    if (stat(path, &info) != 0) {
+        printf("Could not find %s\n", path);
+        return false;
+    }
+    if (!S_ISDIR(info.st_mode)) {
+        frames.push_back(Frame());
+        if (!readFrame(path, frames.back())) {
+            printf("Could not read frame %s\n", path);
+            return false;
+        }
+        return true;
+    }
+    for (int n = 0; ; n++) {
+        char name[1024];
+        snprintf(name, sizeof(name), "%s/%d.NBFRM", path, n);
+        Frame frame;
+        if (!readFrame(name, frame)) {
+            if (n == 0) {
+                printf("No frames in %s\n", path);
+                return false;
+            }
+            return true;
+        }
+        frames.push_back(frame);
+    }
+}
+
+// FNV-1a, over whatever vision found in a frame
+static void hashInt(unsigned long &hash, int value)
+{
+    for (int i = 0; i < 4; i++) {
+        hash ^= (value >> (8 * i)) & 0xff;
+        hash *= 16777619ul;
+    }
+    hash &= 0xfffffffful;
+}
+
+static void hashDetection(unsigned long &hash, const VisualDetection *d)
+{
+    hashInt(hash, d->getX());
+    hashInt(hash, d->getY());
+    hashInt(hash, static_cast<int>(d->getWidth()));
+    hashInt(hash, static_cast<int>(d->getHeight()));
+}
+
+/* A summary of the objects, lines and corners found in the last frame, so
+ * that two builds can be checked to see the same things.
+ */
+static unsigned long hashResults(const Vision &vision)
+{
+    unsigned long hash = 2166136261ul;
+    const VisualDetection *objects[] = {
+        vision.ball, vision.bglp, vision.bgrp, vision.yglp, vision.ygrp,
+        vision.cross
+    };
+    for (unsigned int i = 0; i < sizeof(objects) / sizeof(objects[0]); i++) {
+        hashDetection(hash, objects[i]);
+    }
+    const vector<shared_ptr<VisualLine> > *lines =
+        vision.fieldLines->getLines();
+    hashInt(hash, static_cast<int>(lines->size()));
+    for (vector<shared_ptr<VisualLine> >::const_iterator i = lines->begin();
+         i != lines->end(); ++i) {
+        hashInt(hash, (*i)->start.x);
+        hashInt(hash, (*i)->start.y);
+        hashInt(hash, (*i)->end.x);
+        hashInt(hash, (*i)->end.y);
+    }
+    const list<VisualCorner> *corners = vision.fieldLines->getCorners();
+    hashInt(hash, static_cast<int>(corners->size()));
+    for (list<VisualCorner>::const_iterator i = corners->begin();
+         i != corners->end(); ++i) {
+        hashInt(hash, i->getX());
+        hashInt(hash, i->getY());
+        hashInt(hash, static_cast<int>(i->getShape()));
+    }
+    return hash;
+}
+
+// times must be sorted; the nearest rank percentile
+static long long percentile(const vector<long long> &times, int p)
+{
+    const int rank = static_cast<int>(ceil(p / 100.0 * times.size()));
+    return times[max(rank - 1, 0)];
+}
+
+static StageStats summarize(vector<long long> &times)
+{
+    StageStats stats;
+    sort(times.begin(), times.end());
+    long long sum = 0;
+    for (unsigned int i = 0; i < times.size(); i++) {
+        sum += times[i];
+    }
+    stats.mean = static_cast<double>(sum) / times.size();
+    stats.p50 = percentile(times, 50);
+    stats.p99 = percentile(times, 99);
+    stats.max = times.back();
+    return stats;
+}
+
+/* Read the statistics another build wrote with -o.
+ * @return    whether the file could be read
+ */
+static bool readBaseline(const char *filename,
+                         map<string, StageStats> &stages,
+                         vector<unsigned long> &hashes)
+{
+    FILE *fp = fopen(filename, "r");
+    if (fp == NULL) {
+        return false;
+    }
+    char line[256], name[64];
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        StageStats stats;
+        unsigned long hash;
+        int frame;
+        if (sscanf(line, "stage %63s %lf %lld %lld %lld", name, &stats.mean,
+                   &stats.p50, &stats.p99, &stats.max) == 5) {
+            stages[name] = stats;
+        } else if (sscanf(line, "frame %d %lx", &frame, &hash) == 2) {
+            hashes.push_back(hash);
+        }
+    }
+    fclose(fp);
+    return true;
+}
+
+static void usage(const char *name)
+{
+    printf("Usage: %s [-l loops] [-c cpu] [-o stats] [-b baseline] [-s] "
+           "[-r] [-t] [-p] [-k] [-i] [-R | -T] table.mtb frames ...\n", name);
+}
+
+/* Put a frame through vision, or through one of the comparisons Vision has
+ * for the region of interest and line tracking, which do the same work as
+ * notifyImage() and then some.
+ */
+static void replayFrame(Vision &vision, const unsigned char *image,
+                        bool compareRoi, bool compareTracking)
+{
+#ifdef OFFLINE
+    if (compareRoi) {
+        vision.compareRegionOfInterest(image);
+        return;
+    }
+    if (compareTracking) {
+        vision.compareLineTracking(image);
+        return;
+    }
+#endif
+    vision.notifyImage(image);
+}
+
+int main(int argc, char **argv)
+{
+    int loops = 1, cpu = -1;
+    const char *statsFile = NULL, *baselineFile = NULL;
+    bool ballStats = false, roi = false, tracking = false;
+    bool compareRoi = false, compareTracking = false;
+    bool checks[NUM_CHECKS] = { false, false, false };
+    int opt;
+    while ((opt = getopt(argc, argv, "l:c:o:b:srtpkiRT")) != -1) {
+        switch (opt) {
+        case 'l': loops = atoi(optarg); break;
+        case 'c': cpu = atoi(optarg); break;
+        case 'o': statsFile = optarg; break;
+        case 'b': baselineFile = optarg; break;
+        case 's': ballStats = true; break;
+        case 'r': roi = true; break;
+        case 't': tracking = true; break;
+        case 'p': checks[CHECK_ESTIMATES] = true; break;
+        case 'k': checks[CHECK_KERNELS] = true; break;
+        case 'i': checks[CHECK_INTEGRALS] = true; break;
+        case 'R': compareRoi = roi = true; break;
+        case 'T': compareTracking = tracking = true; break;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    if (argc - optind < 2 || loops < 1 || (compareRoi && compareTracking)) {
+        usage(argv[0]);
+        return 1;
+    }
+    // -T leaves the objects alone, so there is nothing to hash
+    if (compareTracking && (statsFile != NULL || baselineFile != NULL)) {
+        printf("-T does not look for objects, so cannot be used with -o or "
+               "-b\n");
+        return 1;
+    }
+#ifndef OFFLINE
+    if (checks[CHECK_ESTIMATES] || checks[CHECK_KERNELS] ||
+        checks[CHECK_INTEGRALS] || compareRoi || compareTracking) {
+        printf("built without OFFLINE, the checks and comparisons are not "
+               "compiled in\n");
+        return 1;
+    }
+#endif
+#ifndef USE_INTEGRAL_IMAGE
+    if (checks[CHECK_INTEGRALS]) {
+        printf("built without USE_INTEGRAL_IMAGE, there is no integral "
+               "image to check\n");
+        return 1;
+    }
+#endif
+
+    vector<Frame> frames;
+    for (int i = optind + 1; i < argc; i++) {
+        if (!readFrames(argv[i], frames)) {
+            return 1;
+        }
+    }
+
+    shared_ptr<Sensors> sensors(new Sensors());
+    shared_ptr<NaoPose> pose(new NaoPose(sensors));
+    shared_ptr<Profiler> profiler(new Profiler(&timeNow));
+    Vision vision(pose, profiler);
+    vision.thresh->initTable(argv[optind]);
+    vision.thresh->setRegionOfInterest(roi);
+    vision.fieldLines->setLineTracking(tracking);
+
+    // after the vision threads are started, so only this one is pinned
+    if (cpu >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(cpu, &cpus);
+        if (sched_setaffinity(0, sizeof(cpus), &cpus) != 0) {
+            printf("Could not pin to cpu %d\n", cpu);
+            return 1;
+        }
+    }
+
+    vector<long long> times[NUM_STAGES];
+    vector<unsigned long> hashes;
+    int failures[NUM_CHECKS] = { 0, 0, 0 };
+    profiler->profileFrames(-1);
+    profiler->nextFrame();
+    for (int loop = 0; loop < loops; loop++) {
+        for (unsigned int f = 0; f < frames.size(); f++) {
+            sensors->setVisionBodyAngles(frames[f].joints);
+            if (static_cast<int>(frames[f].sensors.size()) == NUM_SENSORS) {
+                sensors->setAllSensors(frames[f].sensors);
+            }
+
+            const long long start = micro_time();
+            PROF_ENTER(profiler, P_VISION);
+            replayFrame(vision, &frames[f].image[0], compareRoi,
+                        compareTracking);
+            PROF_EXIT(profiler, P_VISION);
+            times[0].push_back(micro_time() - start);
+            for (int s = 1; s < NUM_STAGES; s++) {
+                times[s].push_back(profiler->getLastTime(STAGES[s]));
+            }
+            PROF_NFRAME(profiler);
+
+            if (loop == 0) {
+                hashes.push_back(hashResults(vision));
+#ifdef OFFLINE
+                // with the pose and image the frame was just run with
+                if (checks[CHECK_ESTIMATES] && !pose->compareEstimates()) {
+                    failures[CHECK_ESTIMATES]++;
+                }
+                Threshold *thresh = vision.thresh;
+                if (checks[CHECK_KERNELS] &&
+                    !thresh->compareThresholdKernels(KERNEL_ITERATIONS)) {
+                    failures[CHECK_KERNELS]++;
+                }
+#ifdef USE_INTEGRAL_IMAGE
+                if (checks[CHECK_INTEGRALS] &&
+                    !thresh->compareIntegralImage(INTEGRAL_BOXES)) {
+                    failures[CHECK_INTEGRALS]++;
+                }
+#endif
+#endif
+            }
+        }
+    }
+
+    map<string, StageStats> baseline;
+    vector<unsigned long> baselineHashes;
+    if (baselineFile != NULL &&
+        !readBaseline(baselineFile, baseline, baselineHashes)) {
+        printf("Could not read baseline %s\n", baselineFile);
+        return 1;
+    }
+
+    FILE *out = statsFile != NULL ? fopen(statsFile, "w") : NULL;
+    if (statsFile != NULL && out == NULL) {
+        printf("Could not write %s\n", statsFile);
+        return 1;
+    }
+
+    const int replayed = static_cast<int>(times[0].size());
+    printf("%d frames, %d loops, us per frame\n", replayed / loops, loops);
+    printf("%-12s %9s %8s %8s %8s", "stage", "mean", "p50", "p99", "max");
+    if (baselineFile != NULL) {
+        printf(" %8s %8s %7s", "base p50", "base p99", "p50");
+    }
+    printf("\n");
+    double fps = 0.0;
+    for (int s = 0; s < NUM_STAGES; s++) {
+#ifndef USE_TIME_PROFILING
+        // only whole frames are timed without the profiler
+        if (s > 0) {
+            break;
+        }
+#endif
+        const char *name = Profiler::getComponentName(STAGES[s]);
+        const StageStats stats = summarize(times[s]);
+        if (s == 0 && stats.mean > 0) {
+            fps = 1000000.0 / stats.mean;
+        }
+        printf("%-12s %9.1f %8lld %8lld %8lld", name, stats.mean, stats.p50,
+               stats.p99, stats.max);
+        map<string, StageStats>::const_iterator base = baseline.find(name);
+        if (base != baseline.end()) {
+            printf(" %8lld %8lld", base->second.p50, base->second.p99);
+            if (base->second.p50 > 0) {
+                printf(" %+6.1f%%", 100.0 * (stats.p50 - base->second.p50) /
+                       base->second.p50);
+            }
+        }
+        printf("\n");
+        if (out != NULL) {
+            fprintf(out, "stage %s %.1f %lld %lld %lld\n", name, stats.mean,
+                    stats.p50, stats.p99, stats.max);
+        }
+    }
+    printf("%.1f frames/sec\n", fps);
+#ifndef USE_TIME_PROFILING
+    printf("built without USE_TIME_PROFILING, only whole frames are timed\n");
+#endif
+    if (ballStats) {
+#ifdef OFFLINE
+        vision.thresh->orange->printCandidateStats();
+#else
+        printf("built without OFFLINE, no ball candidate stats\n");
+#endif
+    }
+
+#ifdef OFFLINE
+    if (compareRoi) {
+        vision.thresh->printRegionOfInterestStats();
+    }
+    if (compareTracking) {
+        vision.fieldLines->printLineTrackingStats();
+    }
+#endif
+
+    // the checks fail the run as a differing frame would
+    int status = 0;
+    for (int c = 0; c < NUM_CHECKS; c++) {
+        if (checks[c]) {
+            printf("%d of %u frames %s\n", failures[c],
+                   static_cast<unsigned int>(hashes.size()),
+                   CHECK_FAILURES[c]);
+            if (failures[c] > 0) {
+                status = 1;
+            }
+        }
+    }
+
+    if (out != NULL) {
+        for (unsigned int f = 0; f < hashes.size(); f++) {
+            fprintf(out, "frame %u %08lx\n", f, hashes[f]);
+        }
+        fclose(out);
+    }
+
+    if (baselineFile == NULL) {
+        return status;
+    }
+    if (baselineHashes.size() != hashes.size()) {
+        printf("baseline has %u frames, replayed %u\n",
+               static_cast<unsigned int>(baselineHashes.size()),
+               static_cast<unsigned int>(hashes.size()));
+        return 1;
+    }
+    int differ = 0;
+    for (unsigned int f = 0; f < hashes.size(); f++) {
+        if (hashes[f] != baselineHashes[f]) {
+            if (differ == 0) {
+                printf("first differing frame: %s\n", frames[f].name.c_str());
+            }
+            differ++;
+        }
+    }
+    printf("%d of %u frames found different objects than the baseline\n",
+           differ, static_cast<unsigned int>(hashes.size()));
+    return differ == 0 ? status : 1;
+}
@@ -0,0 +1,270 @@
+/**
+ * scanBench: times the vision scanners on saved frames with the thresholded
+ * image laid out row-major (thresholded[y][x]) and column-major
+ * (Threshold::columnMajor[x][y]).  See the README in this directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Common.h"
+#include "VisionDef.h"
+#include "ColorTable.h"
+
+using namespace std;
+
+static const int TIMING_ITERATIONS = 50;
+
+static unsigned char cube[YMAX][UMAX][VMAX];
+static unsigned char image[IMAGE_BYTE_SIZE];
+static unsigned char rowMajor[IMAGE_HEIGHT][IMAGE_WIDTH];
+static unsigned char columnMajor[IMAGE_WIDTH][IMAGE_HEIGHT];
+
+// a field edge for the scanners that start from one
+static int topEdge[IMAGE_WIDTH];
+
+struct RowMajor {
+    static const char* name() { return "row-major"; }
+    static unsigned char at(int x, int y) { return rowMajor[y][x]; }
+};
+
+struct ColumnMajor {
+    static const char* name() { return "column-major"; }
+    static unsigned char at(int x, int y) { return columnMajor[x][y]; }
+};
+
+#if defined(__i386__) || defined(__x86_64__)
+static const char *TIME_UNIT = "cycles";
+static inline unsigned long long readTime()
+{
+    unsigned int low, high;
+    __asm__ __volatile__("rdtsc" : "=a" (low), "=d" (high));
+    return (static_cast<unsigned long long>(high) << 32) | low;
+}
+#else
+static const char *TIME_UNIT = "us";
+static inline unsigned long long readTime()
+{
+    return static_cast<unsigned long long>(micro_time());
+}
+#endif
+
+// Same walk as Threshold::thresholdScalar(), U and V reversed as in setYUV()
+static void thresholdFrame()
+{
+    unsigned char *out = &rowMajor[0][0];
+    const unsigned char *yPtr = image, *uPtr = image + 3, *vPtr = image + 1;
+    for (int i = 0; i < IMAGE_WIDTH * IMAGE_HEIGHT; i += 2) {
+        out[i] = cube[yPtr[0] >> YSHIFT][*uPtr >> USHIFT][*vPtr >> VSHIFT];
+        out[i+1] = cube[yPtr[2] >> YSHIFT][*uPtr >> USHIFT][*vPtr >> VSHIFT];
+        yPtr += 4; uPtr += 4; vPtr += 4;
+    }
+    for (int y = 0; y < IMAGE_HEIGHT; y++) {
+        for (int x = 0; x < IMAGE_WIDTH; x++) {
+            columnMajor[x][y] = rowMajor[y][x];
+        }
+    }
+
+    // top of the field: first run of green from the top of each column
+    for (int x = 0; x < IMAGE_WIDTH; x++) {
+        int y = 0, green = 0;
+        for (; y < IMAGE_HEIGHT && green < 3; y++) {
+            green = rowMajor[y][x] == GREEN ? green + 1 : 0;
+        }
+        topEdge[x] = y < IMAGE_HEIGHT ? y : IMAGE_HEIGHT / 2;
+    }
+}
+
+// Threshold::findGoals(): up from the field edge, then down
+template <class Layout>
+static int scanGoals()
+{
+    int found = 0;
+    for (int x = 0; x < IMAGE_WIDTH; x++) {
+        int bad = 0, goal = 0;
+        for (int y = topEdge[x]; bad < 5 && y >= 0; y--) {
+            const unsigned char pixel = Layout::at(x, y);
+            if (pixel == BLUE || pixel == YELLOW) {
+                goal++;
+            } else {
+                bad++;
+            }
+        }
+        bad = 0;
+        for (int y = topEdge[x] + 1; bad < 5 && y < IMAGE_HEIGHT; y++) {
+            const unsigned char pixel = Layout::at(x, y);
+            if (pixel == BLUE || pixel == YELLOW) {
+                goal++;
+            } else {
+                bad += pixel == GREEN ? 2 : 1;
+            }
+        }
+        found += goal;
+    }
+    return found;
+}
+
+// Threshold::findBallsCrosses(): runs from the bottom up to the field edge
+template <class Layout>
+static int scanBallsCrosses()
+{
+    int found = 0;
+    for (int x = 0; x < IMAGE_WIDTH; x++) {
+        unsigned char last = GREEN;
+        int run = 0;
+        for (int y = IMAGE_HEIGHT - 1; y >= topEdge[x]; y--) {
+            const unsigned char pixel = Layout::at(x, y);
+            if (pixel == last) {
+                run++;
+            } else {
+                if (run > 2 && (last == ORANGE || last == WHITE)) {
+                    found += run;
+                }
+                run = 1;
+                last = pixel;
+            }
+        }
+    }
+    return found;
+}
+
+// Field::findConvexHull(): down each hull column to a run of green
+template <class Layout>
+static int scanHull()
+{
+    int found = 0;
+    for (int x = 0; x < IMAGE_WIDTH; x += 2) {
+        int good = 0, y = 0;
+        for (; good < 3 && y < IMAGE_HEIGHT; y++) {
+            good = Layout::at(x, y) == GREEN ? good + 1 : 0;
+        }
+        found += y;
+    }
+    return found;
+}
+
+// FieldLines::percentColor(): green above and below every other pixel of
+// every fourth column, as the vertical edge tests ask for
+template <class Layout>
+static int scanPercentColor()
+{
+    static const int NUM_TEST_PIXELS = 10;
+    int found = 0;
+    for (int x = 0; x < IMAGE_WIDTH; x += 4) {
+        for (int y = NUM_TEST_PIXELS; y < IMAGE_HEIGHT - NUM_TEST_PIXELS;
+             y += 2) {
+            for (int i = 1; i <= NUM_TEST_PIXELS; i++) {
+                found += Layout::at(x, y - i) == GREEN;
+                found += Layout::at(x, y + i) == GREEN;
+            }
+        }
+    }
+    return found;
+}
+
+// FieldLines::findHorizontalLinePoints(): along every fourth row
+template <class Layout>
+static int scanRows()
+{
+    int found = 0;
+    for (int y = 0; y < IMAGE_HEIGHT; y += 4) {
+        for (int x = 0; x < IMAGE_WIDTH; x++) {
+            found += Layout::at(x, y) == WHITE;
+        }
+    }
+    return found;
+}
+
+struct Scanner {
+    const char *name;
+    int (*rowScan)();
+    int (*columnScan)();
+    unsigned long long rowTime, columnTime;
+};
+
+static Scanner scanners[] = {
+    { "findGoals", scanGoals<RowMajor>, scanGoals<ColumnMajor>, 0, 0 },
+    { "findBallsCrosses", scanBallsCrosses<RowMajor>,
+      scanBallsCrosses<ColumnMajor>, 0, 0 },
+    { "findConvexHull", scanHull<RowMajor>, scanHull<ColumnMajor>, 0, 0 },
+    { "percentColor (vertical)", scanPercentColor<RowMajor>,
+      scanPercentColor<ColumnMajor>, 0, 0 },
+    { "horizontal line scan", scanRows<RowMajor>, scanRows<ColumnMajor>,
+      0, 0 }
+};
+static const int NUM_SCANNERS = sizeof(scanners) / sizeof(scanners[0]);
+
+// Time one scanner in one layout, flushing nothing: the image is as warm as
+// it would be straight after thresholding
+static unsigned long long timeScan(int (*scan)(), int &result)
+{
+    const unsigned long long start = readTime();
+    for (int i = 0; i < TIMING_ITERATIONS; i++) {
+        result = scan();
+    }
+    return readTime() - start;
+}
+
+static bool readFrame(const char *filename)
+{
+    FILE *fp = fopen(filename, "rb");
+    if (fp == NULL) {
+        return false;
+    }
+    const bool ok = fread(image, 1, IMAGE_BYTE_SIZE, fp) == IMAGE_BYTE_SIZE;
+    fclose(fp);
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3) {
+        printf("Usage: %s table.mtb frame.NBFRM ...\n", argv[0]);
+        return 1;
+    }
+
+    FILE *in = fopen(argv[1], "rb");
+    if (in == NULL || fread(cube, 1, sizeof(cube), in) != sizeof(cube)) {
+        printf("Could not read a %dx%dx%d table from %s\n",
+               YMAX, UMAX, VMAX, argv[1]);
+        return 1;
+    }
+    fclose(in);
+
+    int frames = 0, mismatches = 0;
+    for (int f = 2; f < argc; f++) {
+        if (!readFrame(argv[f])) {
+            printf("Could not read frame %s\n", argv[f]);
+            continue;
+        }
+        thresholdFrame();
+
+        for (int s = 0; s < NUM_SCANNERS; s++) {
+            int rowResult, columnResult;
+            scanners[s].rowTime += timeScan(scanners[s].rowScan, rowResult);
+            scanners[s].columnTime += timeScan(scanners[s].columnScan,
+                                               columnResult);
+            if (rowResult != columnResult) {
+                printf("%s: %s disagrees between layouts\n", argv[f],
+                       scanners[s].name);
+                mismatches++;
+            }
+        }
+        frames++;
+    }
+
+    if (frames == 0) {
+        return 1;
+    }
+    const unsigned long long runs =
+        static_cast<unsigned long long>(frames) * TIMING_ITERATIONS;
+    printf("%d frames, %s per frame\n", frames, TIME_UNIT);
+    printf("%-26s %14s %14s\n", "scanner", RowMajor::name(),
+           ColumnMajor::name());
+    for (int s = 0; s < NUM_SCANNERS; s++) {
+        printf("%-26s %14llu %14llu\n", scanners[s].name,
+               scanners[s].rowTime / runs, scanners[s].columnTime / runs);
+    }
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,160 @@
+/**
+ * tableConvert: turns a flat .mtb color table into a compact .ctb table and
+ * compares the two on saved frames.  See the README in this directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <set>
+
+#include "Common.h"
+#include "VisionDef.h"
+#include "ColorTable.h"
+
+using namespace std;
+
+static const int TIMING_ITERATIONS = 20;
+static const unsigned int CACHE_LINE = 64;
+
+static unsigned char cube[YMAX][UMAX][VMAX];
+static unsigned char image[IMAGE_BYTE_SIZE];
+static unsigned char flatOut[IMAGE_WIDTH * IMAGE_HEIGHT];
+static unsigned char compactOut[IMAGE_WIDTH * IMAGE_HEIGHT];
+
+// Same walk as Threshold::thresholdScalar(), U and V reversed as in setYUV()
+static void thresholdFlat(unsigned char *out)
+{
+    const unsigned char *yPtr = image, *uPtr = image + 3, *vPtr = image + 1;
+    for (int i = 0; i < IMAGE_WIDTH * IMAGE_HEIGHT; i += 2) {
+        out[i] = cube[yPtr[0] >> YSHIFT][*uPtr >> USHIFT][*vPtr >> VSHIFT];
+        out[i+1] = cube[yPtr[2] >> YSHIFT][*uPtr >> USHIFT][*vPtr >> VSHIFT];
+        yPtr += 4; uPtr += 4; vPtr += 4;
+    }
+}
+
+static void thresholdCompact(const CompactColorTable &table,
+                             unsigned char *out)
+{
+    const unsigned char *yPtr = image, *uPtr = image + 3, *vPtr = image + 1;
+    for (int i = 0; i < IMAGE_WIDTH * IMAGE_HEIGHT; i += 2) {
+        out[i] = table.lookup(yPtr[0] >> YSHIFT, *uPtr >> USHIFT,
+                              *vPtr >> VSHIFT);
+        out[i+1] = table.lookup(yPtr[2] >> YSHIFT, *uPtr >> USHIFT,
+                                *vPtr >> VSHIFT);
+        yPtr += 4; uPtr += 4; vPtr += 4;
+    }
+}
+
+// Count the cache lines of each table the frame's lookups land in.  The
+// compact table's lines are numbered as if the index came before the rows.
+static void countTouchedLines(const CompactColorTable &table,
+                              int &flatLines, int &compactLines)
+{
+    set<unsigned int> flat, compact;
+    const unsigned int rowsStart = YMAX * UMAX * sizeof(unsigned short);
+    for (int i = 0; i < IMAGE_BYTE_SIZE; i += 4) {
+        const unsigned int u = image[i+3] >> USHIFT, v = image[i+1] >> VSHIFT;
+        for (int k = 0; k < 4; k += 2) {
+            const unsigned int y = image[i+k] >> YSHIFT;
+            const unsigned int yu = (y << (UV_BITS - V_BITS)) | u;
+            flat.insert(((yu << V_BITS) | v) / CACHE_LINE);
+
+            // one line of the index, then one line of the (shared) row
+            compact.insert(yu * sizeof(unsigned short) / CACHE_LINE);
+            compact.insert((rowsStart + table.rowOffset(y, u) + v) /
+                           CACHE_LINE);
+        }
+    }
+    flatLines = static_cast<int>(flat.size());
+    compactLines = static_cast<int>(compact.size());
+}
+
+static bool readFrame(const char *filename)
+{
+    FILE *fp = fopen(filename, "rb");
+    if (fp == NULL) {
+        return false;
+    }
+    const bool ok = fread(image, 1, IMAGE_BYTE_SIZE, fp) == IMAGE_BYTE_SIZE;
+    fclose(fp);
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3) {
+        printf("Usage: %s input.mtb output.ctb [frame.NBFRM ...]\n", argv[0]);
+        return 1;
+    }
+
+    FILE *in = fopen(argv[1], "rb");
+    if (in == NULL || fread(cube, 1, sizeof(cube), in) != sizeof(cube)) {
+        printf("Could not read a %dx%dx%d table from %s\n",
+               YMAX, UMAX, VMAX, argv[1]);
+        return 1;
+    }
+    fclose(in);
+
+    CompactColorTable table;
+    table.build(&cube[0][0][0]);
+
+    FILE *out = fopen(argv[2], "wb");
+    if (out == NULL || !table.write(out)) {
+        printf("Could not write %s\n", argv[2]);
+        return 1;
+    }
+    fclose(out);
+
+    printf("%s: %d distinct rows, %d bytes (flat table %d bytes, %.1f%%)\n",
+           argv[2], table.getNumRows(), table.getByteSize(),
+           static_cast<int>(sizeof(cube)),
+           100.0f * static_cast<float>(table.getByteSize()) /
+           static_cast<float>(sizeof(cube)));
+
+    int frames = 0, mismatches = 0;
+    long long flatTime = 0, compactTime = 0;
+    long flatLines = 0, compactLines = 0;
+    for (int f = 3; f < argc; f++) {
+        if (!readFrame(argv[f])) {
+            printf("Could not read frame %s\n", argv[f]);
+            continue;
+        }
+
+        long long start = micro_time();
+        for (int i = 0; i < TIMING_ITERATIONS; i++) {
+            thresholdFlat(flatOut);
+        }
+        flatTime += micro_time() - start;
+
+        start = micro_time();
+        for (int i = 0; i < TIMING_ITERATIONS; i++) {
+            thresholdCompact(table, compactOut);
+        }
+        compactTime += micro_time() - start;
+
+        if (memcmp(flatOut, compactOut, sizeof(flatOut)) != 0) {
+            printf("%s: compact table disagrees with flat table\n", argv[f]);
+            mismatches++;
+        }
+
+        int fl, cl;
+        countTouchedLines(table, fl, cl);
+        flatLines += fl;
+        compactLines += cl;
+        frames++;
+    }
+
+    if (frames > 0) {
+        const float pixels = static_cast<float>(frames) *
+            TIMING_ITERATIONS * IMAGE_WIDTH * IMAGE_HEIGHT;
+        printf("%d frames, %d mismatched\n", frames, mismatches);
+        printf("flat:    %.3f ns/pixel, %ld cache lines touched per frame\n",
+               static_cast<float>(flatTime) * 1000.0f / pixels,
+               flatLines / frames);
+        printf("compact: %.3f ns/pixel, %ld cache lines touched per frame\n",
+               static_cast<float>(compactTime) * 1000.0f / pixels,
+               compactLines / frames);
+    }
+    return mismatches == 0 ? 0 : 1;
+}